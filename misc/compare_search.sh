@@ -0,0 +1,48 @@
+#!/bin/bash
+# Compares the random walk and coverage search modes in mobility_sim, each
+# with and without the target memory: the mean share of the arena the
+# rovers' cameras covered and the cubes collected, after each round length,
+# with 95% confidence intervals, the round minutes per cube collected, and
+# the /swarmMap bytes per second through each rover's wireless interface.
+#
+# usage: compare_search.sh [rounds] [rovers] [minutes ...]
+#
+# Set MOBILITY_SIM to run a mobility_sim binary outside the workspace, and
+# SIM_ARGS for more mobility_sim options such as --final.
+
+rounds=${1:-20}
+rovers=${2:-3}
+shift 2 2>/dev/null
+minutes=${@:-5 10 15 20 25 30}
+sim=${MOBILITY_SIM:-rosrun mobility mobility_sim}
+
+echo "search,target_memory,minutes,area_covered,area_ci,collected,collected_ci,minutes_per_cube,swarm_bytes_per_s"
+for mode in random coverage
+do
+    for memory in on off
+    do
+        memoryArgs=
+        [ $memory = off ] && memoryArgs=--no-target-memory
+
+        for m in $minutes
+        do
+            $sim --rovers $rovers --minutes $m --rounds $rounds --search $mode $memoryArgs $SIM_ARGS 2>/dev/null |
+            awk -F, -v mode=$mode -v memory=$memory -v m=$m '
+                NR > 1 {
+                    n++
+                    area += $11; areaSquares += $11 * $11
+                    cubes += $7; cubeSquares += $7 * $7
+                    swarmBytes += $12
+                }
+                END {
+                    if (n < 2) exit 1
+                    areaMean = area / n
+                    cubeMean = cubes / n
+                    areaCi = 1.96 * sqrt((areaSquares - n * areaMean * areaMean) / (n - 1) / n)
+                    cubeCi = 1.96 * sqrt((cubeSquares - n * cubeMean * cubeMean) / (n - 1) / n)
+                    perCube = cubeMean > 0 ? sprintf("%.2f", m / cubeMean) : "inf"
+                    printf "%s,%s,%s,%.1f%%,%.1f%%,%.2f,%.2f,%s,%.1f\n", mode, memory, m, 100 * areaMean, 100 * areaCi, cubeMean, cubeCi, perCube, swarmBytes / n
+                }'
+        done
+    done
+done
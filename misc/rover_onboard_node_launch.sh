@@ -25,6 +25,9 @@ fi
 #Set prefix to fully qualify transforms for each robot
 rosparam set tf_prefix $HOSTNAME
 
+#Tuning constants for mobility, obstacle and abridge, read under /$HOSTNAME
+rosparam load $HOME/rover_workspace/launch/rover_params.yaml /$HOSTNAME
+
 
 #Function to lookup correct path for a given device
 findDevicePath() {
@@ -72,6 +75,17 @@ else
     nohup rosrun ublox_gps ublox_gps __name:=$HOSTNAME\_UBLOX /$HOSTNAME\_UBLOX/fix:=/$HOSTNAME/fix /$HOSTNAME\_UBLOX/fix_velocity:=/$HOSTNAME/fix_velocity /$HOSTNAME\_UBLOX/navposllh:=/$HOSTNAME/navposllh /$HOSTNAME\_UBLOX/navsol:=/$HOSTNAME/navsol /$HOSTNAME\_UBLOX/navstatus:=/$HOSTNAME/navstatus /$HOSTNAME\_UBLOX/navvelned:=/$HOSTNAME/navvelned _device:=/dev/$gpsDevicePath _frame_id:=$HOSTNAME/base_link &
 fi
 
+#Rovers only share a map frame, and so a swarm map, when they start it from
+#the same datum. Set SWARMIE_DATUM to "latitude, longitude" of the collection
+#disk on every rover, without it each map starts where its rover first got a fix.
+if [ -n "$SWARMIE_DATUM" ]
+then
+    rosparam set /$HOSTNAME\_NAVSAT/wait_for_datum true
+    rosparam set /$HOSTNAME\_NAVSAT/datum "[$SWARMIE_DATUM, 0.0, map, $HOSTNAME/base_link]"
+else
+    echo "Warning: SWARMIE_DATUM is not set, this rover's swarm map will not line up with the others"
+fi
+
 nohup rosrun robot_localization navsat_transform_node __name:=$HOSTNAME\_NAVSAT _world_frame:=map _frequency:=10 _magnetic_declination_radians:=0.1530654 _yaw_offset:=0 /imu/data:=/$HOSTNAME/imu /gps/fix:=/$HOSTNAME/fix /odometry/filtered:=/$HOSTNAME/odom/ekf /odometry/gps:=/$HOSTNAME/odom/navsat &
 
 rosparam set /$HOSTNAME\_ODOM/odom0 /$HOSTNAME/odom
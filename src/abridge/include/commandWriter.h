@@ -0,0 +1,89 @@
+#ifndef COMMANDWRITER_H
+#define	COMMANDWRITER_H
+
+#include <string>
+
+#include <boost/thread.hpp>
+#include <ros/ros.h>
+
+#include "usbSerial.h"
+
+/*
+ * Sends commands to the arduino from a thread of its own.
+ *
+ * Each kind of command has one slot holding only its latest value, so a
+ * command that has not been written yet is replaced rather than queued
+ * behind newer ones. A command identical to the last one written from its
+ * slot is not written again unless keepaliveInterval has passed since, which
+ * stops mobility's repeated gripper commands from using up the serial link.
+ * Everything waiting is written together in one write(), and writes are at
+ * least 1 / maxRate seconds apart. Commands in a write that fails are kept
+ * and written again, unless replaced meanwhile.
+ */
+class CommandWriter {
+public:
+
+    enum Slot {
+        DRIVE,
+        FINGER,
+        WRIST,
+        REQUEST, // sensor data requests, see set()
+        SLOT_COUNT
+    };
+
+    static const int maxCommandLength = 32;
+
+    CommandWriter(USBSerial* usb);
+    ~CommandWriter();
+
+    void start(float maxRate, float keepaliveInterval);
+    void stop();
+
+    // Replaces the command waiting in slot. With always set the command is
+    // written even if it is the same as the last one, as for data requests
+    // and drive commands.
+    void set(Slot slot, const char* command, bool always = false);
+
+    // one line summary of what has been written, and how long commands
+    // waited to be written, since the last reset
+    std::string summary();
+    void resetStats();
+
+private:
+
+    struct CommandSlot {
+        char command[maxCommandLength];
+        int length;
+        bool pending;
+        ros::WallTime queued; // when the oldest unwritten change was made
+
+        char sent[maxCommandLength];
+        int sentLength;
+        ros::WallTime lastSent;
+    };
+
+    void writeLoop();
+
+    USBSerial* usb;
+    CommandSlot slots[SLOT_COUNT];
+
+    boost::mutex mutex;
+    boost::condition_variable wakeup;
+    boost::thread writeThread;
+    bool running;
+
+    double minInterval; // seconds
+    double keepaliveInterval; // seconds
+    ros::WallTime lastWrite;
+
+    unsigned long commands;
+    unsigned long duplicates;
+    unsigned long writes;
+    unsigned long failedWrites;
+    unsigned long bytes;
+    double totalLatency;
+    double maxLatency;
+
+};
+
+#endif	/* COMMANDWRITER_H */
@@ -0,0 +1,48 @@
+#ifndef DEVICECLOCK_H
+#define	DEVICECLOCK_H
+
+#include <stdint.h>
+
+#include <ros/ros.h>
+
+/*
+ * Converts the arduino's millisecond clock into ROS time so that sensor
+ * messages can be stamped with the time the sample was taken rather than the
+ * time it reached us.
+ *
+ * The offset between the two clocks is estimated from the packets
+ * themselves: a packet can never arrive before it was sent, so the smallest
+ * (arrival time - device time) seen is the best estimate of the offset, the
+ * difference being transmission and scheduling delay. The estimate is
+ * allowed to creep upwards slowly to follow drift between the clocks.
+ */
+class DeviceClock {
+public:
+
+    DeviceClock();
+
+    // ROS time at which a sample stamped deviceMillis was taken, given the
+    // time its packet was received
+    ros::Time toRosTime(uint32_t deviceMillis, ros::Time received);
+
+    void reset();
+
+    // how much later than the sample the last packet arrived, in seconds
+    double getLastDelay() {return lastDelay;}
+
+private:
+
+    // fastest the offset is allowed to grow, the arduino's resonator is
+    // only good to about 0.5%
+    static const double maxDrift; // seconds per second
+
+    bool initialized;
+    uint32_t lastDeviceMillis;
+    uint64_t wraps;
+    double offset; // ros time - device time, seconds
+    ros::Time lastUpdate;
+    double lastDelay;
+
+};
+
+#endif	/* DEVICECLOCK_H */
@@ -0,0 +1,80 @@
+#ifndef DRIVECONTROLLER_H
+#define	DRIVECONTROLLER_H
+
+#include "windowedIntegral.h"
+
+/*
+ * The velocity and yaw PID controllers that turn mobility's drive commands
+ * into left and right motor PWM values.
+ *
+ * The gains were tuned with commands arriving at designRate. Commands may
+ * arrive at another rate, so every update is given the measured time since
+ * the previous one: the integral adds each error weighted by dt * designRate
+ * and the derivative divides by dt, which keeps the gains meaning the same
+ * thing at any rate. The measured interval is clamped to between 0.25 and 4
+ * command intervals so that a missed command or a burst of them does not
+ * throw the controller off.
+ *
+ * Kept apart from abridge's ROS callbacks so it can be run against recorded
+ * commands and a simulated drive train.
+ */
+class DriveController {
+public:
+
+    struct Gains {
+        Gains();
+
+        float kpv; // proportional velocity
+        float kiv; // integral velocity
+        float kdv; // derivative velocity
+        float kpy; // proportional yaw
+        float kiy; // integral yaw
+        float kdy; // derivative yaw
+    };
+
+    // designRate is the command rate the gains were tuned at, integralWindow
+    // the seconds of error history the integral terms sum
+    DriveController(float designRate, float integralWindow);
+
+    void setGains(const Gains& gains) {this->gains = gains;}
+    const Gains& getGains() {return gains;}
+
+    // the rate drive commands are expected at, this sizes the integral
+    // windows and the limits on the measured interval
+    void setControlRate(float controlRate);
+
+    // Runs the controllers for one drive command. linearSpeed is the target
+    // velocity in m/s, yawError the heading error in radians, velocity the
+    // measured speed in m/s and dt the seconds since the previous command.
+    // In manual mode the command is scaled straight to PWM. The motor
+    // commands, from -255 to 255, are written to left and right.
+    void update(float linearSpeed, float yawError, float velocity, float dt, bool manual, int& left, int& right);
+
+    float getMinInterval() {return minInterval;}
+    float getMaxInterval() {return maxInterval;}
+
+    // integral terms as they stand, for tests
+    float getVelocityIntegral() {return velIntegral.getSum();}
+    float getYawIntegral() {return yawIntegral.getSum();}
+
+private:
+
+    Gains gains;
+    float designRate;
+    float integralWindow;
+    float minInterval; // measured intervals are clamped to these, seconds
+    float maxInterval;
+
+    float velFF; //velocity feed forward
+    WindowedIntegral velIntegral; //sum of the velocity error over the last integralWindow seconds
+    float velError[4]; //contains current velocity error and error 3 steps in the past.
+
+    WindowedIntegral yawIntegral; //sum of the yaw error over the last integralWindow seconds
+    float yawError[4]; //contains current yaw error and error 3 steps in the past.
+
+    float prevLin;
+    float prevYaw;
+
+};
+
+#endif	/* DRIVECONTROLLER_H */
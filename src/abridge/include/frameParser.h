@@ -0,0 +1,109 @@
+#ifndef FRAMEPARSER_H
+#define	FRAMEPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ringBuffer.h"
+
+/*
+ * Sensor packets sent by the arduino, in either of two formats.
+ *
+ * Binary frames (protocol version 1), all numbers little endian:
+ *
+ *   0xA5 0x5A | version | type | length | payload | crc16
+ *
+ *   payload: uint32 device time in milliseconds followed by the float32
+ *            values of the packet type, length is the payload size in bytes
+ *   crc16:   CRC-16/CCITT-FALSE over version, type, length and payload
+ *
+ * ASCII lines, the original format, still accepted so older firmware keeps
+ * working:
+ *
+ *   IMU,1,<v1>,...,<v9>\n
+ *
+ * where the second field is 1 when the reading is valid. ASCII lines carry no
+ * device time. Neither format can be mistaken for the other because ASCII
+ * lines never contain the 0xA5 sync byte.
+ */
+
+enum SensorPacketType {
+    PACKET_NONE = 0,
+    PACKET_IMU = 1,   // accel x/y/z, gyro x/y/z, roll, pitch, yaw
+    PACKET_ODOM = 2,  // dx, dy (cm), yaw, vx, vy (cm/s), yaw rate
+    PACKET_USL = 3,   // range (cm)
+    PACKET_USC = 4,   // range (cm)
+    PACKET_USR = 5,   // range (cm)
+    PACKET_GRF = 6,   // finger angle
+    PACKET_GRW = 7    // wrist angle
+};
+
+struct SensorPacket {
+    static const int maxValues = 9;
+
+    SensorPacketType type;
+    bool binary;             // false if it arrived as an ASCII line
+    uint32_t deviceMillis;   // only set for binary frames
+    int valueCount;
+    float values[maxValues];
+};
+
+/*
+ * Splits the serial byte stream into SensorPackets. Bytes are queued with
+ * feed() and whole packets are taken out with next(). Partial packets stay
+ * queued until the rest arrives, and corrupt data is skipped one byte at a
+ * time until the stream lines up with a packet again. Nothing is allocated
+ * while parsing.
+ */
+class FrameParser {
+public:
+
+    static const unsigned char syncByte1 = 0xA5;
+    static const unsigned char syncByte2 = 0x5A;
+    static const unsigned char protocolVersion = 1;
+
+    FrameParser();
+
+    // queues received bytes, returns how many did not fit and were dropped
+    size_t feed(const char* data, size_t length);
+
+    // takes the next complete packet off the queue, false if there is none yet
+    bool next(SensorPacket& packet);
+
+    void reset();
+
+    // number of values carried by each packet type, 0 for unknown types
+    static int valueCount(SensorPacketType type);
+
+    // encodes a binary frame into out, returns its size or 0 if out is too small
+    static size_t encode(const SensorPacket& packet, unsigned char* out, size_t outSize);
+
+    static uint16_t crc16(const unsigned char* data, size_t length);
+
+    // counters since construction, for diagnostics
+    unsigned long binaryFrames;
+    unsigned long asciiLines;
+    unsigned long crcErrors;
+    unsigned long discardedBytes;
+    unsigned long overflowBytes;
+
+private:
+
+    static const size_t headerSize = 5;
+    static const size_t crcSize = 2;
+    static const size_t maxPayloadSize = 4 + 4 * SensorPacket::maxValues;
+    static const size_t maxLineLength = 128;
+
+    // return 1 if a packet was taken, 0 if more bytes are needed, -1 if the
+    // head of the queue was invalid and something was discarded
+    int nextBinary(SensorPacket& packet);
+    int nextAscii(SensorPacket& packet);
+
+    bool parseLine(char* line, SensorPacket& packet);
+
+    RingBuffer buffer;
+    char line[maxLineLength + 1];
+
+};
+
+#endif	/* FRAMEPARSER_H */
@@ -0,0 +1,59 @@
+#ifndef RINGBUFFER_H
+#define	RINGBUFFER_H
+
+#include <stddef.h>
+
+/*
+ * Fixed size byte queue for data read from the serial port. Bytes are
+ * appended at the tail and consumed from the head, and can be inspected in
+ * place with peek() so a parser never has to copy them out first. Nothing
+ * is allocated after construction. Not thread safe.
+ */
+class RingBuffer {
+public:
+
+    static const size_t capacity = 1024;
+
+    RingBuffer() : head(0), count(0) {}
+
+    // appends as many bytes as fit and returns how many that was
+    size_t write(const char* data, size_t length) {
+        size_t written = 0;
+        while (written < length && count < capacity) {
+            buffer[(head + count) % capacity] = data[written];
+            count++;
+            written++;
+        }
+        return written;
+    }
+
+    // byte at the given offset from the head, offset must be < size()
+    unsigned char peek(size_t offset) const {
+        return buffer[(head + offset) % capacity];
+    }
+
+    // discards length bytes from the head
+    void consume(size_t length) {
+        if (length > count) length = count;
+        head = (head + length) % capacity;
+        count -= length;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    size_t size() const {return count;}
+    size_t space() const {return capacity - count;}
+    bool empty() const {return count == 0;}
+
+private:
+
+    unsigned char buffer[capacity];
+    size_t head;
+    size_t count;
+
+};
+
+#endif	/* RINGBUFFER_H */
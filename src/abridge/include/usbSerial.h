@@ -1,6 +1,7 @@
 #ifndef USBSERIAL_H
 #define	USBSERIAL_H
 
+#include <atomic>
 #include <cstdlib>
 #include <string>
 #include <stdio.h>
@@ -10,25 +11,72 @@
 #include <fcntl.h>   
 #include <termios.h> 
 
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+#include "frameParser.h"
+
 using namespace std;
 
 class USBSerial {
 public:
     
+    typedef boost::function<void (const SensorPacket&)> PacketCallback;
+    typedef boost::function<void (bool connected)> ConnectionCallback;
+
     USBSerial();
     virtual ~USBSerial();
   
-    void openUSBPort(string devicePath, int baud);
-    void sendData(char data[]);
-    string readData();
+    // returns false if the port could not be opened, the read thread keeps
+    // trying to open it
+    bool openUSBPort(string devicePath, int baud);
+    void sendData(const char data[]);
+    bool sendData(const char data[], int length);
     void closeUSBPort();
 
+    // Starts a thread that waits for data on the port and calls callback,
+    // on that thread, for every complete sensor packet as soon as its last
+    // byte arrives. Partial packets are kept until the rest arrives.
+    //
+    // If the port fails, for instance because the arduino was unplugged, the
+    // thread closes it, calls connectionCallback with false and tries to
+    // reopen it every reconnectInterval seconds. connectionCallback is called
+    // with true once it has been reopened.
+    void startReading(PacketCallback callback, ConnectionCallback connectionCallback = ConnectionCallback());
+    void stopReading();
+
+    // waits up to timeout seconds for the next sensor packet, false if none
+    // arrived
+    bool waitForPacket(double timeout);
+
+    bool isConnected() {return connected;}
+
+    // parser counters, see FrameParser
+    const FrameParser& getParser() {return parser;}
+
 private:
 
+    static const double reconnectInterval; // seconds
+
+    bool openPort();
+    void closePort();
+    void readLoop();
+
+    string devicePath;
     struct termios ioStruct;
     int usbFileDescriptor;
-    char serialDataIn[200];
-    char dataOut[16];
+    boost::mutex portMutex; // held while the descriptor is used or changed
+    std::atomic<bool> connected;
+
+    FrameParser parser;
+    PacketCallback packetCallback;
+    ConnectionCallback connectionCallback;
+    boost::thread readThread;
+    std::atomic<bool> reading;
+
+    boost::mutex packetMutex;
+    boost::condition_variable packetArrived;
+    unsigned long packetCount;
 
 };
 
@@ -0,0 +1,43 @@
+#ifndef WINDOWEDINTEGRAL_H
+#define	WINDOWEDINTEGRAL_H
+
+#include <vector>
+
+/*
+ * Sum of the most recent errors fed to a PID controller, used as its
+ * integral term. The errors are kept in a ring of fixed length and the sum is
+ * maintained as they are added and overwritten, so adding an error and
+ * reading the sum are O(1) however long the window is.
+ *
+ * reset() is O(1) too: every slot remembers the generation it was written in
+ * and slots from before the last reset count as zero.
+ */
+class WindowedIntegral {
+public:
+
+    WindowedIntegral(int length);
+
+    void add(float error);
+
+    // forget every error added so far
+    void reset();
+
+    // change the number of errors summed, this also forgets them
+    void setLength(int length);
+
+    float getSum() {return sum;}
+    int getLength() {return values.size();}
+
+private:
+
+    void resum();
+
+    std::vector<float> values;
+    std::vector<unsigned int> generations;
+    unsigned int generation;
+    int next; // slot the next error is written to
+    double sum;
+
+};
+
+#endif	/* WINDOWEDINTEGRAL_H */
@@ -16,6 +16,10 @@
 
 //Package include
 #include <usbSerial.h>
+#include <frameParser.h>
+#include <deviceClock.h>
+#include <driveController.h>
+#include <commandWriter.h>
 
 using namespace std;
 
@@ -24,8 +28,10 @@ void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message);
 void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void serialActivityTimer(const ros::TimerEvent& e);
-void publishRosTopics();
-void parseData(string data);
+void sensorPacketHandler(const SensorPacket& packet);
+void connectionHandler(bool connected);
+void logInfo(string message);
+void initSonar(sensor_msgs::Range& sonar, string frame);
 std::string getHumanFriendlyTime();
 
 //Globals
@@ -37,8 +43,23 @@ sensor_msgs::Range sonarLeft;
 sensor_msgs::Range sonarCenter;
 sensor_msgs::Range sonarRight;
 USBSerial usb;
+CommandWriter commandWriter(&usb); //all commands to the arduino go through here
+float commandRate = 50; //most writes per second to the arduino, from the ~command_rate parameter
+const float commandKeepalive = 1.0; //seconds before an unchanged command is sent again
+float commandReportInterval = 60; //seconds
+boost::mutex sensorMutex; //guards the sensor messages above, written by the usb read thread
+DeviceClock deviceClock; //maps the arduino's clock onto ROS time for the sample stamps
 const int baud = 115200;
 char dataCmd[] = "d\n";
+char streamCmd[16];
+int streamRate = 0; //Hz the arduino sends data at unasked when streaming, 0 to request it every deltaTime
+const float streamTimeout = 1.0; //seconds without data before streaming is given up on
+ros::Time streamStartTime;
+ros::Time lastPacketTime;
+float readyTimeout = 10; //seconds to wait for the arduino to answer at startup, from the ~ready_timeout parameter
+const float readyPollInterval = 0.1; //seconds between data requests while waiting for it
+ros::WallTime disconnectTime; //when the arduino was lost, to measure how long recovery takes
+bool recovering = false;
 char moveCmd[16];
 char host[128];
 const float deltaTime = 0.1; //abridge's update interval
@@ -48,20 +69,11 @@ string publishedName;
 float heartbeat_publish_interval = 2;
 
 
-//PID constants and arrays
-const int histArrayLength = 1000;
-
-float velFF = 0; //velocity feed forward
-int stepV = 0; //keeps track of the point in the evArray for adding new error each update cycle.
-float evArray[histArrayLength]; //history array of previous error for (arraySize/hz) seconds (error Velocity Array)
-float velError[4] = {0,0,0,0}; //contains current velocity error and error 3 steps in the past.
-
-int stepY = 0; //keeps track of the point in the eyArray for adding new error each update cycle.
-float eyArray[histArrayLength]; //history array of previous error for (arraySize/hz) seconds (error Yaw Array)
-float yawError[4] = {0,0,0,0}; //contains current yaw error and error 3 steps in the past.
-
-float prevLin = 0;
-float prevYaw = 0;
+//Drive PID
+const float designRate = 10; //Hz the gains were tuned at, the integral is scaled so they hold at other rates
+const float integralWindow = 100; //seconds of error history summed by the integral terms
+float controlRate = 10; //Hz drive commands are expected at, from the ~control_rate parameter
+DriveController driveController(designRate, integralWindow);
 
 ros::Time prevDriveCommandUpdateTime;
 
@@ -85,24 +97,31 @@ ros::Subscriber modeSubscriber;
 //Timers
 ros::Timer publishTimer;
 ros::Timer publish_heartbeat_timer;
+ros::Timer commandReportTimer;
 
 //Callback handlers
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
+void commandReportTimerEventHandler(const ros::TimerEvent& event);
 
 int main(int argc, char **argv) {
     
     gethostname(host, sizeof (host));
     string hostname(host);
     ros::init(argc, argv, (hostname + "_ABRIDGE"));
+    ros::WallTime startupTime = ros::WallTime::now();
     
     ros::NodeHandle param("~");
     string devicePath;
     param.param("device", devicePath, string("/dev/ttyUSB0"));
-    usb.openUSBPort(devicePath, baud);
+    param.param("stream_rate", streamRate, 0);
+    param.param("control_rate", controlRate, 10.0f);
+    param.param("command_rate", commandRate, 50.0f);
+    param.param("ready_timeout", readyTimeout, 10.0f);
+    if (!usb.openUSBPort(devicePath, baud)) {
+        cout << "Waiting for " << devicePath << " to appear" << endl;
+    }
     void modeHandler(const std_msgs::UInt8::ConstPtr& message);
     
-    sleep(5);
-    
     ros::NodeHandle aNH;
     
     if (argc >= 2) {
@@ -112,6 +131,18 @@ int main(int argc, char **argv) {
         publishedName = hostname;
         cout << "No Name Selected. Default is: " << publishedName << endl;
     }
+
+    //The gains, from the abridge group of launch/rover_params.yaml (/<rover>/abridge/kpv and so on)
+    ros::NodeHandle gainParams(publishedName + "/abridge");
+    DriveController::Gains gains;
+    gainParams.param("kpv", gains.kpv, gains.kpv);
+    gainParams.param("kiv", gains.kiv, gains.kiv);
+    gainParams.param("kdv", gains.kdv, gains.kdv);
+    gainParams.param("kpy", gains.kpy, gains.kpy);
+    gainParams.param("kiy", gains.kiy, gains.kiy);
+    gainParams.param("kdy", gains.kdy, gains.kdy);
+    driveController.setGains(gains);
+    driveController.setControlRate(controlRate);
     
     fingerAnglePublish = aNH.advertise<geometry_msgs::QuaternionStamped>((publishedName + "/fingerAngle/prev_cmd"), 10);
     wristAnglePublish = aNH.advertise<geometry_msgs::QuaternionStamped>((publishedName + "/wristAngle/prev_cmd"), 10);
@@ -131,290 +162,86 @@ int main(int argc, char **argv) {
     
     publishTimer = aNH.createTimer(ros::Duration(deltaTime), serialActivityTimer);
     publish_heartbeat_timer = aNH.createTimer(ros::Duration(heartbeat_publish_interval), publishHeartBeatTimerEventHandler);
+    commandReportTimer = aNH.createTimer(ros::Duration(commandReportInterval), commandReportTimerEventHandler);
     
     imu.header.frame_id = publishedName+"/base_link";
     
     odom.header.frame_id = publishedName+"/odom";
     odom.child_frame_id = publishedName+"/base_link";
 
-    for (int i = 0; i < histArrayLength; i++)
-    {
-    evArray[i] = 0;
-    eyArray[i] = 0;
-    }
-    
+    initSonar(sonarLeft, publishedName+"/us_left_link");
+    initSonar(sonarCenter, publishedName+"/us_center_link");
+    initSonar(sonarRight, publishedName+"/us_right_link");
+
     prevDriveCommandUpdateTime = ros::Time::now();
 
+    usb.startReading(sensorPacketHandler, connectionHandler);
+    commandWriter.start(commandRate, commandKeepalive);
+
+    // Wait for the arduino to answer rather than sleeping for a fixed time.
+    // It resets when the port is opened and ignores requests while it boots,
+    // so keep asking until a valid packet comes back.
+    ros::WallTime handshakeStart = ros::WallTime::now();
+    int requests = 0;
+    bool ready = false;
+
+    while (ros::ok() && !ready && (ros::WallTime::now() - handshakeStart).toSec() < readyTimeout) {
+        commandWriter.set(CommandWriter::REQUEST, dataCmd, true);
+        requests++;
+        ready = usb.waitForPacket(readyPollInterval);
+    }
+
+    stringstream ss;
+    if (ready) {
+        ss << publishedName << " abridge ready after " << (ros::WallTime::now() - startupTime).toSec()
+           << " seconds, the arduino answered request " << requests;
+    } else {
+        ss << publishedName << " arduino did not answer within " << readyTimeout << " seconds, starting anyway";
+    }
+    logInfo(ss.str());
+
+    // ask firmware that supports it to send its sensor data without being asked
+    if (streamRate > 0) {
+        sprintf(streamCmd, "s,%d\n", streamRate);
+        commandWriter.set(CommandWriter::REQUEST, streamCmd, true);
+        streamStartTime = ros::Time::now();
+    }
+
     ros::spin();
+
+    commandWriter.stop();
+    usb.stopReading();
     
     return EXIT_SUCCESS;
 }
 
 //This command handler recives a linear velocity setpoint and a angular yaw error
 //and produces a command output for the left and right motors of the robot.
-//See the following paper for description of PID controllers.
-//Bennett, Stuart (November 1984). "Nicholas Minorsky and the automatic steering of ships". IEEE Control Systems Magazine. 4 (4): 10–15. doi:10.1109/MCS.1984.1104827. ISSN 0272-1708.
 void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message) {
-   
-  // ********************************************************* 
-  // Change these six values to tune the PID.  
-  // *********************************************************
-  float Kpv = 140; //Proportinal Velocity
-  float Kiv = 20; //Integral Velocity
-  float Kdv = 15; //Derivative Velocity
-  
-  float Kpy = 200; //Proportinal Yaw   
-  float Kiy = 15; //Inegral Yaw
-  float Kdy = 15; //Derivative Yaw
-  
-    
-  // ********************************************************  
-    
-  float hz = 10; //This is the design frequency of the PID and if the update rate in mobility is changed this will have to
-                  //change to match as well as all tuning values.
-  float linearSpeed = 0.;
-  linearSpeed = (message->linear.x); //target linear velocity in meters per second
-  yawError[0] = (message->angular.z); //angular error in radians
-
-  float xVel = odom.twist.twist.linear.x;
-  float yVel = odom.twist.twist.linear.y;
-  float vel = sqrt(xVel*xVel + yVel*yVel);
-  
-  float PV = 0; //proportional velocity output 
-  float IV = 0; //Integral velocity output
-  float DV = 0; //Derivative velocity output
-  
-  float PY = 0; //proportional yaw output 
-  float IY = 0; //Integral yaw output
-  float DY = 0; //Derivative yaw output
-  
-  float sat = 255; //Saturation point
-  float velIntegralDeadspace = 0.01;
-  float yawIntegralDeadspace = 0.1;
-  
-  
-  if (!(linearSpeed == prevLin)) //if linear velocity setpoint changes reset integral and history to zero
-  {
-     for (int i= 0; i < histArrayLength; i++)
-     {
-       evArray[i] = 0;
-     }   
-     velError[0] = 0;
-     velError[1] = 0;
-     velError[2] = 0;
-     velError[3] = 0;
-     prevLin = linearSpeed; 
-   }
-   
-  //if yaw error setpoint changes reset yaw integral and yaw-error history to zero
-  if (prevYaw > 0 && yawError[0] < 0 || prevYaw < 0 && yawError > 0) 
-  {
-     for (int i= 0; i < histArrayLength; i++)
-     {
-       eyArray[i] = 0;
-     } 
-     yawError[1] = 0;
-     yawError[2] = 0;
-     yawError[3] = 0;
-     prevYaw = yawError[0];
-  }  
-   std::string getHumanFriendlyTime();
-
-  if (currentMode == 1) //manual control
-  {
-	yawError[0] *= 255/Kpy;
-	velError[0] = linearSpeed * 255/Kpv; //scale values between -255 and 255;
-  }
-  else //auto control
-  {
-    //Feed Forward command
-    //this is a direct mapping of commanded linear velocity to a PWM (Pulse Width Modulation) value command for the motors
-    if (linearSpeed > 0.5) velFF = 255;
-    else if (linearSpeed > 0.4) velFF = 180;
-    else if (linearSpeed > 0.3) velFF = 130;
-    else if (linearSpeed > 0.2) velFF = 75;
-    else if (linearSpeed > 0.1) velFF = 40;
-    else if (linearSpeed > 0.0) velFF = 10;
-
-    velError[0] = linearSpeed - vel; //calculate the error
-  }
-  
-  
-  // ----- BEGIN PID CONTROLLER CODE -----
-
-  
-  //Velocity--------------------------
-
-  
-  //Proportional
-  PV = Kpv * ((velError[0]+velError[1])/2);  //this is the proportional output
-  if (PV > sat) //limit the max and minimum output of proportional
-  PV = sat;
-  if (PV < -sat)
-  PV = -sat; 
-  
-  //Integral
-  //only use integral when error is larger than presumed noise.
-  if (velError[0] > velIntegralDeadspace || velError[0] < -velIntegralDeadspace)
-  {
-    evArray[stepV] = velError[0]; //add error into the error Array.
-    stepV++;
-    
-    if (stepV >= histArrayLength) stepV = 0;
 
-  }//deadzone ends here use integrel even without error as we have constant motion and drag.
-    
-    float sumV= 0;
-    for (int i= 0; i < histArrayLength; i++) //sum the array to get the error over time from t = 0 to present.
-    {
-        sumV += evArray[i];
-    }
-    
-    IV = Kiv * sumV; //this is integrated output
-     
-    //anti windup 
-    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the 
-    //proportional term is less than half its saturation point.           
-    
-    //if PV is already commanding greater than half max PWM dont use the integral       
-    if (fabs(IV) > sat/2 || fabs(PV) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
-    {
-       for (int i= 0; i < histArrayLength; i++)
-        {
-           evArray[i] = 0;
-        }            
-        IV = 0;
-    }
-
-    //Derivative
-    if (!(fabs(PV) > sat/2)) 
-    {
-       //10 being the frequency of the system giving us a one second prediction base.
-       //calculates the derivative of the error using average of last 2 error values for current error
-       //and average of error 2 and 3 steps in the past as previouse error
-       DV = Kdv * ((velError[0]+velError[1])/2 - (velError[2]+velError[3])/2) * hz; 
-    }
-    velError[3] = velError[2];
-    velError[2] = velError[1];
-    velError[1] = velError[0]; //set previouse error to current error 
-    
-    float velOut = PV + IV + DV + velFF;
-    if (velOut > sat) //cap vel command
-    {
-        velOut = sat;
-    }
-    else if (velOut < -sat)
-    {
-        velOut = -sat;
-    }
-  
-    
-  //Yaw-----------------------------
-    
+  //Measured time since the previous command. The PID is scaled by it so that
+  //the gains hold whatever rate mobility sends commands at.
+  ros::Time now = ros::Time::now();
+  float dt = (now - prevDriveCommandUpdateTime).toSec();
+  prevDriveCommandUpdateTime = now;
 
-  //Proportional
-  PY = Kpy * ((yawError[0]+yawError[1])/2);  //this is the proportional output
-  if (PY > sat) //limit the max and minimum output of proportional
-  PY = sat;
-  if (PY < -sat)
-  PY = -sat; 
-  
-  //Integral
-  //only use integral when error is larger than presumed noise.
-  if (yawError[0] > yawIntegralDeadspace || yawError[0] < -yawIntegralDeadspace)
+  float xVel;
+  float yVel;
   {
-    evArray[stepV] = velError[0]; //add error into the error Array.
-    stepV++;
-    
-    if (stepY >= histArrayLength) stepY = 0;
-    
-    float sumY= 0;
-    for (int i= 0; i < histArrayLength; i++) //sum the array to get the error over time from t = 0 to present.
-    {
-        sumY += eyArray[i];
-    }
-    
-    IY = Kiy * sumY; //this is integrated output
-
-   }//deadzone ends here use integrel only with error as there is no force to disturb our heading.
-     
-
-    //anti windup 
-    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the 
-    //proportional term is less than half its saturation point.           
-    
-    //if PY is already commanding greater than half max PWM dont use the integral       
-    if (fabs(IY) > sat/2 || fabs(PY) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
-    {
-       for (int i= 0; i < histArrayLength; i++)
-        {
-           eyArray[i] = 0;
-        }            
-        IY = 0;
-    }
+    boost::mutex::scoped_lock lock(sensorMutex);
+    xVel = odom.twist.twist.linear.x;
+    yVel = odom.twist.twist.linear.y;
+  }
+  float vel = sqrt(xVel*xVel + yVel*yVel);
 
-    //Derivative
-    if (!(fabs(PY) > sat/2)) 
-    {
-       //10 being the frequency of the system giving us a one second prediction base.
-       //calculates the derivative of the error using average of last 2 error values for current error
-       //and average of error 2 and 3 steps in the past as previouse error
-       DY = Kdy * ((yawError[0]+yawError[1])/2 - (yawError[2]+yawError[3])/2) * hz; 
-    }
-    yawError[3] = yawError[2];
-    yawError[2] = yawError[1];
-    yawError[1] = yawError[0]; //set previouse error to current error 
-    
-    float yawOut = PY + IY + DY;
-    
-    //cap yaw command
-    if (yawOut > sat/2) {
-        yawOut = sat/2;
-    }
-    else if (yawOut < -sat/2) {
-        yawOut = -sat/2;
-    }
+  int left;
+  int right;
+  driveController.update(message->linear.x, message->angular.z, vel, dt, currentMode == 1, left, right);
 
-    if (linearSpeed > 0 && velOut < 0) {
-	   velOut = 0;
-	}
-    else if(linearSpeed < 0 && velOut > 0) {
-	   velOut = 0;
-	}
-	 
-    if (PY > 0 && yawOut < 0)
-	{
-	   yawOut = 0;
-	}
-    else if(PY < 0 && yawOut > 0) {
-	   yawOut = 0;
-	}
-
-
-    // ----- END PID CONTROLLER CODE -----
-
-    if (currentMode == 1) {
-	    yawOut = PY;
-	    velOut = PV;	
-  	}
-   
-   int left = velOut - yawOut;
-   int right = velOut + yawOut;
-   
-   if (left  >  sat) {left  =  sat;}
-   if (left  < -sat) {left  = -sat;}
-   if (right >  sat) {right =  sat;}
-   if (right < -sat) {right = -sat;}
-
-   if(linearSpeed == 0 && yawError[0] == 0) {
-     left = 0;
-     right = 0;
-   }
-  
-    
-    sprintf(moveCmd, "v,%d,%d\n", left, right); //format data for arduino into c string
-    usb.sendData(moveCmd);                      //send movement command to arduino over usb
-    memset(&moveCmd, '\0', sizeof (moveCmd));   //clear the movement command string
+  sprintf(moveCmd, "v,%d,%d\n", left, right); //format data for arduino into c string
+  // always written, repeats included, so a firmware that stops the motors when
+  // drive commands stop coming never sees a gap as long as the keepalive
+  commandWriter.set(CommandWriter::DRIVE, moveCmd, true); //send movement command to arduino over usb
 }
 
 
@@ -431,8 +258,7 @@ void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
   } else {
     sprintf(cmd, "f,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
-  memset(&cmd, '\0', sizeof (cmd));
+  commandWriter.set(CommandWriter::FINGER, cmd);
 }
 
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
@@ -445,87 +271,152 @@ void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
   } else {
     sprintf(cmd, "w,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
-  memset(&cmd, '\0', sizeof (cmd));
+  commandWriter.set(CommandWriter::WRIST, cmd);
 }
 
+// Requests a new set of sensor data from the arduino. The replies are
+// published by sensorPacketHandler() as they arrive.
 void serialActivityTimer(const ros::TimerEvent& e) {
-    usb.sendData(dataCmd);
-    parseData(usb.readData());
-    publishRosTopics();
+    if (streamRate > 0) {
+        ros::Time lastPacket;
+        ros::Time streamStart;
+        {
+            boost::mutex::scoped_lock lock(sensorMutex);
+            lastPacket = lastPacketTime;
+            streamStart = streamStartTime;
+        }
+
+        ros::Time now = ros::Time::now();
+        if ((now - streamStart).toSec() < streamTimeout || (now - lastPacket).toSec() < streamTimeout) {
+            return;
+        }
+
+        // the firmware does not stream, go back to asking for data
+        std_msgs::String msg;
+        msg.data = publishedName + " arduino is not streaming sensor data, requesting it instead";
+        infoLogPublisher.publish(msg);
+        streamRate = 0;
+    }
+
+    commandWriter.set(CommandWriter::REQUEST, dataCmd, true);
 }
 
-void publishRosTopics() {
-    fingerAnglePublish.publish(fingerAngle);
-    wristAnglePublish.publish(wristAngle);
-    imuPublish.publish(imu);
-    odomPublish.publish(odom);
-    sonarLeftPublish.publish(sonarLeft);
-    sonarCenterPublish.publish(sonarCenter);
-    sonarRightPublish.publish(sonarRight);
+// Called on the usb read thread for every packet as soon as it arrives
+void sensorPacketHandler(const SensorPacket& packet) {
+    boost::mutex::scoped_lock lock(sensorMutex);
+    const float* values = packet.values;
+
+    // stamp with the time the sample was taken when the packet says so
+    ros::Time received = ros::Time::now();
+    ros::Time stamp = packet.binary ? deviceClock.toRosTime(packet.deviceMillis, received) : received;
+    lastPacketTime = received;
+
+    if (recovering) {
+        recovering = false;
+
+        stringstream ss;
+        ss << publishedName << " arduino recovered, sensor data resumed " << (ros::WallTime::now() - disconnectTime).toSec()
+           << " seconds after the connection was lost";
+        logInfo(ss.str());
+    }
+
+    switch (packet.type) {
+    case PACKET_GRF:
+        fingerAngle.header.stamp = stamp;
+        fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(values[0], 0.0, 0.0);
+        fingerAnglePublish.publish(fingerAngle);
+        break;
+
+    case PACKET_GRW:
+        wristAngle.header.stamp = stamp;
+        wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(values[0], 0.0, 0.0);
+        wristAnglePublish.publish(wristAngle);
+        break;
+
+    case PACKET_IMU:
+        imu.header.stamp = stamp;
+        imu.linear_acceleration.x = values[0];
+        imu.linear_acceleration.y = 0; //values[1];
+        imu.linear_acceleration.z = values[2];
+        imu.angular_velocity.x = values[3];
+        imu.angular_velocity.y = values[4];
+        imu.angular_velocity.z = values[5];
+        imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(values[6], values[7], values[8]);
+        imuPublish.publish(imu);
+        break;
+
+    case PACKET_ODOM:
+        odom.header.stamp = stamp;
+        odom.pose.pose.position.x += values[0] / 100.0;
+        odom.pose.pose.position.y += values[1] / 100.0;
+        odom.pose.pose.position.z = 0.0;
+        odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(values[2]);
+        odom.twist.twist.linear.x = values[3] / 100.0;
+        odom.twist.twist.linear.y = values[4] / 100.0;
+        odom.twist.twist.angular.z = values[5];
+        odomPublish.publish(odom);
+        break;
+
+    case PACKET_USL:
+        sonarLeft.header.stamp = stamp;
+        sonarLeft.range = values[0] / 100.0;
+        sonarLeftPublish.publish(sonarLeft);
+        break;
+
+    case PACKET_USC:
+        sonarCenter.header.stamp = stamp;
+        sonarCenter.range = values[0] / 100.0;
+        sonarCenterPublish.publish(sonarCenter);
+        break;
+
+    case PACKET_USR:
+        sonarRight.header.stamp = stamp;
+        sonarRight.range = values[0] / 100.0;
+        sonarRightPublish.publish(sonarRight);
+        break;
+
+    default:
+        break;
+    }
 }
 
-void parseData(string str) {
-    istringstream oss(str);
-    string sentence;
-    
-    while (getline(oss, sentence, '\n')) {
-		istringstream wss(sentence);
-		string word;
-
-		vector<string> dataSet;
-		while (getline(wss, word, ',')) {
-			dataSet.push_back(word);
-		}
-
-		if (dataSet.size() >= 3 && dataSet.at(1) == "1") {
-
-            if (dataSet.at(0) == "GRF") {
-                fingerAngle.header.stamp = ros::Time::now();
-                fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
-            }
-			else if (dataSet.at(0) == "GRW") {
-				wristAngle.header.stamp = ros::Time::now();
-				wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
-			}
-			else if (dataSet.at(0) == "IMU") {
-				imu.header.stamp = ros::Time::now();
-				imu.linear_acceleration.x = atof(dataSet.at(2).c_str());
-				imu.linear_acceleration.y = 0; //atof(dataSet.at(3).c_str());
-				imu.linear_acceleration.z = atof(dataSet.at(4).c_str());
-				imu.angular_velocity.x = atof(dataSet.at(5).c_str());
-				imu.angular_velocity.y = atof(dataSet.at(6).c_str());
-				imu.angular_velocity.z = atof(dataSet.at(7).c_str());
-				imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(8).c_str()), atof(dataSet.at(9).c_str()), atof(dataSet.at(10).c_str()));
-			}
-			else if (dataSet.at(0) == "ODOM") {
-				odom.header.stamp = ros::Time::now();
-				odom.pose.pose.position.x += atof(dataSet.at(2).c_str()) / 100.0;
-				odom.pose.pose.position.y += atof(dataSet.at(3).c_str()) / 100.0;
-				odom.pose.pose.position.z = 0.0;
-				odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(atof(dataSet.at(4).c_str()));
-				odom.twist.twist.linear.x = atof(dataSet.at(5).c_str()) / 100.0;
-				odom.twist.twist.linear.y = atof(dataSet.at(6).c_str()) / 100.0;
-				odom.twist.twist.angular.z = atof(dataSet.at(7).c_str());
-			}
-			else if (dataSet.at(0) == "USL") {
-				sonarLeft.header.stamp = ros::Time::now();
-				sonarLeft.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-			else if (dataSet.at(0) == "USC") {
-				sonarCenter.header.stamp = ros::Time::now();
-				sonarCenter.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-			else if (dataSet.at(0) == "USR") {
-				sonarRight.header.stamp = ros::Time::now();
-				sonarRight.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-
-		}
-	}
+// Called on the usb read thread when the arduino is lost or found again
+void connectionHandler(bool connected) {
+    boost::mutex::scoped_lock lock(sensorMutex);
+
+    if (!connected) {
+        disconnectTime = ros::WallTime::now();
+        recovering = true;
+        logInfo(publishedName + " lost the connection to the arduino, reconnecting");
+        return;
+    }
+
+    // the arduino reset when the port was reopened, ask it to stream again
+    deviceClock.reset();
+    if (streamRate > 0) {
+        commandWriter.set(CommandWriter::REQUEST, streamCmd, true);
+        streamStartTime = ros::Time::now();
+    }
 }
 
+void logInfo(string message) {
+    ROS_INFO_STREAM(message);
+
+    std_msgs::String msg;
+    msg.data = message;
+    infoLogPublisher.publish(msg);
+}
 
+// The fields of a sonar's Range message that never change. Without
+// max_range a reading at the end of the range, where nothing was seen,
+// cannot be told from an obstacle.
+void initSonar(sensor_msgs::Range& sonar, string frame) {
+    sonar.header.frame_id = frame;
+    sonar.radiation_type = sensor_msgs::Range::ULTRASOUND;
+    sonar.field_of_view = 0.956; //radians, as in the rover models
+    sonar.min_range = 0.02;
+    sonar.max_range = 3.0;
+}
 
 void modeHandler(const std_msgs::UInt8::ConstPtr& message) {
 	currentMode = message->data;
@@ -536,3 +427,8 @@ void publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
     msg.data = "";
     heartbeatPublisher.publish(msg);
 }
+
+void commandReportTimerEventHandler(const ros::TimerEvent&) {
+    ROS_INFO_STREAM(publishedName << " " << commandWriter.summary());
+    commandWriter.resetStats();
+}
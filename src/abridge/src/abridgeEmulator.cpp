@@ -0,0 +1,421 @@
+#include <ros/ros.h>
+
+//ROS messages
+#include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/Range.h>
+
+#include <boost/thread.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+//Package include
+#include <frameParser.h>
+
+/*
+ * Stands in for the arduino so abridge can be run and measured without
+ * hardware. A pseudo terminal is created and linked to ~link (default
+ * /tmp/abridge_emulator); start abridge with _device:=<that path>.
+ *
+ * Sensor data is played back from ~recording, or generated at ~sensor_rate
+ * Hz if no recording is given, and sped up by ~rate (1 to 100). It is sent
+ * as ASCII lines, or as binary frames with ~binary set. The recording is a
+ * text file with one packet per line, the time in seconds since the start
+ * followed by the arduino's ASCII line:
+ *
+ *   0.100 IMU,1,0.01,0,9.8,0,0,0.02,0,0,1.57
+ *   0.100 USL,1,300
+ *
+ * Commands sent by abridge are counted and, with ~command_log set, written to
+ * that file with the time they arrived. Every ~report_interval seconds and on
+ * exit the emulator logs its throughput and the latency from a packet's last
+ * byte being written to abridge publishing it, taken as the time to the
+ * message following the most recent packet of its type.
+ *
+ * usage: rosrun abridge abridge_emulator <rover name> [_recording:=file] [_rate:=10]
+ */
+
+using namespace std;
+
+struct RecordedPacket {
+    double time; // seconds since the start of the recording
+    SensorPacket packet;
+};
+
+struct LatencyStats {
+    vector<double> samples;
+    ros::WallTime lastWritten;
+    bool waiting; // a packet has been written that no message has answered yet
+};
+
+// Emulator functions
+bool openPty(string linkPath);
+bool loadRecording(string path);
+void generateRecording(double duration, double sensorRate);
+void playbackLoop();
+void readCommands();
+void report();
+void messageReceived(SensorPacketType type);
+
+void imuHandler(const sensor_msgs::Imu::ConstPtr& message);
+void odomHandler(const nav_msgs::Odometry::ConstPtr& message);
+void sonarLeftHandler(const sensor_msgs::Range::ConstPtr& message);
+void sonarCenterHandler(const sensor_msgs::Range::ConstPtr& message);
+void sonarRightHandler(const sensor_msgs::Range::ConstPtr& message);
+void reportTimerEventHandler(const ros::WallTimerEvent& event);
+
+// Globals
+int ptyMaster = -1;
+string ptyLink;
+vector<RecordedPacket> recording;
+double playbackRate = 1;
+bool loopPlayback = true;
+bool binaryFrames = false;
+ofstream commandLog;
+char commandLine[128];
+int commandLineLength = 0;
+
+boost::mutex statsMutex;
+LatencyStats latency[PACKET_GRW + 1];
+unsigned long packetsWritten = 0;
+unsigned long bytesWritten = 0;
+unsigned long commandsReceived = 0;
+unsigned long commandCounts[128]; // by first character of the command
+ros::WallTime reportStartTime;
+double reportInterval = 10; // seconds
+
+int main(int argc, char **argv) {
+
+    char host[128];
+    gethostname(host, sizeof (host));
+    string publishedName(host);
+
+    ros::init(argc, argv, "ABRIDGE_EMULATOR");
+
+    if (argc >= 2) {
+        publishedName = argv[1];
+    }
+
+    ros::NodeHandle eNH;
+    ros::NodeHandle param("~");
+
+    string recordingPath;
+    string commandLogPath;
+    double sensorRate;
+    param.param("link", ptyLink, string("/tmp/abridge_emulator"));
+    param.param("recording", recordingPath, string(""));
+    param.param("rate", playbackRate, 1.0);
+    param.param("loop", loopPlayback, true);
+    param.param("binary", binaryFrames, false);
+    param.param("sensor_rate", sensorRate, 10.0);
+    param.param("command_log", commandLogPath, string(""));
+    param.param("report_interval", reportInterval, 10.0);
+
+    if (playbackRate < 1) playbackRate = 1;
+    if (playbackRate > 100) playbackRate = 100;
+
+    if (!recordingPath.empty()) {
+        if (!loadRecording(recordingPath)) return EXIT_FAILURE;
+    } else {
+        generateRecording(10, sensorRate);
+    }
+
+    if (!commandLogPath.empty()) {
+        commandLog.open(commandLogPath.c_str());
+    }
+
+    if (!openPty(ptyLink)) return EXIT_FAILURE;
+
+    cout << "Emulating " << publishedName << "'s arduino on " << ptyLink << ", playing " << recording.size()
+         << " packets at " << playbackRate << "x as " << (binaryFrames ? "binary frames" : "ASCII lines") << endl;
+
+    ros::Subscriber imuSubscriber = eNH.subscribe((publishedName + "/imu"), 100, imuHandler);
+    ros::Subscriber odomSubscriber = eNH.subscribe((publishedName + "/odom"), 100, odomHandler);
+    ros::Subscriber sonarLeftSubscriber = eNH.subscribe((publishedName + "/sonarLeft"), 100, sonarLeftHandler);
+    ros::Subscriber sonarCenterSubscriber = eNH.subscribe((publishedName + "/sonarCenter"), 100, sonarCenterHandler);
+    ros::Subscriber sonarRightSubscriber = eNH.subscribe((publishedName + "/sonarRight"), 100, sonarRightHandler);
+
+    ros::WallTimer reportTimer = eNH.createWallTimer(ros::WallDuration(reportInterval), reportTimerEventHandler);
+    reportStartTime = ros::WallTime::now();
+
+    boost::thread playbackThread(playbackLoop);
+
+    ros::spin();
+
+    playbackThread.join();
+    report();
+
+    close(ptyMaster);
+    unlink(ptyLink.c_str());
+
+    return EXIT_SUCCESS;
+}
+
+// Creates the pseudo terminal and links ptyLink to its slave end
+bool openPty(string linkPath) {
+    ptyMaster = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (ptyMaster < 0 || grantpt(ptyMaster) != 0 || unlockpt(ptyMaster) != 0) {
+        cout << "Creating pseudo terminal FAILED " << strerror(errno) << endl;
+        return false;
+    }
+
+    // raw mode so nothing is echoed or translated, like a real serial port
+    struct termios ioStruct;
+    tcgetattr(ptyMaster, &ioStruct);
+    cfmakeraw(&ioStruct);
+    tcsetattr(ptyMaster, TCSANOW, &ioStruct);
+
+    unlink(linkPath.c_str());
+    if (symlink(ptsname(ptyMaster), linkPath.c_str()) != 0) {
+        cout << "Linking " << linkPath << " to " << ptsname(ptyMaster) << " FAILED " << strerror(errno) << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool loadRecording(string path) {
+    ifstream file(path.c_str());
+    if (!file) {
+        cout << "Opening recording " << path << " FAILED" << endl;
+        return false;
+    }
+
+    FrameParser parser;
+    string line;
+
+    while (getline(file, line)) {
+        istringstream fields(line);
+        RecordedPacket recorded;
+        string data;
+
+        if (!(fields >> recorded.time >> data)) continue;
+
+        data += '\n';
+        parser.feed(data.c_str(), data.size());
+        if (parser.next(recorded.packet)) {
+            recording.push_back(recorded);
+        }
+    }
+
+    if (recording.empty()) {
+        cout << "No packets in recording " << path << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// A rover driving slowly in a circle, for when there is no recording
+void generateRecording(double duration, double sensorRate) {
+    for (int i = 0; i < duration * sensorRate; i++) {
+        double time = i / sensorRate;
+        double yaw = fmod(0.2 * time, 2 * M_PI) - M_PI;
+        RecordedPacket recorded;
+        SensorPacket& packet = recorded.packet;
+        recorded.time = time;
+        packet.binary = false;
+        packet.deviceMillis = 0;
+
+        packet.type = PACKET_IMU;
+        packet.valueCount = FrameParser::valueCount(PACKET_IMU);
+        float imu[] = {0.01, 0, 9.8, 0, 0, 0.2, 0, 0, (float)yaw};
+        copy(imu, imu + 9, packet.values);
+        recording.push_back(recorded);
+
+        packet.type = PACKET_ODOM;
+        packet.valueCount = FrameParser::valueCount(PACKET_ODOM);
+        float odom[] = {(float)(2 * cos(yaw) / sensorRate), (float)(2 * sin(yaw) / sensorRate), (float)yaw, 20, 0, 0.2};
+        copy(odom, odom + 6, packet.values);
+        recording.push_back(recorded);
+
+        SensorPacketType sonars[] = {PACKET_USL, PACKET_USC, PACKET_USR};
+        for (int j = 0; j < 3; j++) {
+            packet.type = sonars[j];
+            packet.valueCount = 1;
+            packet.values[0] = 300 - 50 * j;
+            recording.push_back(recorded);
+        }
+    }
+}
+
+// Runs on its own thread. Writes the recording to the pty on schedule and
+// collects the commands abridge writes back in between.
+void playbackLoop() {
+    ros::WallTime start = ros::WallTime::now();
+    double offset = 0; // recording time at which the current pass started
+    size_t next = 0;
+
+    while (ros::ok()) {
+        if (next >= recording.size()) {
+            if (!loopPlayback) {
+                ros::shutdown();
+                break;
+            }
+
+            offset += recording.back().time + 1 / playbackRate;
+            next = 0;
+        }
+
+        const RecordedPacket& recorded = recording[next];
+        ros::WallTime due = start + ros::WallDuration((offset + recorded.time) / playbackRate);
+
+        // wait for the packet to be due, reading commands meanwhile
+        double wait = (due - ros::WallTime::now()).toSec();
+        struct pollfd pollDescriptor;
+        pollDescriptor.fd = ptyMaster;
+        pollDescriptor.events = POLLIN;
+
+        int ready = poll(&pollDescriptor, 1, wait > 0 ? ceil(wait * 1000) : 0);
+
+        // the master hangs up while nobody has the port open, abridge has not
+        // started yet so keep time without sending anything
+        bool connected = !(ready > 0 && (pollDescriptor.revents & POLLHUP));
+
+        if (ready > 0 && connected) {
+            readCommands();
+        } else if (!connected && wait > 0) {
+            ros::WallDuration(wait).sleep();
+        }
+
+        if (ros::WallTime::now() < due) continue;
+
+        if (!connected) {
+            next++;
+            continue;
+        }
+
+        char data[128];
+        int length;
+
+        if (binaryFrames) {
+            SensorPacket packet = recorded.packet;
+            packet.deviceMillis = (ros::WallTime::now() - start).toSec() * 1000;
+            length = FrameParser::encode(packet, (unsigned char*)data, sizeof (data));
+        } else {
+            const char* names[] = {"", "IMU", "ODOM", "USL", "USC", "USR", "GRF", "GRW"};
+            length = snprintf(data, sizeof (data), "%s,1", names[recorded.packet.type]);
+            for (int i = 0; i < recorded.packet.valueCount; i++) {
+                length += snprintf(data + length, sizeof (data) - length, ",%g", recorded.packet.values[i]);
+            }
+            length += snprintf(data + length, sizeof (data) - length, "\n");
+        }
+
+        if (write(ptyMaster, data, length) == length) {
+            boost::mutex::scoped_lock lock(statsMutex);
+            LatencyStats& stats = latency[recorded.packet.type];
+            stats.lastWritten = ros::WallTime::now();
+            stats.waiting = true;
+            packetsWritten++;
+            bytesWritten += length;
+        }
+
+        next++;
+    }
+}
+
+void readCommands() {
+    char data[256];
+    int length = read(ptyMaster, data, sizeof (data));
+
+    for (int i = 0; i < length; i++) {
+        if (data[i] != '\n') {
+            if (commandLineLength < sizeof (commandLine) - 1) {
+                commandLine[commandLineLength++] = data[i];
+            }
+            continue;
+        }
+
+        commandLine[commandLineLength] = '\0';
+
+        if (commandLog.is_open()) {
+            commandLog << ros::WallTime::now() << " " << commandLine << "\n";
+        }
+
+        boost::mutex::scoped_lock lock(statsMutex);
+        commandsReceived++;
+        commandCounts[commandLine[0] & 0x7F]++;
+        commandLineLength = 0;
+    }
+}
+
+void messageReceived(SensorPacketType type) {
+    boost::mutex::scoped_lock lock(statsMutex);
+    LatencyStats& stats = latency[type];
+
+    if (stats.waiting) {
+        stats.samples.push_back((ros::WallTime::now() - stats.lastWritten).toSec());
+        stats.waiting = false;
+    }
+}
+
+void report() {
+    boost::mutex::scoped_lock lock(statsMutex);
+
+    double elapsed = (ros::WallTime::now() - reportStartTime).toSec();
+    const char* names[] = {"", "imu", "odom", "sonarLeft", "sonarCenter", "sonarRight"};
+
+    stringstream ss;
+    ss << "Emulator: wrote " << packetsWritten << " packets (" << packetsWritten / elapsed << "/s, "
+       << bytesWritten / elapsed << " bytes/s), received " << commandsReceived << " commands ("
+       << commandCounts['v'] << " drive, " << commandCounts['f'] << " finger, " << commandCounts['w'] << " wrist, "
+       << commandCounts['d'] << " data requests)";
+
+    for (int type = PACKET_IMU; type <= PACKET_USR; type++) {
+        vector<double>& samples = latency[type].samples;
+        ss << "\n  " << names[type] << ": " << samples.size() << " messages";
+
+        if (!samples.empty()) {
+            sort(samples.begin(), samples.end());
+            ss << ", write to publish p50=" << samples[samples.size() / 2] * 1e3 << "ms"
+               << " p99=" << samples[samples.size() * 99 / 100] * 1e3 << "ms"
+               << " max=" << samples.back() * 1e3 << "ms";
+        }
+
+        samples.clear();
+    }
+
+    ROS_INFO_STREAM(ss.str());
+
+    packetsWritten = 0;
+    bytesWritten = 0;
+    commandsReceived = 0;
+    memset(commandCounts, 0, sizeof (commandCounts));
+    reportStartTime = ros::WallTime::now();
+}
+
+void imuHandler(const sensor_msgs::Imu::ConstPtr& message) {
+    messageReceived(PACKET_IMU);
+}
+
+void odomHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    messageReceived(PACKET_ODOM);
+}
+
+void sonarLeftHandler(const sensor_msgs::Range::ConstPtr& message) {
+    messageReceived(PACKET_USL);
+}
+
+void sonarCenterHandler(const sensor_msgs::Range::ConstPtr& message) {
+    messageReceived(PACKET_USC);
+}
+
+void sonarRightHandler(const sensor_msgs::Range::ConstPtr& message) {
+    messageReceived(PACKET_USR);
+}
+
+void reportTimerEventHandler(const ros::WallTimerEvent&) {
+    report();
+}
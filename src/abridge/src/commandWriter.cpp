@@ -0,0 +1,173 @@
+#include "commandWriter.h"
+
+#include <sstream>
+
+CommandWriter::CommandWriter(USBSerial* usb) {
+    this->usb = usb;
+    running = false;
+    minInterval = 0;
+    keepaliveInterval = 0;
+
+    for (int i = 0; i < SLOT_COUNT; i++) {
+        slots[i].length = 0;
+        slots[i].pending = false;
+        slots[i].sentLength = 0;
+    }
+
+    resetStats();
+}
+
+CommandWriter::~CommandWriter() {
+    stop();
+}
+
+void CommandWriter::start(float maxRate, float keepaliveInterval) {
+    stop();
+
+    minInterval = 1.0 / maxRate;
+    this->keepaliveInterval = keepaliveInterval;
+    running = true;
+    writeThread = boost::thread(&CommandWriter::writeLoop, this);
+}
+
+void CommandWriter::stop() {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        running = false;
+    }
+    wakeup.notify_all();
+
+    if (writeThread.joinable()) {
+        writeThread.join();
+    }
+}
+
+void CommandWriter::set(Slot slot, const char* command, bool always) {
+    int length = strlen(command);
+    if (length >= maxCommandLength) length = maxCommandLength - 1;
+
+    ros::WallTime now = ros::WallTime::now();
+
+    boost::mutex::scoped_lock lock(mutex);
+    CommandSlot& commandSlot = slots[slot];
+
+    bool unchanged = length == commandSlot.sentLength && memcmp(command, commandSlot.sent, length) == 0;
+    if (!always && unchanged && (now - commandSlot.lastSent).toSec() < keepaliveInterval) {
+        // the arduino already has this, drop anything different still waiting
+        commandSlot.pending = false;
+        duplicates++;
+        return;
+    }
+
+    memcpy(commandSlot.command, command, length);
+    commandSlot.length = length;
+
+    if (!commandSlot.pending) {
+        commandSlot.pending = true;
+        commandSlot.queued = now;
+    }
+
+    wakeup.notify_one();
+}
+
+// Runs on its own thread
+void CommandWriter::writeLoop() {
+    char batch[SLOT_COUNT * maxCommandLength];
+
+    boost::mutex::scoped_lock lock(mutex);
+
+    while (running) {
+        bool pending = false;
+        for (int i = 0; i < SLOT_COUNT; i++) {
+            pending = pending || slots[i].pending;
+        }
+
+        if (!pending) {
+            wakeup.wait(lock);
+            continue;
+        }
+
+        // keep to the rate limit, commands arriving meanwhile join this write
+        double sinceLastWrite = (ros::WallTime::now() - lastWrite).toSec();
+        if (sinceLastWrite < minInterval) {
+            lock.unlock();
+            ros::WallDuration(minInterval - sinceLastWrite).sleep();
+            lock.lock();
+            continue;
+        }
+
+        ros::WallTime now = ros::WallTime::now();
+        int length = 0;
+        bool written[SLOT_COUNT];
+
+        for (int i = 0; i < SLOT_COUNT; i++) {
+            CommandSlot& slot = slots[i];
+            written[i] = slot.pending;
+            if (!slot.pending) continue;
+
+            memcpy(batch + length, slot.command, slot.length);
+            length += slot.length;
+
+            memcpy(slot.sent, slot.command, slot.length);
+            slot.sentLength = slot.length;
+            slot.lastSent = now;
+            slot.pending = false;
+
+            double latency = (now - slot.queued).toSec();
+            totalLatency += latency;
+            if (latency > maxLatency) maxLatency = latency;
+            commands++;
+        }
+
+        writes++;
+        bytes += length;
+        lastWrite = now;
+
+        // set() can carry on filling the slots while this is written
+        lock.unlock();
+        bool sent = usb->sendData(batch, length);
+        lock.lock();
+
+        if (!sent) {
+            // the arduino may not have these, so nothing is a duplicate of
+            // them, and a slot not replaced meanwhile is written again
+            failedWrites++;
+            for (int i = 0; i < SLOT_COUNT; i++) {
+                if (!written[i]) continue;
+
+                CommandSlot& slot = slots[i];
+                slot.sentLength = 0;
+                if (!slot.pending) {
+                    slot.pending = true;
+                    slot.queued = now;
+                }
+            }
+        }
+    }
+}
+
+std::string CommandWriter::summary() {
+    boost::mutex::scoped_lock lock(mutex);
+
+    std::stringstream ss;
+    ss << "serial commands: " << commands << " sent in " << writes << " writes (" << bytes << " bytes), "
+       << duplicates << " duplicates dropped, " << failedWrites << " failed writes";
+
+    if (commands > 0) {
+        ss << ", queued mean=" << totalLatency / commands * 1e3 << "ms max=" << maxLatency * 1e3 << "ms";
+    }
+
+    return ss.str();
+}
+
+void CommandWriter::resetStats() {
+    boost::mutex::scoped_lock lock(mutex);
+
+    commands = 0;
+    duplicates = 0;
+    writes = 0;
+    failedWrites = 0;
+    bytes = 0;
+    totalLatency = 0;
+    maxLatency = 0;
+}
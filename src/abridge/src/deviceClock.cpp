@@ -0,0 +1,48 @@
+#include "deviceClock.h"
+
+const double DeviceClock::maxDrift = 0.005;
+
+DeviceClock::DeviceClock() {
+    reset();
+}
+
+void DeviceClock::reset() {
+    initialized = false;
+    lastDeviceMillis = 0;
+    wraps = 0;
+    offset = 0;
+    lastDelay = 0;
+}
+
+ros::Time DeviceClock::toRosTime(uint32_t deviceMillis, ros::Time received) {
+    if (initialized && deviceMillis < lastDeviceMillis) {
+        if (lastDeviceMillis - deviceMillis > 0x80000000u) {
+            // the 32 bit millisecond counter wrapped, about every 49 days
+            wraps++;
+        } else {
+            // the clock went backwards, the arduino has been reset
+            reset();
+        }
+    }
+
+    double deviceTime = ((wraps << 32) + deviceMillis) / 1000.0;
+    double candidate = received.toSec() - deviceTime;
+
+    if (!initialized || candidate < offset) {
+        offset = candidate;
+    } else {
+        double allowed = maxDrift * (received - lastUpdate).toSec();
+        offset += candidate - offset < allowed ? candidate - offset : allowed;
+    }
+
+    initialized = true;
+    lastDeviceMillis = deviceMillis;
+    lastUpdate = received;
+
+    ros::Time sampleTime(deviceTime + offset);
+    if (sampleTime > received) sampleTime = received;
+
+    lastDelay = (received - sampleTime).toSec();
+
+    return sampleTime;
+}
@@ -0,0 +1,249 @@
+#include "driveController.h"
+
+#include <cmath>
+
+DriveController::Gains::Gains() {
+    kpv = 140;
+    kiv = 20;
+    kdv = 15;
+    kpy = 200;
+    kiy = 15;
+    kdy = 15;
+}
+
+DriveController::DriveController(float designRate, float integralWindow) :
+    velIntegral(integralWindow * designRate),
+    yawIntegral(integralWindow * designRate) {
+    this->designRate = designRate;
+    this->integralWindow = integralWindow;
+    velFF = 0;
+    prevLin = 0;
+    prevYaw = 0;
+
+    for (int i = 0; i < 4; i++) {
+        velError[i] = 0;
+        yawError[i] = 0;
+    }
+
+    setControlRate(designRate);
+}
+
+void DriveController::setControlRate(float controlRate) {
+    // one integral slot per drive command, covering integralWindow seconds
+    velIntegral.setLength(integralWindow * controlRate);
+    yawIntegral.setLength(integralWindow * controlRate);
+
+    // a missed command or a burst of them should not throw the PID off
+    minInterval = 0.25 / controlRate;
+    maxInterval = 4 / controlRate;
+}
+
+//See the following paper for description of PID controllers.
+//Bennett, Stuart (November 1984). "Nicholas Minorsky and the automatic steering of ships". IEEE Control Systems Magazine. 4 (4): 10–15. doi:10.1109/MCS.1984.1104827. ISSN 0272-1708.
+void DriveController::update(float linearSpeed, float yawErr, float vel, float dt, bool manual, int& left, int& right) {
+
+  if (dt < minInterval) dt = minInterval;
+  if (dt > maxInterval) dt = maxInterval;
+
+  yawError[0] = yawErr; //angular error in radians
+
+  float PV = 0; //proportional velocity output
+  float IV = 0; //Integral velocity output
+  float DV = 0; //Derivative velocity output
+
+  float PY = 0; //proportional yaw output
+  float IY = 0; //Integral yaw output
+  float DY = 0; //Derivative yaw output
+
+  float sat = 255; //Saturation point
+  float velIntegralDeadspace = 0.01;
+  float yawIntegralDeadspace = 0.1;
+
+
+  if (!(linearSpeed == prevLin)) //if linear velocity setpoint changes reset integral and history to zero
+  {
+     velIntegral.reset();
+     velError[0] = 0;
+     velError[1] = 0;
+     velError[2] = 0;
+     velError[3] = 0;
+     prevLin = linearSpeed;
+   }
+
+  //if yaw error setpoint changes reset yaw integral and yaw-error history to zero
+  if (prevYaw > 0 && yawError[0] < 0 || prevYaw < 0 && yawError[0] > 0)
+  {
+     yawIntegral.reset();
+     yawError[1] = 0;
+     yawError[2] = 0;
+     yawError[3] = 0;
+  }
+  prevYaw = yawError[0];
+
+  if (manual) //manual control
+  {
+	yawError[0] *= 255/gains.kpy;
+	velError[0] = linearSpeed * 255/gains.kpv; //scale values between -255 and 255;
+  }
+  else //auto control
+  {
+    //Feed Forward command
+    //this is a direct mapping of commanded linear velocity to a PWM (Pulse Width Modulation) value command for the motors
+    if (linearSpeed > 0.5) velFF = 255;
+    else if (linearSpeed > 0.4) velFF = 180;
+    else if (linearSpeed > 0.3) velFF = 130;
+    else if (linearSpeed > 0.2) velFF = 75;
+    else if (linearSpeed > 0.1) velFF = 40;
+    else if (linearSpeed > 0.0) velFF = 10;
+
+    velError[0] = linearSpeed - vel; //calculate the error
+  }
+
+
+  // ----- BEGIN PID CONTROLLER CODE -----
+
+
+  //Velocity--------------------------
+
+
+  //Proportional
+  PV = gains.kpv * ((velError[0]+velError[1])/2);  //this is the proportional output
+  if (PV > sat) //limit the max and minimum output of proportional
+  PV = sat;
+  if (PV < -sat)
+  PV = -sat;
+
+  //Integral
+  //only use integral when error is larger than presumed noise.
+  if (velError[0] > velIntegralDeadspace || velError[0] < -velIntegralDeadspace)
+  {
+    velIntegral.add(velError[0] * dt * designRate); //add error into the error history, weighted by how long it applied
+
+  }//deadzone ends here use integrel even without error as we have constant motion and drag.
+
+    IV = gains.kiv * velIntegral.getSum(); //this is integrated output, the error over the window up to the present
+
+    //anti windup
+    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the
+    //proportional term is less than half its saturation point.
+
+    //if PV is already commanding greater than half max PWM dont use the integral
+    if (fabs(IV) > sat/2 || fabs(PV) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
+    {
+        velIntegral.reset();
+        IV = 0;
+    }
+
+    //Derivative
+    if (!(fabs(PV) > sat/2))
+    {
+       //dividing by the measured interval gives us a one second prediction base at any rate.
+       //calculates the derivative of the error using average of last 2 error values for current error
+       //and average of error 2 and 3 steps in the past as previouse error
+       DV = gains.kdv * ((velError[0]+velError[1])/2 - (velError[2]+velError[3])/2) / dt;
+    }
+    velError[3] = velError[2];
+    velError[2] = velError[1];
+    velError[1] = velError[0]; //set previouse error to current error
+
+    float velOut = PV + IV + DV + velFF;
+    if (velOut > sat) //cap vel command
+    {
+        velOut = sat;
+    }
+    else if (velOut < -sat)
+    {
+        velOut = -sat;
+    }
+
+
+  //Yaw-----------------------------
+
+
+  //Proportional
+  PY = gains.kpy * ((yawError[0]+yawError[1])/2);  //this is the proportional output
+  if (PY > sat) //limit the max and minimum output of proportional
+  PY = sat;
+  if (PY < -sat)
+  PY = -sat;
+
+  //Integral
+  //only use integral when error is larger than presumed noise.
+  if (yawError[0] > yawIntegralDeadspace || yawError[0] < -yawIntegralDeadspace)
+  {
+    yawIntegral.add(yawError[0] * dt * designRate); //add error into the error history, weighted by how long it applied
+
+    IY = gains.kiy * yawIntegral.getSum(); //this is integrated output, the error over the window up to the present
+
+   }//deadzone ends here use integrel only with error as there is no force to disturb our heading.
+
+
+    //anti windup
+    //anti windup reduces overshoot by limiting the acting time of the integral to areas where the
+    //proportional term is less than half its saturation point.
+
+    //if PY is already commanding greater than half max PWM dont use the integral
+    if (fabs(IY) > sat/2 || fabs(PY) > sat/2) //reset the integral to 0 if it hits its cap of half max PWM
+    {
+        yawIntegral.reset();
+        IY = 0;
+    }
+
+    //Derivative
+    if (!(fabs(PY) > sat/2))
+    {
+       //dividing by the measured interval gives us a one second prediction base at any rate.
+       //calculates the derivative of the error using average of last 2 error values for current error
+       //and average of error 2 and 3 steps in the past as previouse error
+       DY = gains.kdy * ((yawError[0]+yawError[1])/2 - (yawError[2]+yawError[3])/2) / dt;
+    }
+    yawError[3] = yawError[2];
+    yawError[2] = yawError[1];
+    yawError[1] = yawError[0]; //set previouse error to current error
+
+    float yawOut = PY + IY + DY;
+
+    //cap yaw command
+    if (yawOut > sat/2) {
+        yawOut = sat/2;
+    }
+    else if (yawOut < -sat/2) {
+        yawOut = -sat/2;
+    }
+
+    if (linearSpeed > 0 && velOut < 0) {
+	   velOut = 0;
+	}
+    else if(linearSpeed < 0 && velOut > 0) {
+	   velOut = 0;
+	}
+
+    if (PY > 0 && yawOut < 0)
+	{
+	   yawOut = 0;
+	}
+    else if(PY < 0 && yawOut > 0) {
+	   yawOut = 0;
+	}
+
+
+    // ----- END PID CONTROLLER CODE -----
+
+    if (manual) {
+	    yawOut = PY;
+	    velOut = PV;
+  	}
+
+   left = velOut - yawOut;
+   right = velOut + yawOut;
+
+   if (left  >  sat) {left  =  sat;}
+   if (left  < -sat) {left  = -sat;}
+   if (right >  sat) {right =  sat;}
+   if (right < -sat) {right = -sat;}
+
+   if(linearSpeed == 0 && yawError[0] == 0) {
+     left = 0;
+     right = 0;
+   }
+}
@@ -0,0 +1,275 @@
+#include "frameParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct AsciiTag {
+    const char* name;
+    SensorPacketType type;
+};
+
+static const AsciiTag asciiTags[] = {
+    {"IMU", PACKET_IMU},
+    {"ODOM", PACKET_ODOM},
+    {"USL", PACKET_USL},
+    {"USC", PACKET_USC},
+    {"USR", PACKET_USR},
+    {"GRF", PACKET_GRF},
+    {"GRW", PACKET_GRW}
+};
+
+static const int asciiTagCount = sizeof(asciiTags) / sizeof(asciiTags[0]);
+
+FrameParser::FrameParser() {
+    binaryFrames = 0;
+    asciiLines = 0;
+    crcErrors = 0;
+    discardedBytes = 0;
+    overflowBytes = 0;
+}
+
+size_t FrameParser::feed(const char* data, size_t length) {
+    size_t dropped = length - buffer.write(data, length);
+    overflowBytes += dropped;
+    return dropped;
+}
+
+bool FrameParser::next(SensorPacket& packet) {
+    while (!buffer.empty()) {
+        int result;
+
+        if (buffer.peek(0) == syncByte1) {
+            result = nextBinary(packet);
+        } else {
+            result = nextAscii(packet);
+        }
+
+        if (result > 0) return true;
+        if (result == 0) return false;
+        // something was discarded, try again with what is left
+    }
+
+    return false;
+}
+
+void FrameParser::reset() {
+    buffer.clear();
+}
+
+int FrameParser::nextBinary(SensorPacket& packet) {
+    if (buffer.size() < headerSize) return 0;
+
+    size_t payloadSize = buffer.peek(4);
+
+    if (buffer.peek(1) != syncByte2 || buffer.peek(2) != protocolVersion || payloadSize > maxPayloadSize) {
+        // not the start of a frame, skip the sync byte and look again
+        buffer.consume(1);
+        discardedBytes++;
+        return -1;
+    }
+
+    size_t frameSize = headerSize + payloadSize + crcSize;
+    if (buffer.size() < frameSize) return 0;
+
+    // the frame is at most a few dozen bytes, copy it out so it can be read
+    // without worrying about the buffer wrapping around
+    unsigned char frame[headerSize + maxPayloadSize + crcSize];
+    for (size_t i = 0; i < frameSize; i++) {
+        frame[i] = buffer.peek(i);
+    }
+
+    uint16_t expectedCrc = frame[frameSize - 2] | (frame[frameSize - 1] << 8);
+    if (crc16(frame + 2, frameSize - 2 - crcSize) != expectedCrc) {
+        crcErrors++;
+        buffer.consume(1);
+        discardedBytes++;
+        return -1;
+    }
+
+    buffer.consume(frameSize);
+
+    SensorPacketType type = (SensorPacketType)frame[3];
+    int count = valueCount(type);
+    if (count == 0 || payloadSize != 4 + 4 * (size_t)count) {
+        // intact frame of a type or size this version does not understand
+        discardedBytes += frameSize;
+        return -1;
+    }
+
+    const unsigned char* payload = frame + headerSize;
+
+    packet.type = type;
+    packet.binary = true;
+    packet.deviceMillis = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+    packet.valueCount = count;
+
+    for (int i = 0; i < count; i++) {
+        const unsigned char* bytes = payload + 4 + 4 * i;
+        uint32_t raw = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+        memcpy(&packet.values[i], &raw, sizeof(float));
+    }
+
+    binaryFrames++;
+    return 1;
+}
+
+int FrameParser::nextAscii(SensorPacket& packet) {
+    size_t length = 0;
+
+    while (length < buffer.size() && length <= maxLineLength) {
+        unsigned char c = buffer.peek(length);
+
+        if (c == '\n') break;
+
+        if (c == syncByte1) {
+            // a binary frame interrupted this line, drop the partial line
+            buffer.consume(length);
+            discardedBytes += length;
+            return -1;
+        }
+
+        if ((c < ' ' && c != '\r') || c > '~') {
+            // lines are printable text, drop everything up to this byte
+            buffer.consume(length + 1);
+            discardedBytes += length + 1;
+            return -1;
+        }
+
+        length++;
+    }
+
+    if (length > maxLineLength) {
+        // no line is this long, this is noise
+        buffer.consume(length);
+        discardedBytes += length;
+        return -1;
+    }
+
+    // wait for the end of the line
+    if (length == buffer.size()) return 0;
+
+    for (size_t i = 0; i < length; i++) {
+        line[i] = buffer.peek(i);
+    }
+    line[length] = '\0';
+    buffer.consume(length + 1);
+
+    if (length > 0 && line[length - 1] == '\r') {
+        line[length - 1] = '\0';
+    }
+
+    if (!parseLine(line, packet)) return -1;
+
+    asciiLines++;
+    return 1;
+}
+
+// Parses "TAG,1,v1,v2,..." in place. Lines whose valid flag is not 1, with an
+// unknown tag or with too few values are ignored like they always have been.
+bool FrameParser::parseLine(char* line, SensorPacket& packet) {
+    char* fields[2 + SensorPacket::maxValues];
+    int fieldCount = 0;
+
+    char* field = line;
+    while (fieldCount < 2 + SensorPacket::maxValues) {
+        fields[fieldCount++] = field;
+
+        char* comma = strchr(field, ',');
+        if (comma == NULL) break;
+
+        *comma = '\0';
+        field = comma + 1;
+    }
+
+    if (fieldCount < 3 || strcmp(fields[1], "1") != 0) return false;
+
+    SensorPacketType type = PACKET_NONE;
+    for (int i = 0; i < asciiTagCount; i++) {
+        if (strcmp(fields[0], asciiTags[i].name) == 0) {
+            type = asciiTags[i].type;
+            break;
+        }
+    }
+
+    int count = valueCount(type);
+    if (count == 0 || fieldCount - 2 < count) return false;
+
+    packet.type = type;
+    packet.binary = false;
+    packet.deviceMillis = 0;
+    packet.valueCount = count;
+
+    for (int i = 0; i < count; i++) {
+        packet.values[i] = strtof(fields[2 + i], NULL);
+    }
+
+    return true;
+}
+
+int FrameParser::valueCount(SensorPacketType type) {
+    switch (type) {
+    case PACKET_IMU:
+        return 9;
+    case PACKET_ODOM:
+        return 6;
+    case PACKET_USL:
+    case PACKET_USC:
+    case PACKET_USR:
+    case PACKET_GRF:
+    case PACKET_GRW:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+size_t FrameParser::encode(const SensorPacket& packet, unsigned char* out, size_t outSize) {
+    int count = valueCount(packet.type);
+    size_t payloadSize = 4 + 4 * count;
+    size_t frameSize = headerSize + payloadSize + crcSize;
+
+    if (count == 0 || outSize < frameSize) return 0;
+
+    out[0] = syncByte1;
+    out[1] = syncByte2;
+    out[2] = protocolVersion;
+    out[3] = packet.type;
+    out[4] = payloadSize;
+
+    unsigned char* payload = out + headerSize;
+    for (int i = 0; i < 4; i++) {
+        payload[i] = (packet.deviceMillis >> (8 * i)) & 0xFF;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint32_t raw;
+        memcpy(&raw, &packet.values[i], sizeof(float));
+        for (int j = 0; j < 4; j++) {
+            payload[4 + 4 * i + j] = (raw >> (8 * j)) & 0xFF;
+        }
+    }
+
+    uint16_t crc = crc16(out + 2, frameSize - 2 - crcSize);
+    out[frameSize - 2] = crc & 0xFF;
+    out[frameSize - 1] = crc >> 8;
+
+    return frameSize;
+}
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF
+uint16_t FrameParser::crc16(const unsigned char* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ 0x1021;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
@@ -1,12 +1,33 @@
 #include "usbSerial.h"
 
+#include <errno.h>
+#include <poll.h>
+
 using namespace std;
 
+const double USBSerial::reconnectInterval = 0.5;
+
 USBSerial::USBSerial() {
+    usbFileDescriptor = -1;
+    connected = false;
+    reading = false;
+    packetCount = 0;
+}
+
+bool USBSerial::openUSBPort(string devicePath, int baud) {
+    this->devicePath = devicePath;
+
+    if (!openPort()) {
+        cout << "Opening " << devicePath << " FAILED " << strerror(errno) << endl;
+        return false;
+    }
 
+    return true;
 }
 
-void USBSerial::openUSBPort(string devicePath, int baud) {
+bool USBSerial::openPort() {
+    boost::mutex::scoped_lock lock(portMutex);
+
     memset(&ioStruct, 0, sizeof (ioStruct));
     ioStruct.c_iflag = 0;
     ioStruct.c_oflag = 0;
@@ -16,33 +37,156 @@ void USBSerial::openUSBPort(string devicePath, int baud) {
     ioStruct.c_cc[VTIME] = 5;
 
     usbFileDescriptor = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
-    if (usbFileDescriptor <= 0) {
-        cout << "Opening USB0 FAILED " << usbFileDescriptor << endl;
-        exit(1);
+    if (usbFileDescriptor < 0) {
+        return false;
     }
     cfsetospeed(&ioStruct, B115200);
     cfsetispeed(&ioStruct, B115200);
     tcsetattr(usbFileDescriptor, TCSANOW, &ioStruct);
+
+    connected = true;
+    return true;
+}
+
+void USBSerial::closePort() {
+    boost::mutex::scoped_lock lock(portMutex);
+
+    if (usbFileDescriptor >= 0) {
+        close(usbFileDescriptor);
+        usbFileDescriptor = -1;
+    }
+
+    connected = false;
 }
 
-void USBSerial::sendData(char data[]) {
-    sprintf(dataOut, "%s", data);
-    write(usbFileDescriptor, dataOut, sizeof (dataOut));
-    memset(&dataOut, '\0', sizeof (dataOut));
+void USBSerial::sendData(const char data[]) {
+    sendData(data, strlen(data));
 }
 
-string USBSerial::readData() {
-    if (read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn)) > 0) {
-        read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn));
+// Writes exactly length bytes. The port is non-blocking, so when the output
+// queue is full wait for it to drain rather than dropping the rest.
+bool USBSerial::sendData(const char data[], int length) {
+    const int pollTimeout = 100; // milliseconds
+    int written = 0;
+
+    boost::mutex::scoped_lock lock(portMutex);
+    if (usbFileDescriptor < 0) return false;
+
+    while (written < length) {
+        int result = write(usbFileDescriptor, data + written, length - written);
+
+        if (result > 0) {
+            written += result;
+        } else if (result < 0 && errno != EAGAIN && errno != EINTR) {
+            cout << "Writing to USB port FAILED " << strerror(errno) << endl;
+            return false;
+        } else {
+            struct pollfd pollDescriptor;
+            pollDescriptor.fd = usbFileDescriptor;
+            pollDescriptor.events = POLLOUT;
+
+            if (poll(&pollDescriptor, 1, pollTimeout) <= 0) {
+                cout << "Writing to USB port timed out" << endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void USBSerial::startReading(PacketCallback callback, ConnectionCallback connectionCallback) {
+    stopReading();
+
+    packetCallback = callback;
+    this->connectionCallback = connectionCallback;
+    reading = true;
+    readThread = boost::thread(&USBSerial::readLoop, this);
+}
+
+// The read thread keeps reopening the port when it fails, so it only ends
+// here. It sees reading cleared within a poll timeout or a reconnect interval.
+void USBSerial::stopReading() {
+    reading = false;
+
+    if (readThread.joinable()) {
+        readThread.join();
+    }
+}
+
+bool USBSerial::waitForPacket(double timeout) {
+    boost::mutex::scoped_lock lock(packetMutex);
+    unsigned long startCount = packetCount;
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds((long)(timeout * 1e6));
+
+    while (packetCount == startCount) {
+        if (!packetArrived.timed_wait(lock, deadline)) {
+            return packetCount != startCount;
+        }
+    }
+
+    return true;
+}
+
+// Runs on its own thread. poll() times out regularly so stopReading() is
+// noticed without having to wake the thread up.
+void USBSerial::readLoop() {
+    const int pollTimeout = 100; // milliseconds
+    char data[256];
+
+    while (reading) {
+        if (!connected) {
+            if (!openPort()) {
+                boost::this_thread::sleep(boost::posix_time::milliseconds((long)(reconnectInterval * 1000)));
+                continue;
+            }
+
+            // whatever was left of the last packet before the port failed
+            // will not be completed
+            parser.reset();
+            cout << "Reopened " << devicePath << endl;
+            if (connectionCallback) connectionCallback(true);
+        }
+
+        struct pollfd pollDescriptor;
+        pollDescriptor.fd = usbFileDescriptor;
+        pollDescriptor.events = POLLIN;
+
+        int ready = poll(&pollDescriptor, 1, pollTimeout);
+
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) continue;
+
+        int length = -1;
+        if (ready > 0 && !(pollDescriptor.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            length = read(usbFileDescriptor, data, sizeof (data));
+            if (length < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        }
+
+        if (length <= 0) {
+            // an unplugged USB serial device reports EIO or end of file
+            cout << devicePath << " closed or disconnected, reconnecting" << endl;
+            closePort();
+            if (connectionCallback) connectionCallback(false);
+            continue;
+        }
+
+        parser.feed(data, length);
+
+        SensorPacket packet;
+        while (parser.next(packet)) {
+            packetCallback(packet);
+
+            boost::mutex::scoped_lock lock(packetMutex);
+            packetCount++;
+            packetArrived.notify_all();
+        }
     }
-    string str(serialDataIn);
-    tcflush(usbFileDescriptor, TCIOFLUSH);
-    memset(&serialDataIn, '\0', sizeof (serialDataIn));
-    return str;
 }
 
 void USBSerial::closeUSBPort() {
-    close(usbFileDescriptor);
+    stopReading();
+    closePort();
 }
 
 USBSerial::~USBSerial() {
@@ -0,0 +1,62 @@
+#include "windowedIntegral.h"
+
+WindowedIntegral::WindowedIntegral(int length) :
+    values(length, 0),
+    generations(length, 0) {
+    generation = 1;
+    next = 0;
+    sum = 0;
+}
+
+void WindowedIntegral::add(float error) {
+    if (generations[next] == generation) {
+        sum -= values[next];
+    }
+
+    values[next] = error;
+    generations[next] = generation;
+    sum += error;
+
+    next++;
+
+    if (next >= values.size()) {
+        next = 0;
+
+        // rounding errors build up in the running sum, recompute it once
+        // per trip around the ring to keep them bounded
+        resum();
+    }
+}
+
+void WindowedIntegral::reset() {
+    generation++;
+    sum = 0;
+
+    // after 2^32 resets old slots could match the generation again
+    if (generation == 0) {
+        for (int i = 0; i < generations.size(); i++) {
+            generations[i] = 0;
+        }
+        generation = 1;
+    }
+}
+
+void WindowedIntegral::setLength(int length) {
+    if (length < 1) length = 1;
+
+    values.assign(length, 0);
+    generations.assign(length, 0);
+    generation = 1;
+    next = 0;
+    sum = 0;
+}
+
+void WindowedIntegral::resum() {
+    sum = 0;
+
+    for (int i = 0; i < values.size(); i++) {
+        if (generations[i] == generation) {
+            sum += values[i];
+        }
+    }
+}
@@ -0,0 +1,233 @@
+/*
+ * Cost of one drive command through the PID, replaying the commands in
+ * drive_trace.csv: the old controller, which re-summed its integral
+ * histories in full on every command and zeroed them entry by entry on
+ * every reset, against DriveController and its WindowedIntegrals. At the
+ * design rate of 10 Hz the histories are 1000 entries, at higher control
+ * rates they grow to keep covering 100 seconds.
+ *
+ * usage: bench_drive_controller [drive_trace.csv] [passes]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "driveController.h"
+
+namespace {
+
+const float designRate = 10;
+const float integralWindow = 100;
+
+struct DriveCommand {
+    float time;
+    float linear;
+    float angular;
+    float velocity;
+};
+
+double now() {
+    timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+bool loadTrace(const std::string& path, std::vector<DriveCommand>& trace) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == NULL) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        DriveCommand command;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%f,%f,%f,%f", &command.time, &command.linear, &command.angular, &command.velocity) == 4) {
+            trace.push_back(command);
+        }
+    }
+
+    fclose(file);
+    return !trace.empty();
+}
+
+float clamp(float value, float limit) {
+    if (value > limit) return limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+// driveCommandHandler() before WindowedIntegral, less its yaw branch bugs,
+// with histories of any length
+class RescanDriveController {
+public:
+
+    RescanDriveController(int historyLength) : evArray(historyLength), eyArray(historyLength) {
+        velFF = 0;
+        stepV = 0;
+        stepY = 0;
+        prevLin = 0;
+        prevYaw = 0;
+        for (int i = 0; i < 4; i++) {
+            velError[i] = 0;
+            yawError[i] = 0;
+        }
+    }
+
+    void update(float linearSpeed, float yawErr, float vel, int& left, int& right) {
+        float hz = designRate;
+        float sat = 255;
+        float PV = 0, IV = 0, DV = 0, PY = 0, IY = 0, DY = 0;
+        yawError[0] = yawErr;
+
+        if (linearSpeed != prevLin) {
+            zero(evArray);
+            for (int i = 0; i < 4; i++) velError[i] = 0;
+            prevLin = linearSpeed;
+        }
+
+        if ((prevYaw > 0 && yawError[0] < 0) || (prevYaw < 0 && yawError[0] > 0)) {
+            zero(eyArray);
+            yawError[1] = yawError[2] = yawError[3] = 0;
+        }
+        prevYaw = yawError[0];
+
+        if (linearSpeed > 0.5) velFF = 255;
+        else if (linearSpeed > 0.4) velFF = 180;
+        else if (linearSpeed > 0.3) velFF = 130;
+        else if (linearSpeed > 0.2) velFF = 75;
+        else if (linearSpeed > 0.1) velFF = 40;
+        else if (linearSpeed > 0.0) velFF = 10;
+        velError[0] = linearSpeed - vel;
+
+        PV = clamp(gains.kpv * ((velError[0] + velError[1]) / 2), sat);
+        if (fabs(velError[0]) > 0.01) {
+            evArray[stepV] = velError[0];
+            stepV = (stepV + 1) % evArray.size();
+        }
+        IV = gains.kiv * sum(evArray);
+        if (fabs(IV) > sat / 2 || fabs(PV) > sat / 2) {
+            zero(evArray);
+            IV = 0;
+        }
+        if (!(fabs(PV) > sat / 2)) {
+            DV = gains.kdv * ((velError[0] + velError[1]) / 2 - (velError[2] + velError[3]) / 2) * hz;
+        }
+        shift(velError);
+        float velOut = clamp(PV + IV + DV + velFF, sat);
+
+        PY = clamp(gains.kpy * ((yawError[0] + yawError[1]) / 2), sat);
+        if (fabs(yawError[0]) > 0.1) {
+            eyArray[stepY] = yawError[0];
+            stepY = (stepY + 1) % eyArray.size();
+            IY = gains.kiy * sum(eyArray);
+        }
+        if (fabs(IY) > sat / 2 || fabs(PY) > sat / 2) {
+            zero(eyArray);
+            IY = 0;
+        }
+        if (!(fabs(PY) > sat / 2)) {
+            DY = gains.kdy * ((yawError[0] + yawError[1]) / 2 - (yawError[2] + yawError[3]) / 2) * hz;
+        }
+        shift(yawError);
+        float yawOut = clamp(PY + IY + DY, sat / 2);
+
+        if (linearSpeed > 0 && velOut < 0) velOut = 0;
+        else if (linearSpeed < 0 && velOut > 0) velOut = 0;
+        if (PY > 0 && yawOut < 0) yawOut = 0;
+        else if (PY < 0 && yawOut > 0) yawOut = 0;
+
+        left = clamp(velOut - yawOut, sat);
+        right = clamp(velOut + yawOut, sat);
+        if (linearSpeed == 0 && yawError[0] == 0) {
+            left = 0;
+            right = 0;
+        }
+    }
+
+private:
+
+    static void zero(std::vector<float>& history) {
+        for (size_t i = 0; i < history.size(); i++) history[i] = 0;
+    }
+
+    static float sum(const std::vector<float>& history) {
+        float total = 0;
+        for (size_t i = 0; i < history.size(); i++) total += history[i];
+        return total;
+    }
+
+    static void shift(float* error) {
+        error[3] = error[2];
+        error[2] = error[1];
+        error[1] = error[0];
+    }
+
+    DriveController::Gains gains;
+    float velFF;
+    std::vector<float> evArray;
+    std::vector<float> eyArray;
+    int stepV;
+    int stepY;
+    float velError[4];
+    float yawError[4];
+    float prevLin;
+    float prevYaw;
+};
+
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : ABRIDGE_TEST_DIR "/drive_trace.csv";
+    int passes = argc > 2 ? atoi(argv[2]) : 200;
+
+    std::vector<DriveCommand> trace;
+    if (!loadTrace(path, trace)) {
+        fprintf(stderr, "could not read %s\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    float controlRates[] = {10, 20, 50};
+
+    // keeps the compiler from dropping the motor commands
+    long checksum = 0;
+
+    printf("%zu commands, %d passes\n", trace.size(), passes);
+    printf("rate Hz  history  re-summed ns/command  windowed ns/command\n");
+    for (int r = 0; r < 3; r++) {
+        int historyLength = integralWindow * controlRates[r];
+        float dt = 1 / controlRates[r];
+        int left, right;
+
+        // the old controller only ever ran at the design rate, at the others
+        // it stands for what its histories would cost at that length
+        RescanDriveController rescan(historyLength);
+        double start = now();
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < trace.size(); i++) {
+                rescan.update(trace[i].linear, trace[i].angular, trace[i].velocity, left, right);
+                checksum += left - right;
+            }
+        }
+        double rescanTime = (now() - start) / (passes * trace.size());
+
+        DriveController controller(designRate, integralWindow);
+        controller.setControlRate(controlRates[r]);
+        start = now();
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < trace.size(); i++) {
+                controller.update(trace[i].linear, trace[i].angular, trace[i].velocity, dt, false, left, right);
+                checksum += left - right;
+            }
+        }
+        double windowedTime = (now() - start) / (passes * trace.size());
+
+        printf("%7.0f  %7d  %20.1f  %19.1f\n", controlRates[r], historyLength, rescanTime * 1e9, windowedTime * 1e9);
+    }
+
+    fprintf(stderr, "checksum %ld\n", checksum);
+    return EXIT_SUCCESS;
+}
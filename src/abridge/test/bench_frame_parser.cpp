@@ -0,0 +1,99 @@
+/*
+ * Throughput of FrameParser on a stream of IMU packets, the largest and most
+ * frequent the arduino sends, as binary frames and as ASCII lines. The
+ * stream is fed in reads of the size usbSerial makes.
+ *
+ * usage: bench_frame_parser [packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+
+#include "frameParser.h"
+
+namespace {
+
+double now() {
+    timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+// Returns packets parsed per second. stream holds whole packets, fed in
+// chunks of readSize bytes until count packets have gone through.
+double run(const std::string& stream, size_t readSize, int count) {
+    FrameParser parser;
+    SensorPacket packet;
+    int parsed = 0;
+    size_t position = 0;
+
+    double start = now();
+    while (parsed < count) {
+        size_t length = stream.size() - position;
+        if (length > readSize) length = readSize;
+
+        parser.feed(stream.data() + position, length);
+        position += length;
+        if (position == stream.size()) position = 0;
+
+        while (parser.next(packet)) parsed++;
+    }
+    double elapsed = now() - start;
+
+    if (parser.discardedBytes != 0 || parser.overflowBytes != 0) {
+        fprintf(stderr, "stream did not parse cleanly\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return parsed / elapsed;
+}
+
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 2000000;
+    const int packetsInStream = 100;
+
+    SensorPacket packet;
+    packet.type = PACKET_IMU;
+    packet.deviceMillis = 0;
+    packet.valueCount = 9;
+
+    std::string binary;
+    std::string ascii;
+    for (int i = 0; i < packetsInStream; i++) {
+        packet.deviceMillis += 10;
+        for (int j = 0; j < 9; j++) {
+            packet.values[j] = (i * 9 + j) * 0.0137f - 1;
+        }
+
+        unsigned char frame[64];
+        size_t size = FrameParser::encode(packet, frame, sizeof(frame));
+        binary.append((const char*)frame, size);
+
+        char line[160];
+        snprintf(line, sizeof(line), "IMU,1,%g,%g,%g,%g,%g,%g,%g,%g,%g\n",
+                 packet.values[0], packet.values[1], packet.values[2],
+                 packet.values[3], packet.values[4], packet.values[5],
+                 packet.values[6], packet.values[7], packet.values[8]);
+        ascii += line;
+    }
+
+    size_t readSizes[] = {1, 16, 64, 256};
+
+    printf("read size  binary packets/s  ascii packets/s\n");
+    for (int i = 0; i < 4; i++) {
+        // byte at a time reads are much slower, fewer are enough
+        int packets = readSizes[i] == 1 ? count / 10 : count;
+        printf("%9zu  %16.0f  %15.0f\n", readSizes[i],
+               run(binary, readSizes[i], packets),
+               run(ascii, readSizes[i], packets));
+    }
+
+    printf("bytes per packet: binary %zu, ascii %zu\n", binary.size() / packetsInStream, ascii.size() / packetsInStream);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "commandWriter.h"
+#include "usbSerial.h"
+
+namespace {
+
+// whatever arrived on the pty master within timeout milliseconds
+std::string receive(int master, int timeout) {
+    std::string received;
+    struct pollfd pollDescriptor;
+    pollDescriptor.fd = master;
+    pollDescriptor.events = POLLIN;
+
+    while (poll(&pollDescriptor, 1, timeout) > 0) {
+        char data[256];
+        ssize_t length = read(master, data, sizeof(data));
+        if (length <= 0) break;
+        received.append(data, length);
+        timeout = 50;
+    }
+
+    return received;
+}
+
+}
+
+// a drive command written while the port is down must not be lost, nor
+// its repeats dropped as duplicates of it
+TEST(CommandWriter, FailedWriteIsRetried) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(0, grantpt(master));
+    ASSERT_EQ(0, unlockpt(master));
+    struct termios ioStruct;
+    tcgetattr(master, &ioStruct);
+    cfmakeraw(&ioStruct);
+    tcsetattr(master, TCSANOW, &ioStruct);
+
+    USBSerial usb;
+    CommandWriter writer(&usb);
+    writer.start(50, 1.0);
+
+    writer.set(CommandWriter::DRIVE, "v,80,80\n");
+    usleep(100000);
+    writer.set(CommandWriter::DRIVE, "v,80,80\n");
+    writer.set(CommandWriter::FINGER, "f,1\n");
+    usleep(100000);
+
+    ASSERT_TRUE(usb.openUSBPort(ptsname(master), 115200));
+    std::string received = receive(master, 1000);
+    writer.stop();
+    close(master);
+
+    EXPECT_EQ("v,80,80\nf,1\n", received);
+    EXPECT_NE(std::string::npos, writer.summary().find(" 0 duplicates dropped"));
+}
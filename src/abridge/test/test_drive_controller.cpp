@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "driveController.h"
+
+namespace {
+
+const float designRate = 10;
+const float integralWindow = 100;
+
+struct DriveCommand {
+    float time;
+    float linear;
+    float angular;
+    float velocity;
+};
+
+bool loadTrace(const std::string& path, std::vector<DriveCommand>& trace) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == NULL) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        DriveCommand command;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%f,%f,%f,%f", &command.time, &command.linear, &command.angular, &command.velocity) == 4) {
+            trace.push_back(command);
+        }
+    }
+
+    fclose(file);
+    return !trace.empty();
+}
+
+// The drive PID as it was before the integrals became windowed sums: each
+// integral is a 1000 entry history summed in full on every command and
+// zeroed entry by entry on every reset, run at the design rate. The yaw
+// branch is as it was meant to be, keeping its own error history and
+// resetting when the yaw error changes sign.
+class ReferenceDriveController {
+public:
+
+    ReferenceDriveController() {
+        velFF = 0;
+        stepV = 0;
+        stepY = 0;
+        prevLin = 0;
+        prevYaw = 0;
+        zero(evArray);
+        zero(eyArray);
+        for (int i = 0; i < 4; i++) {
+            velError[i] = 0;
+            yawError[i] = 0;
+        }
+    }
+
+    void update(float linearSpeed, float yawErr, float vel, int& left, int& right) {
+        DriveController::Gains gains;
+        float hz = designRate;
+        float sat = 255;
+        float PV = 0, IV = 0, DV = 0, PY = 0, IY = 0, DY = 0;
+        yawError[0] = yawErr;
+
+        if (linearSpeed != prevLin) {
+            zero(evArray);
+            for (int i = 0; i < 4; i++) velError[i] = 0;
+            prevLin = linearSpeed;
+        }
+
+        if (prevYaw > 0 && yawError[0] < 0 || prevYaw < 0 && yawError[0] > 0) {
+            zero(eyArray);
+            yawError[1] = yawError[2] = yawError[3] = 0;
+        }
+        prevYaw = yawError[0];
+
+        if (linearSpeed > 0.5) velFF = 255;
+        else if (linearSpeed > 0.4) velFF = 180;
+        else if (linearSpeed > 0.3) velFF = 130;
+        else if (linearSpeed > 0.2) velFF = 75;
+        else if (linearSpeed > 0.1) velFF = 40;
+        else if (linearSpeed > 0.0) velFF = 10;
+        velError[0] = linearSpeed - vel;
+
+        PV = clamp(gains.kpv * ((velError[0] + velError[1]) / 2), sat);
+        if (fabs(velError[0]) > 0.01) {
+            evArray[stepV] = velError[0];
+            stepV = (stepV + 1) % historyLength;
+        }
+        IV = gains.kiv * sum(evArray);
+        if (fabs(IV) > sat / 2 || fabs(PV) > sat / 2) {
+            zero(evArray);
+            IV = 0;
+        }
+        if (!(fabs(PV) > sat / 2)) {
+            DV = gains.kdv * ((velError[0] + velError[1]) / 2 - (velError[2] + velError[3]) / 2) * hz;
+        }
+        shift(velError);
+        float velOut = clamp(PV + IV + DV + velFF, sat);
+
+        PY = clamp(gains.kpy * ((yawError[0] + yawError[1]) / 2), sat);
+        if (fabs(yawError[0]) > 0.1) {
+            eyArray[stepY] = yawError[0];
+            stepY = (stepY + 1) % historyLength;
+            IY = gains.kiy * sum(eyArray);
+        }
+        if (fabs(IY) > sat / 2 || fabs(PY) > sat / 2) {
+            zero(eyArray);
+            IY = 0;
+        }
+        if (!(fabs(PY) > sat / 2)) {
+            DY = gains.kdy * ((yawError[0] + yawError[1]) / 2 - (yawError[2] + yawError[3]) / 2) * hz;
+        }
+        shift(yawError);
+        float yawOut = clamp(PY + IY + DY, sat / 2);
+
+        if (linearSpeed > 0 && velOut < 0) velOut = 0;
+        else if (linearSpeed < 0 && velOut > 0) velOut = 0;
+        if (PY > 0 && yawOut < 0) yawOut = 0;
+        else if (PY < 0 && yawOut > 0) yawOut = 0;
+
+        left = clamp(velOut - yawOut, sat);
+        right = clamp(velOut + yawOut, sat);
+        if (linearSpeed == 0 && yawError[0] == 0) {
+            left = 0;
+            right = 0;
+        }
+    }
+
+private:
+
+    static const int historyLength = 1000;
+
+    static float clamp(float value, float limit) {
+        if (value > limit) return limit;
+        if (value < -limit) return -limit;
+        return value;
+    }
+
+    static void zero(float* history) {
+        for (int i = 0; i < historyLength; i++) history[i] = 0;
+    }
+
+    static float sum(const float* history) {
+        float total = 0;
+        for (int i = 0; i < historyLength; i++) total += history[i];
+        return total;
+    }
+
+    static void shift(float* error) {
+        error[3] = error[2];
+        error[2] = error[1];
+        error[1] = error[0];
+    }
+
+    float velFF;
+    float evArray[historyLength];
+    float eyArray[historyLength];
+    int stepV;
+    int stepY;
+    float velError[4];
+    float yawError[4];
+    float prevLin;
+    float prevYaw;
+};
+
+}
+
+// Replays drive commands recorded from mobility at the design rate and checks
+// every motor command against the re-summing controller. The two sum their
+// errors in a different order, so they may differ by the truncation of a
+// PWM value.
+TEST(DriveController, ReplayMatchesReference) {
+    std::vector<DriveCommand> trace;
+    ASSERT_TRUE(loadTrace(std::string(ABRIDGE_TEST_DIR) + "/drive_trace.csv", trace));
+
+    DriveController controller(designRate, integralWindow);
+    ReferenceDriveController reference;
+    int moving = 0;
+
+    for (size_t i = 0; i < trace.size(); i++) {
+        const DriveCommand& command = trace[i];
+        int left, right, expectedLeft, expectedRight;
+
+        controller.update(command.linear, command.angular, command.velocity, 1 / designRate, false, left, right);
+        reference.update(command.linear, command.angular, command.velocity, expectedLeft, expectedRight);
+
+        ASSERT_NEAR(expectedLeft, left, 1) << "command " << i << " at " << command.time << " s";
+        ASSERT_NEAR(expectedRight, right, 1) << "command " << i << " at " << command.time << " s";
+        ASSERT_LE(abs(left), 255);
+        ASSERT_LE(abs(right), 255);
+        if (left != 0 || right != 0) moving++;
+    }
+
+    // the trace has to exercise the controller for the comparison to mean anything
+    EXPECT_GT(moving, (int)trace.size() / 2);
+}
+
+TEST(DriveController, YawIntegralSumsYawError) {
+    DriveController controller(designRate, integralWindow);
+    int left, right;
+
+    // velocity on target, so only the yaw branch has an error to integrate
+    for (int i = 0; i < 5; i++) {
+        controller.update(0.2, 0.3, 0.2, 1 / designRate, false, left, right);
+    }
+
+    EXPECT_NEAR(5 * 0.3, controller.getYawIntegral(), 1e-4);
+    EXPECT_FLOAT_EQ(0, controller.getVelocityIntegral());
+}
+
+TEST(DriveController, YawIntegralResetsOnSignChange) {
+    DriveController controller(designRate, integralWindow);
+    int left, right;
+
+    for (int i = 0; i < 5; i++) {
+        controller.update(0.2, 0.3, 0.2, 1 / designRate, false, left, right);
+    }
+    controller.update(0.2, -0.3, 0.2, 1 / designRate, false, left, right);
+    EXPECT_NEAR(-0.3, controller.getYawIntegral(), 1e-4);
+
+    // and on every later change of sign, not only the first
+    controller.update(0.2, -0.3, 0.2, 1 / designRate, false, left, right);
+    controller.update(0.2, 0.3, 0.2, 1 / designRate, false, left, right);
+    EXPECT_NEAR(0.3, controller.getYawIntegral(), 1e-4);
+}
+
+TEST(DriveController, YawIntegralIgnoresSmallErrors) {
+    DriveController controller(designRate, integralWindow);
+    int left, right;
+
+    controller.update(0.2, 0.05, 0.2, 1 / designRate, false, left, right);
+    EXPECT_FLOAT_EQ(0, controller.getYawIntegral());
+}
+
+TEST(DriveController, StopsWhenAskedToStop) {
+    DriveController controller(designRate, integralWindow);
+    int left, right;
+
+    controller.update(0.3, 0.5, 0, 1 / designRate, false, left, right);
+    controller.update(0, 0, 0.3, 1 / designRate, false, left, right);
+    EXPECT_EQ(0, left);
+    EXPECT_EQ(0, right);
+}
+
+TEST(DriveController, ManualModeScalesToFullPwm) {
+    DriveController controller(designRate, integralWindow);
+    int left, right;
+
+    // full stick forward: the proportional term alone, averaged with the
+    // reset history on the first command
+    controller.update(1, 0, 0, 1 / designRate, true, left, right);
+    controller.update(1, 0, 0, 1 / designRate, true, left, right);
+    EXPECT_EQ(255, left);
+    EXPECT_EQ(255, right);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "driveController.h"
+
+namespace {
+
+const float designRate = 10;
+const float integralWindow = 100;
+
+// A skid steer rover. Each side's wheels settle, with a first order lag, on
+// the speed its PWM command asks for less what drag takes off, so the feed
+// forward alone falls short and the integral has to make up the rest. The
+// rover drives at the mean of the two sides and turns at their difference
+// over the track width.
+class DrivePlant {
+public:
+
+    DrivePlant() {
+        left = 0;
+        right = 0;
+        heading = 0;
+    }
+
+    void step(int leftPwm, int rightPwm, double dt) {
+        left += (leftPwm / 255.0 * maxSpeed - drag - left) * dt / lag;
+        right += (rightPwm / 255.0 * maxSpeed - drag - right) * dt / lag;
+        heading += (right - left) / track * dt;
+    }
+
+    double speed() {return fabs(left + right) / 2;}
+
+    double heading;
+
+private:
+
+    static const double maxSpeed; // m/s at full PWM, near what the feed forward table assumes
+    static const double drag; // m/s
+    static const double lag; // s
+    static const double track; // m
+
+    double left;
+    double right;
+};
+
+const double DrivePlant::maxSpeed = 0.6;
+const double DrivePlant::drag = 0.1;
+const double DrivePlant::lag = 0.15;
+const double DrivePlant::track = 0.3;
+
+struct Response {
+    std::vector<double> speed;
+    std::vector<double> heading;
+};
+
+// Asks for linearSpeed and a turn to goalHeading from standing, with drive
+// commands at controlRate the way mobility sends them, and samples the
+// rover's speed and heading every sampleInterval seconds for duration.
+Response stepResponse(float controlRate, float linearSpeed, float goalHeading, double duration) {
+    const double plantStep = 0.001;
+    const double sampleInterval = 0.25;
+
+    DriveController controller(designRate, integralWindow);
+    controller.setControlRate(controlRate);
+    DrivePlant plant;
+    Response response;
+
+    int left = 0;
+    int right = 0;
+    double nextCommand = 0;
+    double nextSample = sampleInterval;
+
+    for (double t = 0; t < duration; t += plantStep) {
+        if (t >= nextCommand) {
+            controller.update(linearSpeed, goalHeading - plant.heading, plant.speed(), 1 / controlRate, false, left, right);
+            nextCommand += 1 / controlRate;
+        }
+
+        plant.step(left, right, plantStep);
+
+        if (t >= nextSample) {
+            response.speed.push_back(plant.speed());
+            response.heading.push_back(plant.heading);
+            nextSample += sampleInterval;
+        }
+    }
+
+    return response;
+}
+
+// Compares the speed from the end of the first second, before which the
+// responses differ by up to a command interval in when the rover first
+// reacts, and the heading once the turn is done. How much a turn overshoots
+// depends on how long each yaw command is held, which the gains cannot
+// make up for, so only where it settles is compared.
+void expectSameResponse(const Response& expected, const Response& actual, float controlRate) {
+    ASSERT_EQ(expected.speed.size(), actual.speed.size());
+
+    for (size_t i = 3; i < expected.speed.size(); i++) {
+        double t = (i + 1) * 0.25;
+        EXPECT_NEAR(expected.speed[i], actual.speed[i], 0.01) << "speed at " << t << " s, " << controlRate << " Hz";
+        if (t >= 2) {
+            EXPECT_NEAR(expected.heading[i], actual.heading[i], 0.025) << "heading at " << t << " s, " << controlRate << " Hz";
+        }
+    }
+}
+
+}
+
+// The same step at the design rate and at half, double and four times it
+// should move the rover the same way. The speed takes several seconds to
+// close on the target as the integral builds, and it only builds at the
+// same pace at every rate if each error is weighted by its interval.
+TEST(DrivePlant, StepResponseHoldsAcrossControlRates) {
+    Response design = stepResponse(designRate, 0.3, 0.2, 8);
+
+    // the controller has to actually get there for the comparison to mean
+    // anything, the integral stops within its 0.01 m/s deadspace
+    EXPECT_NEAR(0.3, design.speed.back(), 0.011);
+    EXPECT_NEAR(0.2, design.heading.back(), 0.005);
+    EXPECT_LT(design.speed[3], 0.27);
+
+    float rates[] = {5, 20, 40};
+    for (int i = 0; i < 3; i++) {
+        expectSameResponse(design, stepResponse(rates[i], 0.3, 0.2, 8), rates[i]);
+    }
+}
+
+// A velocity error held for one second adds the same to the integral,
+// error * seconds * designRate, whatever the rate it is sampled at.
+TEST(DrivePlant, IntegralWeightsErrorByInterval) {
+    float rates[] = {5, 10, 20, 40};
+
+    for (int i = 0; i < 4; i++) {
+        DriveController controller(designRate, integralWindow);
+        controller.setControlRate(rates[i]);
+        int left, right;
+
+        // a stalled rover, 0.05 m/s short of its target
+        for (int k = 0; k < rates[i]; k++) {
+            controller.update(0.05, 0, 0, 1 / rates[i], false, left, right);
+        }
+
+        EXPECT_NEAR(0.05 * 1 * designRate, controller.getVelocityIntegral(), 1e-3) << rates[i] << " Hz";
+    }
+}
+
+TEST(DrivePlant, MeasuredIntervalIsClamped) {
+    float rates[] = {5, 10, 20};
+
+    for (int i = 0; i < 3; i++) {
+        DriveController controller(designRate, integralWindow);
+        controller.setControlRate(rates[i]);
+        EXPECT_FLOAT_EQ(0.25 / rates[i], controller.getMinInterval());
+        EXPECT_FLOAT_EQ(4 / rates[i], controller.getMaxInterval());
+
+        int left, right;
+
+        // two commands on top of each other count as a quarter interval
+        controller.update(0.05, 0, 0, 0, false, left, right);
+        EXPECT_NEAR(0.05 * 0.25 / rates[i] * designRate, controller.getVelocityIntegral(), 1e-5) << rates[i] << " Hz";
+
+        // and a long gap as four intervals
+        controller.update(0.05, 0, 0, 10, false, left, right);
+        EXPECT_NEAR(0.05 * 4.25 / rates[i] * designRate, controller.getVelocityIntegral(), 1e-5) << rates[i] << " Hz";
+    }
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <string>
+
+#include "frameParser.h"
+
+namespace {
+
+SensorPacket imuPacket(uint32_t deviceMillis) {
+    SensorPacket packet;
+    packet.type = PACKET_IMU;
+    packet.binary = true;
+    packet.deviceMillis = deviceMillis;
+    packet.valueCount = 9;
+    for (int i = 0; i < 9; i++) {
+        packet.values[i] = i * 1.5f - 3;
+    }
+    return packet;
+}
+
+void feed(FrameParser& parser, const unsigned char* data, size_t length) {
+    ASSERT_EQ(0u, parser.feed((const char*)data, length));
+}
+
+void feed(FrameParser& parser, const std::string& data) {
+    ASSERT_EQ(0u, parser.feed(data.c_str(), data.size()));
+}
+
+void expectImu(const SensorPacket& packet, uint32_t deviceMillis) {
+    SensorPacket expected = imuPacket(deviceMillis);
+    EXPECT_EQ(PACKET_IMU, packet.type);
+    EXPECT_TRUE(packet.binary);
+    EXPECT_EQ(deviceMillis, packet.deviceMillis);
+    ASSERT_EQ(9, packet.valueCount);
+    for (int i = 0; i < 9; i++) {
+        EXPECT_FLOAT_EQ(expected.values[i], packet.values[i]);
+    }
+}
+
+}
+
+TEST(FrameParser, AsciiLines) {
+    FrameParser parser;
+    SensorPacket packet;
+
+    feed(parser, "IMU,1,1,2,3,4,5,6,7,8,9\r\nUSL,1,42\nUSC,0,3\n");
+
+    ASSERT_TRUE(parser.next(packet));
+    EXPECT_EQ(PACKET_IMU, packet.type);
+    EXPECT_FALSE(packet.binary);
+    EXPECT_FLOAT_EQ(9, packet.values[8]);
+
+    ASSERT_TRUE(parser.next(packet));
+    EXPECT_EQ(PACKET_USL, packet.type);
+    EXPECT_FLOAT_EQ(42, packet.values[0]);
+
+    // a reading flagged invalid is skipped
+    EXPECT_FALSE(parser.next(packet));
+    EXPECT_EQ(2u, parser.asciiLines);
+}
+
+TEST(FrameParser, BinaryRoundTrip) {
+    FrameParser parser;
+    SensorPacket packet;
+    unsigned char frame[64];
+
+    size_t size = FrameParser::encode(imuPacket(123456), frame, sizeof(frame));
+    ASSERT_EQ(5u + 4 + 36 + 2, size);
+    EXPECT_EQ(0u, FrameParser::encode(imuPacket(0), frame, size - 1));
+
+    size = FrameParser::encode(imuPacket(123456), frame, sizeof(frame));
+    feed(parser, frame, size);
+    ASSERT_TRUE(parser.next(packet));
+    expectImu(packet, 123456);
+    EXPECT_FALSE(parser.next(packet));
+}
+
+// serial reads end wherever they end, a frame can arrive a byte at a time
+TEST(FrameParser, FrameSplitAcrossReads) {
+    FrameParser parser;
+    SensorPacket packet;
+    unsigned char frame[64];
+    size_t size = FrameParser::encode(imuPacket(42), frame, sizeof(frame));
+
+    for (size_t i = 0; i < size - 1; i++) {
+        feed(parser, frame + i, 1);
+        ASSERT_FALSE(parser.next(packet)) << "after " << i + 1 << " bytes";
+    }
+
+    feed(parser, frame + size - 1, 1);
+    ASSERT_TRUE(parser.next(packet));
+    expectImu(packet, 42);
+    EXPECT_EQ(0u, parser.discardedBytes);
+}
+
+TEST(FrameParser, BadCrcIsSkipped) {
+    FrameParser parser;
+    SensorPacket packet;
+    unsigned char frame[64];
+    size_t size = FrameParser::encode(imuPacket(1), frame, sizeof(frame));
+
+    frame[10] ^= 0x01;
+    feed(parser, frame, size);
+    frame[10] ^= 0x01;
+    FrameParser::encode(imuPacket(2), frame, sizeof(frame));
+    feed(parser, frame, size);
+
+    // the corrupt frame is dropped and the good one behind it still read
+    ASSERT_TRUE(parser.next(packet));
+    expectImu(packet, 2);
+    EXPECT_FALSE(parser.next(packet));
+    EXPECT_EQ(1u, parser.crcErrors);
+    EXPECT_EQ(1u, parser.binaryFrames);
+}
+
+TEST(FrameParser, ResyncsAfterNoise) {
+    FrameParser parser;
+    SensorPacket packet;
+    unsigned char frame[64];
+    size_t size = FrameParser::encode(imuPacket(7), frame, sizeof(frame));
+
+    // a stray sync byte, control characters, a half line cut off by a frame
+    const unsigned char noise[] = {0xA5, 0x00, 0x13, 0xA5, 0xA5, 'I', 'M', 'U', ',', '1'};
+    feed(parser, noise, sizeof(noise));
+    feed(parser, frame, size);
+    feed(parser, "USR,1,7\n");
+
+    ASSERT_TRUE(parser.next(packet));
+    expectImu(packet, 7);
+    ASSERT_TRUE(parser.next(packet));
+    EXPECT_EQ(PACKET_USR, packet.type);
+    EXPECT_FLOAT_EQ(7, packet.values[0]);
+    EXPECT_FALSE(parser.next(packet));
+    EXPECT_EQ(sizeof(noise), parser.discardedBytes);
+}
+
+TEST(FrameParser, SyncBytesInsideAFrame) {
+    FrameParser parser;
+    SensorPacket packet = imuPacket(0xA55AA55A);
+    unsigned char frame[64];
+
+    // values whose bytes look like the start of another frame
+    uint32_t raw = 0x015AA5A5;
+    memcpy(&packet.values[0], &raw, sizeof(float));
+    size_t size = FrameParser::encode(packet, frame, sizeof(frame));
+
+    feed(parser, frame, size);
+    feed(parser, frame, size);
+    SensorPacket read;
+    ASSERT_TRUE(parser.next(read));
+    EXPECT_EQ(0xA55AA55A, read.deviceMillis);
+    ASSERT_TRUE(parser.next(read));
+    EXPECT_EQ(0u, parser.discardedBytes);
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "usbSerial.h"
+
+namespace {
+
+// a pseudo terminal standing in for the arduino, its slave end reached
+// through a symlink the way abridge_emulator does it
+class Arduino {
+public:
+
+    Arduino() {
+        master = -1;
+        char directory[] = "/tmp/test_usb_serialXXXXXX";
+        linkDirectory = mkdtemp(directory);
+        linkPath = linkDirectory + "/ttyACM0";
+    }
+
+    ~Arduino() {
+        unplug();
+        unlink(linkPath.c_str());
+        rmdir(linkDirectory.c_str());
+    }
+
+    bool plugIn() {
+        master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+
+        struct termios ioStruct;
+        tcgetattr(master, &ioStruct);
+        cfmakeraw(&ioStruct);
+        tcsetattr(master, TCSANOW, &ioStruct);
+
+        unlink(linkPath.c_str());
+        return symlink(ptsname(master), linkPath.c_str()) == 0;
+    }
+
+    void unplug() {
+        if (master >= 0) close(master);
+        master = -1;
+    }
+
+    void send(const std::string& data) {
+        ASSERT_EQ((ssize_t)data.size(), write(master, data.data(), data.size()));
+    }
+
+    void send(const SensorPacket& packet) {
+        unsigned char frame[64];
+        size_t size = FrameParser::encode(packet, frame, sizeof(frame));
+        send(std::string((const char*)frame, size));
+    }
+
+    // whatever abridge wrote, waiting up to a second for the first of it
+    std::string receive() {
+        struct pollfd pollDescriptor;
+        pollDescriptor.fd = master;
+        pollDescriptor.events = POLLIN;
+        if (poll(&pollDescriptor, 1, 1000) <= 0) return "";
+
+        char data[256];
+        ssize_t length = read(master, data, sizeof(data));
+        return length > 0 ? std::string(data, length) : "";
+    }
+
+    std::string linkPath;
+
+private:
+
+    std::string linkDirectory;
+    int master;
+};
+
+// collects what the read thread hands over
+class Listener {
+public:
+
+    Listener() {
+        connects = 0;
+        disconnects = 0;
+    }
+
+    void packet(const SensorPacket& packet) {
+        boost::mutex::scoped_lock lock(mutex);
+        packets.push_back(packet);
+    }
+
+    void connection(bool connected) {
+        boost::mutex::scoped_lock lock(mutex);
+        if (connected) connects++;
+        else disconnects++;
+    }
+
+    size_t packetCount() {
+        boost::mutex::scoped_lock lock(mutex);
+        return packets.size();
+    }
+
+    int connectCount() {
+        boost::mutex::scoped_lock lock(mutex);
+        return connects;
+    }
+
+    int disconnectCount() {
+        boost::mutex::scoped_lock lock(mutex);
+        return disconnects;
+    }
+
+    boost::mutex mutex;
+    std::vector<SensorPacket> packets;
+    int connects;
+    int disconnects;
+};
+
+SensorPacket sonarPacket(SensorPacketType type, float range) {
+    SensorPacket packet;
+    packet.type = type;
+    packet.binary = true;
+    packet.deviceMillis = 1000;
+    packet.valueCount = 1;
+    packet.values[0] = range;
+    return packet;
+}
+
+// polls a count until it reaches at least expected, for up to two seconds
+template <class Count>
+bool waitFor(Count count, size_t expected) {
+    for (int i = 0; i < 200; i++) {
+        if ((size_t)count() >= expected) return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+}
+
+TEST(USBSerial, PacketsArriveAsTheyAreWritten) {
+    Arduino arduino;
+    ASSERT_TRUE(arduino.plugIn());
+
+    USBSerial usb;
+    Listener listener;
+    ASSERT_TRUE(usb.openUSBPort(arduino.linkPath, 115200));
+    usb.startReading(boost::bind(&Listener::packet, &listener, _1));
+
+    arduino.send(sonarPacket(PACKET_USL, 150));
+    ASSERT_TRUE(waitFor(boost::bind(&Listener::packetCount, &listener), 1));
+
+    // a frame in two writes, then a line, as a slow link delivers them
+    unsigned char frame[64];
+    size_t size = FrameParser::encode(sonarPacket(PACKET_USC, 40), frame, sizeof(frame));
+    arduino.send(std::string((const char*)frame, 3));
+    usleep(50000);
+    EXPECT_EQ(1u, listener.packetCount());
+    arduino.send(std::string((const char*)frame + 3, size - 3));
+    arduino.send("USR,1,250\n");
+
+    ASSERT_TRUE(waitFor(boost::bind(&Listener::packetCount, &listener), 3));
+    usb.closeUSBPort();
+
+    ASSERT_EQ(3u, listener.packets.size());
+    EXPECT_EQ(PACKET_USL, listener.packets[0].type);
+    EXPECT_EQ(PACKET_USC, listener.packets[1].type);
+    EXPECT_FLOAT_EQ(40, listener.packets[1].values[0]);
+    EXPECT_EQ(PACKET_USR, listener.packets[2].type);
+    EXPECT_FALSE(listener.packets[2].binary);
+    EXPECT_EQ(0u, usb.getParser().discardedBytes);
+}
+
+TEST(USBSerial, SendDataReachesTheArduino) {
+    Arduino arduino;
+    ASSERT_TRUE(arduino.plugIn());
+
+    USBSerial usb;
+    ASSERT_TRUE(usb.openUSBPort(arduino.linkPath, 115200));
+
+    ASSERT_TRUE(usb.sendData("v,80,-80\n", 9));
+    EXPECT_EQ("v,80,-80\n", arduino.receive());
+}
+
+TEST(USBSerial, ReconnectsAfterUnplugging) {
+    Arduino arduino;
+    ASSERT_TRUE(arduino.plugIn());
+
+    USBSerial usb;
+    Listener listener;
+    ASSERT_TRUE(usb.openUSBPort(arduino.linkPath, 115200));
+    usb.startReading(boost::bind(&Listener::packet, &listener, _1),
+                     boost::bind(&Listener::connection, &listener, _1));
+
+    // half a frame is lost with the port
+    unsigned char frame[64];
+    size_t size = FrameParser::encode(sonarPacket(PACKET_USL, 100), frame, sizeof(frame));
+    arduino.send(std::string((const char*)frame, size / 2));
+    usleep(50000);
+
+    arduino.unplug();
+    ASSERT_TRUE(waitFor(boost::bind(&Listener::disconnectCount, &listener), 1));
+    EXPECT_FALSE(usb.isConnected());
+
+    // still gone on the next attempt, then back as a new device
+    usleep(600000);
+    EXPECT_EQ(0, listener.connectCount());
+    ASSERT_TRUE(arduino.plugIn());
+    ASSERT_TRUE(waitFor(boost::bind(&Listener::connectCount, &listener), 1));
+    EXPECT_TRUE(usb.isConnected());
+
+    arduino.send(sonarPacket(PACKET_USR, 200));
+    ASSERT_TRUE(waitFor(boost::bind(&Listener::packetCount, &listener), 1));
+    usb.stopReading();
+
+    ASSERT_EQ(1u, listener.packets.size());
+    EXPECT_EQ(PACKET_USR, listener.packets[0].type);
+    EXPECT_EQ(1, listener.disconnects);
+    EXPECT_EQ(1, listener.connects);
+
+    ASSERT_TRUE(usb.sendData("d\n", 2));
+    EXPECT_EQ("d\n", arduino.receive());
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <deque>
+
+#include "windowedIntegral.h"
+
+TEST(WindowedIntegral, SumsOnlyTheWindow) {
+    WindowedIntegral integral(5);
+
+    for (int i = 1; i <= 7; i++) {
+        integral.add(i);
+    }
+
+    // 1 and 2 have been overwritten
+    EXPECT_FLOAT_EQ(3 + 4 + 5 + 6 + 7, integral.getSum());
+}
+
+TEST(WindowedIntegral, ResetForgetsEverything) {
+    WindowedIntegral integral(3);
+    integral.add(1);
+    integral.add(2);
+    integral.add(3);
+
+    integral.reset();
+    EXPECT_FLOAT_EQ(0, integral.getSum());
+
+    // slots written before the reset are not taken off the sum when overwritten
+    integral.add(4);
+    EXPECT_FLOAT_EQ(4, integral.getSum());
+    integral.add(5);
+    integral.add(6);
+    EXPECT_FLOAT_EQ(15, integral.getSum());
+
+    // and slots written after it are
+    integral.add(7);
+    EXPECT_FLOAT_EQ(5 + 6 + 7, integral.getSum());
+}
+
+TEST(WindowedIntegral, ResetPartWayAroundTheRing) {
+    WindowedIntegral integral(4);
+    integral.add(1);
+    integral.add(2);
+    integral.reset();
+    integral.add(3);
+
+    // the resum on wrapping must skip the two stale slots
+    integral.add(4);
+    integral.add(5);
+    EXPECT_FLOAT_EQ(12, integral.getSum());
+    integral.add(6);
+    EXPECT_FLOAT_EQ(18, integral.getSum());
+}
+
+TEST(WindowedIntegral, SetLengthForgets) {
+    WindowedIntegral integral(2);
+    integral.add(1);
+    integral.setLength(3);
+    EXPECT_EQ(3, integral.getLength());
+    EXPECT_FLOAT_EQ(0, integral.getSum());
+
+    integral.setLength(0);
+    EXPECT_EQ(1, integral.getLength());
+}
+
+// Against the old way of keeping the history: an array re-summed on every
+// read and zeroed on every reset.
+TEST(WindowedIntegral, MatchesRecomputedSum) {
+    const int length = 100;
+    WindowedIntegral integral(length);
+    std::deque<float> history;
+    srand(1);
+
+    for (int i = 0; i < 200000; i++) {
+        if (rand() % 500 == 0) {
+            integral.reset();
+            history.clear();
+        } else {
+            float error = (rand() % 2001 - 1000) / 1000.0;
+            integral.add(error);
+            history.push_back(error);
+            if (history.size() > length) history.pop_front();
+        }
+
+        if (i % 97 == 0) {
+            double sum = 0;
+            for (size_t k = 0; k < history.size(); k++) {
+                sum += history[k];
+            }
+            ASSERT_NEAR(sum, integral.getSum(), 1e-3) << "after " << i << " steps";
+        }
+    }
+}
@@ -0,0 +1,357 @@
+#!/usr/bin/env python
+"""
+Sweeps the rover tuning constants of launch/rover_params.yaml over a grid and
+writes, for every combination, the cubes collected per minute with a 95%
+confidence interval to CSV.
+
+Every trial is one simulated round. Trials run on a pool of worker processes,
+each one either
+
+  gazebo     a headless gzserver with its own ROS master and Gazebo master
+             port, set up the way the rqt GUI sets up a round: the world file,
+             the barriers, the collection disk and the rovers, each running
+             swarmie.launch with the trial's parameters, in autonomous mode
+             until the simulated time is up, then scored from
+             /collectionZone/score
+
+  kinematic  one round of mobility_sim, which runs the same mobility code in
+             a 2D stand-in for Gazebo several thousand times faster than real
+             time, for narrowing down a grid before running it in Gazebo.
+             Only the mobility group applies there.
+
+usage: param_sweep.py --sweep mobility/search_velocity=0.15,0.2,0.25
+         [--sweep group/name=v1,v2,...] [--trials N] [--jobs J]
+         [--backend gazebo|kinematic] [--world FILE] [--final] [--rovers N]
+         [--minutes M] [--seed S] [--output FILE] [--raw FILE]
+
+Run it from a shell where run.sh's environment is set up (SWARMATHON_APP_ROOT,
+GAZEBO_MODEL_PATH, GAZEBO_PLUGIN_PATH and devel/setup.bash).
+"""
+
+from __future__ import division, print_function
+
+import argparse
+import csv
+import itertools
+import math
+import multiprocessing
+import os
+import re
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+import yaml
+
+APP_ROOT = os.environ.get("SWARMATHON_APP_ROOT", os.getcwd())
+
+# the rqt GUI's start positions, names and headings, in the order it adds rovers
+ROVERS = [
+    ("achilles", -1.308, 0.000, 0.000),
+    ("aeneas", 0.000, -1.308, 1.571),
+    ("ajax", 1.308, 0.000, -3.142),
+    ("diomedes", 0.000, 1.308, -1.571),
+    ("hector", 1.072, 1.072, -2.356),
+    ("paris", -1.072, -1.072, 0.785),
+]
+
+PRELIM_ARENA = 15.0
+FINAL_ARENA = 23.1
+
+# each gazebo trial gets two ports from here up, one for roscore, one for gzserver
+BASE_PORT = 12000
+
+# two-sided 95% Student t quantiles by degrees of freedom, 1.96 beyond the table
+T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+def parse_sweep(text):
+    """group/name=v1,v2,... into (key, [values])"""
+    match = re.match(r"^(\w+)/(\w+)=(.+)$", text)
+    if not match:
+        raise argparse.ArgumentTypeError("expected group/name=v1,v2,... not " + text)
+    try:
+        values = [float(value) for value in match.group(3).split(",")]
+    except ValueError:
+        raise argparse.ArgumentTypeError("values must be numbers in " + text)
+    return (match.group(1) + "/" + match.group(2), values)
+
+
+def run_quiet(command, env, timeout=None):
+    """runs command to completion, returns its output or None on failure"""
+    process = subprocess.Popen(command, env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                               universal_newlines=True)
+    start = time.time()
+    while process.poll() is None:
+        if timeout is not None and time.time() - start > timeout:
+            process.kill()
+            process.wait()
+            return None
+        time.sleep(0.1)
+    output = process.stdout.read()
+    return output if process.returncode == 0 else None
+
+
+def run_kinematic(options, overrides, seed):
+    """collected cubes of one mobility_sim round, None on failure"""
+    command = [options.sim, "--rounds", "1", "--jobs", "1", "--seed", str(seed),
+               "--rovers", str(options.rovers), "--minutes", str(options.minutes)]
+    if options.final:
+        command.append("--final")
+    if options.world:
+        command += ["--world", options.world]
+    for key, value in sorted(overrides.items()):
+        group, name = key.split("/")
+        if group == "mobility":
+            command += ["--param", "%s=%g" % (name, value)]
+
+    output = run_quiet(command, os.environ.copy())
+    if output is None:
+        return None
+
+    # header then one round, collected is the seventh column
+    lines = [line for line in output.splitlines() if line and line[0].isdigit()]
+    if not lines:
+        return None
+    return int(lines[0].split(",")[6])
+
+
+def write_params(base, overrides, path):
+    params = dict((group, dict(values)) for group, values in base.items())
+    for key, value in overrides.items():
+        group, name = key.split("/")
+        params.setdefault(group, {})[name] = value
+    with open(path, "w") as params_file:
+        yaml.safe_dump(params, params_file, default_flow_style=False)
+
+
+def spawn_model(env, model, name, x=0.0, y=0.0, yaw=0.0):
+    return run_quiet(["rosrun", "gazebo_ros", "spawn_model", "-sdf",
+                      "-file", os.path.join(APP_ROOT, "simulation", "models", model, "model.sdf"),
+                      "-model", name, "-x", str(x), "-y", str(y), "-z", "0",
+                      "-R", "0", "-P", "0", "-Y", str(yaw)], env, timeout=60) is not None
+
+
+def echo_once(env, topic, field):
+    """the value of field in the next message on topic, None if there is none"""
+    output = run_quiet(["rostopic", "echo", "-n", "1", topic], env, timeout=10)
+    if output is None:
+        return None
+    match = re.search(r"^\s*" + field + r":\s*\"?([^\"\n]*)\"?", output, re.MULTILINE)
+    return match.group(1) if match else None
+
+
+def run_gazebo(options, overrides, seed, trial):
+    """collected cubes of one headless Gazebo round, None on failure"""
+    ros_port = BASE_PORT + 2 * trial
+    gazebo_port = ros_port + 1
+
+    env = os.environ.copy()
+    env["ROS_MASTER_URI"] = "http://localhost:%d" % ros_port
+    env["GAZEBO_MASTER_URI"] = "http://localhost:%d" % gazebo_port
+    env["ROS_LOG_DIR"] = tempfile.mkdtemp(prefix="param_sweep_log_")
+
+    params_path = os.path.join(env["ROS_LOG_DIR"], "rover_params.yaml")
+    write_params(options.base_params, overrides, params_path)
+
+    # everything a trial starts goes into its own process group so a trial
+    # cleans up after itself without touching the others
+    processes = []
+
+    def start(command):
+        processes.append(subprocess.Popen(command, env=env, stdout=open(os.devnull, "w"),
+                                          stderr=subprocess.STDOUT, preexec_fn=os.setsid))
+
+    try:
+        start(["roscore", "-p", str(ros_port)])
+        for attempt in range(100):
+            if run_quiet(["rosparam", "set", "/use_sim_time", "true"], env, timeout=5) is not None:
+                break
+            time.sleep(0.2)
+        else:
+            return None
+
+        # the cubes are fixed by the world file, so trials of one combination
+        # only differ by gazebo's own timing and noise
+        start(["rosrun", "gazebo_ros", "gzserver", options.world])
+        for attempt in range(300):
+            if echo_once(env, "/clock", "secs") is not None:
+                break
+            time.sleep(0.2)
+        else:
+            return None
+
+        arena = FINAL_ARENA if options.final else PRELIM_ARENA
+        barrier = "barrier_final_round" if options.final else "barrier_prelim_round"
+        models = [(barrier, "Barrier_West", -arena / 2, 0, 0),
+                  (barrier, "Barrier_North", 0, -arena / 2, math.pi / 2),
+                  (barrier, "Barrier_East", arena / 2, 0, 0),
+                  (barrier, "Barrier_South", 0, arena / 2, math.pi / 2),
+                  ("collection_disk", "collection_disk", 0, 0, 0)]
+        models += [(name, name, x, y, yaw) for name, x, y, yaw in ROVERS[:options.rovers]]
+        for model, name, x, y, yaw in models:
+            if not spawn_model(env, model, name, x, y, yaw):
+                return None
+
+        for name, x, y, yaw in ROVERS[:options.rovers]:
+            start(["roslaunch", os.path.join(APP_ROOT, "launch", "swarmie.launch"),
+                   "name:=" + name, "params:=" + params_path])
+        for name, x, y, yaw in ROVERS[:options.rovers]:
+            start(["rostopic", "pub", "--latch", "/" + name + "/mode", "std_msgs/UInt8", "data: 2"])
+
+        # the round is over after minutes of simulated time, however long that takes
+        started = None
+        while True:
+            seconds = echo_once(env, "/clock", "secs")
+            if seconds is not None:
+                if started is None:
+                    started = int(seconds)
+                elif int(seconds) - started >= options.minutes * 60:
+                    break
+            time.sleep(2)
+
+        score = echo_once(env, "/collectionZone/score", "data")
+        return int(score) if score is not None else 0
+    finally:
+        for process in reversed(processes):
+            try:
+                os.killpg(process.pid, signal.SIGINT)
+            except OSError:
+                pass
+        time.sleep(2)
+        for process in reversed(processes):
+            try:
+                os.killpg(process.pid, signal.SIGKILL)
+            except OSError:
+                pass
+            process.wait()
+        shutil.rmtree(env["ROS_LOG_DIR"], ignore_errors=True)
+
+
+def run_trial(task):
+    options, configuration, overrides, trial, seed = task
+    if options.backend == "gazebo":
+        collected = run_gazebo(options, overrides, seed, trial)
+    else:
+        collected = run_kinematic(options, overrides, seed)
+    return configuration, trial, seed, collected
+
+
+def summarise(rates):
+    """mean and half width of the 95% confidence interval"""
+    n = len(rates)
+    mean = sum(rates) / n
+    if n < 2:
+        return mean, float("nan")
+    variance = sum((rate - mean) ** 2 for rate in rates) / (n - 1)
+    t = T95[n - 1] if n - 1 < len(T95) else 1.96
+    return mean, t * math.sqrt(variance / n)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sweeps rover tuning constants in simulation.")
+    parser.add_argument("--sweep", type=parse_sweep, action="append", required=True,
+                        help="group/name=v1,v2,... from launch/rover_params.yaml, repeat for a grid")
+    parser.add_argument("--trials", type=int, default=10, help="rounds per combination")
+    parser.add_argument("--jobs", type=int, default=None,
+                        help="trials run at once, defaults to the number of cpus (gazebo: a quarter of them)")
+    parser.add_argument("--backend", choices=["gazebo", "kinematic"], default="gazebo")
+    parser.add_argument("--world", default=None,
+                        help="world file, gazebo defaults to simulation/worlds/uniform_targets_example.world, "
+                             "kinematic to 256 cubes placed uniformly from the seed")
+    parser.add_argument("--final", action="store_true", help="final round arena and barriers")
+    parser.add_argument("--rovers", type=int, default=3)
+    parser.add_argument("--minutes", type=float, default=30, help="simulated minutes per round")
+    parser.add_argument("--seed", type=int, default=1, help="trial n of every combination uses seed + n")
+    parser.add_argument("--params", default=os.path.join(APP_ROOT, "launch", "rover_params.yaml"),
+                        help="values for everything not swept")
+    parser.add_argument("--sim", default=os.path.join(APP_ROOT, "devel", "lib", "mobility", "mobility_sim"),
+                        help="mobility_sim executable for the kinematic backend")
+    parser.add_argument("--output", default="-", help="summary CSV, - for stdout")
+    parser.add_argument("--raw", default=None, help="also write one CSV line per trial here")
+    options = parser.parse_args()
+
+    if options.world is None and options.backend == "gazebo":
+        options.world = os.path.join(APP_ROOT, "simulation", "worlds", "uniform_targets_example.world")
+    if options.jobs is None:
+        cpus = multiprocessing.cpu_count()
+        options.jobs = max(1, cpus // 4) if options.backend == "gazebo" else cpus
+    if options.trials < 1 or options.jobs < 1 or options.minutes <= 0 or not 1 <= options.rovers <= 6:
+        parser.error("trials and jobs must be positive, minutes above zero, and rovers 1 to 6")
+
+    with open(options.params) as params_file:
+        options.base_params = yaml.safe_load(params_file) or {}
+
+    keys = [key for key, values in options.sweep]
+    for key in keys:
+        group, name = key.split("/")
+        if name not in options.base_params.get(group, {}):
+            parser.error("%s is not in %s" % (key, options.params))
+        if options.backend == "kinematic" and group != "mobility":
+            print("param_sweep: %s has no effect in the kinematic backend" % key, file=sys.stderr)
+
+    configurations = list(itertools.product(*[values for key, values in options.sweep]))
+    tasks = []
+    for configuration in configurations:
+        overrides = dict(zip(keys, configuration))
+        for trial in range(options.trials):
+            # the same seeds for every combination so they see the same arenas
+            tasks.append((options, configuration, overrides, len(tasks), options.seed + trial))
+
+    print("param_sweep: %d combinations x %d trials on %d %s workers"
+          % (len(configurations), options.trials, options.jobs, options.backend), file=sys.stderr)
+
+    # ctrl-c is handled here, the workers clean up their trial when terminated
+    original_handler = signal.signal(signal.SIGINT, signal.SIG_IGN)
+    pool = multiprocessing.Pool(options.jobs)
+    signal.signal(signal.SIGINT, original_handler)
+
+    results = dict((configuration, []) for configuration in configurations)
+    raw = []
+    start = time.time()
+    try:
+        for done, (configuration, trial, seed, collected) in enumerate(pool.imap_unordered(run_trial, tasks), 1):
+            if collected is None:
+                print("param_sweep: trial %d (%s, seed %d) failed" % (trial, configuration, seed), file=sys.stderr)
+            else:
+                results[configuration].append(collected / options.minutes)
+                raw.append(list(configuration) + [trial, seed, collected])
+            print("param_sweep: %d/%d trials, %.0f s" % (done, len(tasks), time.time() - start), file=sys.stderr)
+        pool.close()
+    except KeyboardInterrupt:
+        pool.terminate()
+        raise
+    finally:
+        pool.join()
+
+    output = sys.stdout if options.output == "-" else open(options.output, "w")
+    writer = csv.writer(output)
+    writer.writerow(keys + ["trials", "cubes_per_minute", "ci95_low", "ci95_high"])
+    for configuration in configurations:
+        rates = results[configuration]
+        if not rates:
+            writer.writerow(list(configuration) + [0, "", "", ""])
+            continue
+        mean, half_width = summarise(rates)
+        writer.writerow(list(configuration) + [len(rates), "%.4f" % mean,
+                                               "%.4f" % (mean - half_width), "%.4f" % (mean + half_width)])
+    if output is not sys.stdout:
+        output.close()
+
+    if options.raw:
+        with open(options.raw, "w") as raw_file:
+            writer = csv.writer(raw_file)
+            writer.writerow(keys + ["trial", "seed", "collected"])
+            for row in sorted(raw, key=lambda row: row[len(keys)]):
+                writer.writerow(row)
+
+    return 0 if all(results.values()) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
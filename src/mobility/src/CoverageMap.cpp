@@ -0,0 +1,130 @@
+#include "CoverageMap.h"
+
+#include <cmath>
+
+CoverageMap::CoverageMap(double halfSize, double resolution) {
+  if (resolution <= 0) resolution = 0.25;
+  if (halfSize < resolution) halfSize = resolution;
+
+  this->halfSize = halfSize;
+  this->resolution = resolution;
+  cellsPerSide = (int)ceil(2 * halfSize / resolution);
+
+  footprintNear = 0.2;
+  footprintFar = 0.6;
+  footprintWidth = 0.5;
+
+  bits.resize((cellsPerSide * cellsPerSide + 63) / 64);
+  reset();
+}
+
+void CoverageMap::markFootprint(double x, double y, double theta, std::vector<int>* newlyCovered) {
+  double cosTheta = cos(theta);
+  double sinTheta = sin(theta);
+
+  // sample the footprint at half the cell size so every cell under it is hit
+  double step = resolution / 2;
+  for (double forward = footprintNear; forward <= footprintFar; forward += step) {
+    for (double side = -footprintWidth / 2; side <= footprintWidth / 2; side += step) {
+      int index = cellIndex(x + forward * cosTheta - side * sinTheta, y + forward * sinTheta + side * cosTheta);
+      if (index >= 0 && markCell(index) && newlyCovered != NULL) {
+        newlyCovered->push_back(index);
+      }
+    }
+  }
+}
+
+bool CoverageMap::contains(double x, double y) {
+  return cellIndex(x, y) >= 0;
+}
+
+bool CoverageMap::isCovered(double x, double y) {
+  int index = cellIndex(x, y);
+  return index >= 0 && isCellCovered(index);
+}
+
+int CoverageMap::uncoveredAlong(double x0, double y0, double x1, double y1) {
+  double length = hypot(x1 - x0, y1 - y0);
+  if (length == 0) return 0;
+
+  double dirX = (x1 - x0) / length;
+  double dirY = (y1 - y0) / length;
+  double forward = (footprintNear + footprintFar) / 2;
+
+  // the swept strip is sampled once per cell along and across it, a cell
+  // can be counted twice where the strip runs diagonally, which is fine for
+  // comparing candidate goals
+  int uncovered = 0;
+  for (double along = 0; along <= length; along += resolution) {
+    for (double side = -footprintWidth / 2; side <= footprintWidth / 2; side += resolution) {
+      double sampleX = x0 + (along + forward) * dirX - side * dirY;
+      double sampleY = y0 + (along + forward) * dirY + side * dirX;
+
+      int index = cellIndex(sampleX, sampleY);
+      if (index >= 0 && !isCellCovered(index)) uncovered++;
+    }
+  }
+
+  return uncovered;
+}
+
+bool CoverageMap::nearestUncovered(double x, double y, double& uncoveredX, double& uncoveredY) {
+  if (coveredCount == getCellCount()) return false;
+
+  double bestDistance = -1;
+  int bestIndex = -1;
+
+  for (size_t word = 0; word < bits.size(); word++) {
+    // skip 64 covered cells at a time
+    if (bits[word] == ~(uint64_t)0) continue;
+
+    for (int bit = 0; bit < 64; bit++) {
+      int index = word * 64 + bit;
+      if (index >= (int)getCellCount()) break;
+      if (isCellCovered(index)) continue;
+
+      double cellX, cellY;
+      getCellCenter(index, cellX, cellY);
+      double distance = (cellX - x) * (cellX - x) + (cellY - y) * (cellY - y);
+
+      if (bestIndex < 0 || distance < bestDistance) {
+        bestDistance = distance;
+        bestIndex = index;
+      }
+    }
+  }
+
+  if (bestIndex < 0) return false;
+
+  getCellCenter(bestIndex, uncoveredX, uncoveredY);
+  return true;
+}
+
+void CoverageMap::reset() {
+  for (size_t i = 0; i < bits.size(); i++) {
+    bits[i] = 0;
+  }
+  coveredCount = 0;
+}
+
+int CoverageMap::cellIndex(double x, double y) {
+  int cellX = (int)floor((x + halfSize) / resolution);
+  int cellY = (int)floor((y + halfSize) / resolution);
+
+  if (cellX < 0 || cellX >= cellsPerSide || cellY < 0 || cellY >= cellsPerSide) return -1;
+  return cellY * cellsPerSide + cellX;
+}
+
+void CoverageMap::getCellCenter(int index, double& x, double& y) {
+  x = (index % cellsPerSide + 0.5) * resolution - halfSize;
+  y = (index / cellsPerSide + 0.5) * resolution - halfSize;
+}
+
+bool CoverageMap::markCell(int index) {
+  uint64_t bit = (uint64_t)1 << (index & 63);
+  if (bits[index >> 6] & bit) return false;
+
+  bits[index >> 6] |= bit;
+  coveredCount++;
+  return true;
+}
@@ -0,0 +1,71 @@
+#ifndef COVERAGE_MAP_H
+#define COVERAGE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Remembers which parts of the arena the rover's camera has already looked
+ * at, one bit per cell.
+ *
+ * The map is a square centered on the origin of the frame it is fed in,
+ * mobility uses odom, whose origin is where the rover started next to the
+ * collection disk. The default 25m square at 0.25m cells covers the final
+ * round arena from any starting position and takes about 1.2KB.
+ * Not thread safe.
+ */
+class CoverageMap {
+
+  public:
+
+    CoverageMap(double halfSize = 12.5, double resolution = 0.25);
+
+    // marks the cells the camera sees from this pose as covered, and appends
+    // the ones that were not covered before to newlyCovered if it is given
+    void markFootprint(double x, double y, double theta, std::vector<int>* newlyCovered = NULL);
+
+    bool contains(double x, double y);
+    bool isCovered(double x, double y);
+
+    // number of uncovered cells the camera would sweep driving in a straight
+    // line between the two points
+    int uncoveredAlong(double x0, double y0, double x1, double y1);
+
+    // center of the closest uncovered cell, false if every cell is covered
+    bool nearestUncovered(double x, double y, double& uncoveredX, double& uncoveredY);
+
+    // index of the cell containing (x, y), -1 when outside the map
+    int cellIndex(double x, double y);
+
+    void getCellCenter(int index, double& x, double& y);
+
+    bool isCellCovered(int index) {return (bits[index >> 6] >> (index & 63)) & 1;}
+
+    // marks one cell, true if it was not covered before
+    bool markCell(int index);
+
+    unsigned int getCoveredCount() {return coveredCount;}
+    unsigned int getCellCount() {return cellsPerSide * cellsPerSide;}
+    int getCellsPerSide() {return cellsPerSide;}
+    double getResolution() {return resolution;}
+    double getCellArea() {return resolution * resolution;}
+
+    void reset();
+
+    // the part of the ground in view of the camera, as a rectangle ahead of
+    // base_link (meters)
+    double footprintNear;
+    double footprintFar;
+    double footprintWidth;
+
+  private:
+
+    double halfSize;
+    double resolution;
+    int cellsPerSide;
+    unsigned int coveredCount;
+    std::vector<uint64_t> bits;
+};
+
+#endif /* COVERAGE_MAP_H */
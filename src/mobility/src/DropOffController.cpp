@@ -1,5 +1,7 @@
 #include "DropOffController.h"
 
+#include <ros/ros.h>
+
 DropOffController::DropOffController() {
     cameraOffsetCorrection = 0.020; //meters
     centeringTurn = 0.15; //radians
@@ -8,6 +10,7 @@ DropOffController::DropOffController() {
     reachedCollectionPoint = false;
     spinSize = 0.10; //in meters aka 10cm 
     addSpinSizeAmmount = 0.10; //in meters
+    addSpinSize = 0;
 
     result.cmdVel = 0;
     result.angleError = 0;
@@ -24,10 +27,10 @@ DropOffController::DropOffController() {
     circularCenterSearching = false;
     spinner = 0;
     centerApproach = false;
-    timeWithoutSeeingEnoughCenterTags = time(0);
+    timeWithoutSeeingEnoughCenterTags = ros::Time::now().sec;
     seenEnoughCenterTags = false;
     centerSeen = false;
-    timeElapsedSinceTimeSinceSeeingEnoughCenterTags = time(0);
+    timeElapsedSinceTimeSinceSeeingEnoughCenterTags = ros::Time::now().sec;
     circularCenterSearching = false;
     prevCount = 0;
 
@@ -103,7 +106,7 @@ void DropOffController::calculateDecision() {
 
 
     //reset timeWithoutSeeingEnoughCenterTags timout timer to current time
-    if ((!centerApproach && !seenEnoughCenterTags) || (count > 0 && !seenEnoughCenterTags)) timeWithoutSeeingEnoughCenterTags = time(0);
+    if ((!centerApproach && !seenEnoughCenterTags) || (count > 0 && !seenEnoughCenterTags)) timeWithoutSeeingEnoughCenterTags = ros::Time::now().sec;
 
     if (count > 0 || seenEnoughCenterTags || prevCount > 0) //if we have a target and the center is located drive towards it.
     {
@@ -151,14 +154,14 @@ void DropOffController::calculateDecision() {
         if (count > seenEnoughCenterTagsCount)
         {
             seenEnoughCenterTags = true; //we have driven far enough forward to be in the circle.
-            timeWithoutSeeingEnoughCenterTags = time(0);
+            timeWithoutSeeingEnoughCenterTags = ros::Time::now().sec;
         }
         if (count > 0) //reset gaurd to prevent drop offs due to loosing tracking on tags for a frame or 2.
         {
-            timeWithoutSeeingEnoughCenterTags = time(0);
+            timeWithoutSeeingEnoughCenterTags = ros::Time::now().sec;
         }
         //time since we dropped below countGuard tags
-        timeElapsedSinceTimeSinceSeeingEnoughCenterTags = time(0) - timeWithoutSeeingEnoughCenterTags;
+        timeElapsedSinceTimeSinceSeeingEnoughCenterTags = ros::Time::now().sec - timeWithoutSeeingEnoughCenterTags;
 
         //we have driven far enough forward to have passed over the circle.
         if (count == 0 && seenEnoughCenterTags && timeElapsedSinceTimeSinceSeeingEnoughCenterTags > 1) {
@@ -174,7 +177,7 @@ void DropOffController::calculateDecision() {
         result.goalDriving = false;
         int maxTimeAllowedWithoutSeeingCenterTags = 6; //seconds
 
-        timeElapsedSinceTimeSinceSeeingEnoughCenterTags = time(0) - timeWithoutSeeingEnoughCenterTags;
+        timeElapsedSinceTimeSinceSeeingEnoughCenterTags = ros::Time::now().sec - timeWithoutSeeingEnoughCenterTags;
         if (timeElapsedSinceTimeSinceSeeingEnoughCenterTags > maxTimeAllowedWithoutSeeingCenterTags)
         {
             //go back to drive to center base location instead of drop off attempt
@@ -199,7 +202,7 @@ void DropOffController::calculateDecision() {
     if (!centerSeen && seenEnoughCenterTags)
     {
         reachedCollectionPoint = true;
-        timerStartTime = time(0);
+        timerStartTime = ros::Time::now().sec;
         result.goalDriving = false;
         centerApproach = false;
         result.timer = true;
@@ -242,6 +245,15 @@ void DropOffController::reset() {
 
 }
 
+void DropOffController::setParams(const RoverParams& params) {
+    searchVelocity = params.centerSearchVelocity;
+    centeringTurn = params.centeringTurn;
+    seenEnoughCenterTagsCount = (int)params.seenEnoughCenterTags;
+    collectionPointVisualDistance = params.collectionPointVisualDistance;
+    spinSize = params.spinSize;
+    addSpinSizeAmmount = params.spinSizeIncrement;
+}
+
 void DropOffController::setDataTargets(int ccount, double lleft, double rright)
 {
     count = ccount;
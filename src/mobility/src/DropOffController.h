@@ -5,6 +5,8 @@
 #include <geometry_msgs/Pose2D.h>
 #include <std_msgs/Float32.h>
 
+#include "RoverParams.h"
+
 struct DropOffResult {
     float cmdVel;
     float angleError;
@@ -33,6 +35,9 @@ public:
     void setCenterDist(float dist) {distanceToCenter = dist;}
     void setDataLocations(geometry_msgs::Pose2D center, geometry_msgs::Pose2D current, float sync);
 
+    // takes the drop off constants from params
+    void setParams(const RoverParams& params);
+
 private:
 
     bool right;
@@ -54,6 +59,7 @@ private:
     //central collection point has been seen (aka the nest)
     bool centerSeen;
 
+    // whole seconds of ros::Time, so simulated runs follow the sim clock
     time_t timeWithoutSeeingEnoughCenterTags;
     float cameraOffsetCorrection;
     float centeringTurn;
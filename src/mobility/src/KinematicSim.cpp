@@ -0,0 +1,954 @@
+#include "KinematicSim.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <angles/angles.h>
+#include <apriltags_ros/AprilTagDetectionArray.h>
+#include <random_numbers/random_numbers.h>
+#include <ros/ros.h>
+
+#include "PickUpController.h"
+#include "DropOffController.h"
+#include "OccupancyGrid.h"
+#include "CoverageMap.h"
+#include "TargetMemory.h"
+
+// same numbering as RoverBrain
+#define STATE_MACHINE_TRANSFORM 0
+#define STATE_MACHINE_ROTATE 1
+#define STATE_MACHINE_SKID_STEER 2
+#define STATE_MACHINE_PICKUP 3
+#define STATE_MACHINE_DROPOFF 4
+
+// the state machine runs at mobility's default loop rate, the rovers move in
+// smaller steps in between
+static const double tickRate = 10; // Hz
+static const int moveSteps = 4;
+
+static const double roverRadius = 0.2; // m
+
+// where the camera sits ahead of base_link and how much ground it sees,
+// measured along the ground from below the camera (m, radians), from the
+// camera pose, pitch and field of view in the rover models, and how often it
+// sends a frame
+static const double cameraForward = 0.145;
+static const double cameraHeight = 0.195;
+static const double cameraHalfFov = 0.506;
+static const double cameraNear = 0.12;
+static const double cameraFar = 0.8;
+static const double cameraRate = 6; // Hz
+
+// tags are found every frame up to this far, past it the detector misses
+// more of them the farther they are, until none are found at cameraFar
+static const double cameraReliable = 0.5;
+
+// PickUpController adds this back to the tag's x position
+static const double cameraOffsetCorrection = 0.020;
+
+// a cube between the fingers when they close is picked up
+static const double gripperNear = 0.1;
+static const double gripperFar = 0.35;
+static const double gripperHalfWidth = 0.1;
+static const double gripperDropDistance = 0.25;
+
+// a held cube blocks the center sonar unless the wrist is lowered past this
+static const double wristClearsSonar = 0.4;
+static const double heldCubeRange = 0.1;
+
+// the sonars as in RoverBrain, and the obstacle node's distances
+struct SonarMount {
+  double x;
+  double y;
+  double heading;
+};
+
+static const SonarMount sonarMounts[] = {
+  {0.15, 0.07, 0.43633},  // left
+  {0.15, 0.0, 0.0},       // center
+  {0.15, -0.07, -0.43633} // right
+};
+
+static const double sonarHalfAngle = 0.25;
+static const double sonarMaxRange = 3.0;
+static const double collisionDistance = 0.6;
+static const double blockDistance = 0.12;
+static const double obstacleKeepalive = 1.0; // seconds
+
+// RoverBrain's /swarmMap timer and how often it sends the whole map, and
+// where it puts a target it sees, the camera giving no usable range
+static const double swarmMapPublishInterval = 2; // seconds
+static const int swarmMapFullEvery = 30;
+static const double targetSightingDistance = 0.4;
+
+// the collection disk is a 1.016m square with a border of tags two rows deep
+static const double diskHalfSize = 0.508;
+static const double diskTagSpacing = 0.1;
+static const double diskTagRows[] = {0.03, 0.09};
+
+// the rqt GUI's starting positions around the collection disk
+static const double startPositions[6][3] = {
+  {-1.308, 0.000, 0.000},
+  {0.000, -1.308, 1.571},
+  {1.308, 0.000, -3.142},
+  {0.000, 1.308, -1.571},
+  {1.072, 1.072, -2.356},
+  {-1.072, -1.072, 0.785}
+};
+
+// targets are kept this far from the walls and the disk, like the GUI does
+static const double targetClearance = 0.5;
+
+/**
+ * One simulated rover: its sensors and the mobility logic of RoverBrain,
+ * without the ROS topics in between. The state machine below follows
+ * RoverBrain::runStateMachine() and RoverBrain::processTargets() so the
+ * controllers see the same sequence of calls as on a real rover.
+ */
+class KinematicSim::Rover {
+
+  public:
+
+    Rover(KinematicSim* sim, int index, unsigned int seed);
+
+    void sense(double now);
+    void control(double now);
+    void move(double dt);
+
+    // like RoverBrain's /swarmMap timer and mergeSwarmMaps(), odom is the
+    // map frame here
+    bool buildSwarmMessage(mobility::SwarmMapDelta& message);
+    void mergeSwarmMessage(const mobility::SwarmMapDelta& message);
+
+    geometry_msgs::Pose2D pose;
+    double distanceDriven;
+
+  private:
+
+    void processTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message);
+    void processObstacle(unsigned char code);
+    void avoidObstacle(unsigned char code);
+    void runStateMachine(double now);
+
+    void sendDriveCommand(double linearVel, double angularError);
+    void publishFingerAngle(float angle);
+    void publishWristAngle(float angle);
+
+    KinematicSim* sim;
+    int index;
+
+    PickUpController pickUpController;
+    DropOffController dropOffController;
+    SearchController searchController;
+    OccupancyGrid occupancyGrid;
+    CoverageMap coverageMap;
+    TargetMemory targetMemory;
+    SwarmMap swarmMap;
+    std::string swarmName;
+    int swarmMapTicks;
+    std::vector<int> newlyCovered;
+
+    geometry_msgs::Pose2D currentLocation;
+    geometry_msgs::Pose2D goalLocation;
+    geometry_msgs::Pose2D centerLocation;
+    geometry_msgs::Pose2D centerLocationOdom;
+
+    bool targetDetected;
+    bool targetCollected;
+    bool lockTarget;
+    bool blockBlock;
+    bool centerSeen;
+    bool reachedCollectionPoint;
+    bool init;
+    bool avoidingObstacle;
+    unsigned char obstacleCode;
+    double lastObstacleMessage;
+    int stateMachineState;
+    float searchVelocity;
+
+    long timerStartTime; // whole seconds, like time(0)
+    float timerTimeElapsed;
+
+    double sonarRanges[3];
+    int lastCameraFrame;
+    random_numbers::RandomNumberGenerator cameraNoise;
+
+    // reused for every frame that nothing held on to, with room for every
+    // tag in the arena, so a camera frame costs no allocations
+    apriltags_ros::AprilTagDetectionArray::Ptr cameraMessage;
+
+    // wheel speeds from the last drive command, after sbridge's mapping
+    double linear;
+    double angular;
+
+    float fingerAngle;
+    float wristAngle;
+};
+
+KinematicSim::Config::Config() {
+  arenaSize = 15;
+  rovers = 3;
+  duration = 1800;
+  seed = 1;
+  searchMode = SearchController::RANDOM_WALK;
+  targetMemory = true;
+  swarmMap = true;
+}
+
+KinematicSim::KinematicSim(const Config& config) :
+  config(config),
+  arenaCoverage(config.arenaSize / 2, 0.25) {
+  // the controllers read the clock as soon as they are built
+  ros::Time::init();
+  ros::Time::setNow(ros::Time(1));
+
+  if (this->config.rovers < 1) this->config.rovers = 1;
+  if (this->config.rovers > 6) this->config.rovers = 6;
+
+  for (int row = 0; row < 2; row++) {
+    double edge = diskHalfSize - diskTagRows[row];
+    int perSide = (int)(2 * edge / diskTagSpacing);
+
+    for (int side = 0; side < 4; side++) {
+      for (int i = 0; i < perSide; i++) {
+        double along = -edge + i * diskTagSpacing;
+        geometry_msgs::Pose2D tag;
+        tag.x = side == 0 ? along : side == 1 ? edge : side == 2 ? -along : -edge;
+        tag.y = side == 0 ? -edge : side == 1 ? along : side == 2 ? edge : -along;
+        tag.theta = 0;
+        centerTags.push_back(tag);
+      }
+    }
+  }
+
+  placeTargets();
+
+  for (int i = 0; i < this->config.rovers; i++) {
+    rovers.push_back(new Rover(this, i, this->config.seed * 16 + i));
+  }
+
+  result.collected = 0;
+  result.firstCollection = -1;
+  result.lastCollection = -1;
+  result.distanceDriven = 0;
+  result.areaCovered = 0;
+  result.ticks = 0;
+  result.swarmMessages = 0;
+  result.swarmBytes = 0;
+}
+
+KinematicSim::~KinematicSim() {
+  for (size_t i = 0; i < rovers.size(); i++) {
+    delete rovers[i];
+  }
+}
+
+KinematicSim::Result KinematicSim::run() {
+  long ticks = (long)(config.duration * tickRate);
+
+  while (result.ticks < ticks) {
+    step();
+  }
+
+  result.distanceDriven = 0;
+  for (size_t i = 0; i < rovers.size(); i++) {
+    result.distanceDriven += rovers[i]->distanceDriven;
+  }
+  result.areaCovered = (double)arenaCoverage.getCoveredCount() / arenaCoverage.getCellCount();
+
+  return result;
+}
+
+void KinematicSim::step() {
+  double dt = 1 / tickRate;
+  double now = result.ticks * dt;
+  ros::Time::setNow(ros::Time(now + 1)); // ros::Time(0) means unset
+
+  for (size_t i = 0; i < rovers.size(); i++) {
+    rovers[i]->sense(now);
+  }
+
+  for (size_t i = 0; i < rovers.size(); i++) {
+    rovers[i]->control(now);
+  }
+
+  int publishTicks = (int)(swarmMapPublishInterval * tickRate + 0.5);
+  if (config.swarmMap && result.ticks % publishTicks == 0) {
+    exchangeSwarmMaps();
+  }
+
+  for (int substep = 0; substep < moveSteps; substep++) {
+    for (size_t i = 0; i < rovers.size(); i++) {
+      rovers[i]->move(dt / moveSteps);
+    }
+  }
+
+  result.ticks++;
+}
+
+void KinematicSim::exchangeSwarmMaps() {
+  for (size_t i = 0; i < rovers.size(); i++) {
+    if (!rovers[i]->buildSwarmMessage(swarmMessage)) continue;
+
+    // as roscpp serializes it, the length prefix of each field and of the
+    // message included, but not the TCP/IP framing around it
+    double size = 4 + 4 + swarmMessage.rover.size() + 4 + 1 + 4 + 2 +
+                  4 + swarmMessage.covered.size() + 4 + swarmMessage.targets_seen.size() + 4 + swarmMessage.targets_collected.size();
+
+    for (size_t j = 0; j < rovers.size(); j++) {
+      if (j == i) continue;
+      rovers[j]->mergeSwarmMessage(swarmMessage);
+      result.swarmBytes += 2 * size;
+    }
+    result.swarmMessages++;
+  }
+}
+
+bool KinematicSim::loadWorldTargets(const std::string& path, std::vector<geometry_msgs::Pose2D>& targets) {
+  std::ifstream world(path.c_str());
+  if (!world) return false;
+
+  // A model's own pose is the last <pose> before its </model>, the ones
+  // before it belong to its links. Cubes are listed once in the world and
+  // once more in its saved <state>, the later position wins.
+  std::vector<std::string> names;
+  std::vector<geometry_msgs::Pose2D> poses;
+  std::string line;
+  std::string model;
+  geometry_msgs::Pose2D lastPose;
+  bool havePose = false;
+
+  while (std::getline(world, line)) {
+    size_t found = line.find("<model name='at");
+    if (found != std::string::npos) {
+      size_t start = found + 13;
+      model = line.substr(start, line.find('\'', start) - start);
+      havePose = false;
+      continue;
+    }
+
+    found = line.find("<pose>");
+    if (found != std::string::npos && !model.empty()) {
+      double z;
+      havePose = sscanf(line.c_str() + found + 6, "%lf %lf %lf", &lastPose.x, &lastPose.y, &z) == 3;
+      continue;
+    }
+
+    if (line.find("</model>") != std::string::npos) {
+      if (!model.empty() && havePose) {
+        lastPose.theta = 0;
+
+        size_t i = 0;
+        while (i < names.size() && names[i] != model) i++;
+        if (i == names.size()) {
+          names.push_back(model);
+          poses.push_back(lastPose);
+        } else {
+          poses[i] = lastPose;
+        }
+      }
+      model.clear();
+    }
+  }
+
+  targets = poses;
+  return !targets.empty();
+}
+
+void KinematicSim::placeTargets() {
+  std::vector<geometry_msgs::Pose2D> positions = config.targets;
+
+  if (positions.empty()) {
+    random_numbers::RandomNumberGenerator rng(config.seed);
+    double limit = config.arenaSize / 2 - targetClearance;
+
+    while (positions.size() < 256) {
+      geometry_msgs::Pose2D target;
+      target.x = rng.uniformReal(-limit, limit);
+      target.y = rng.uniformReal(-limit, limit);
+      target.theta = 0;
+
+      if (fabs(target.x) < diskHalfSize + targetClearance && fabs(target.y) < diskHalfSize + targetClearance) continue;
+      positions.push_back(target);
+    }
+  }
+
+  for (size_t i = 0; i < positions.size(); i++) {
+    Cube cube;
+    cube.x = positions[i].x;
+    cube.y = positions[i].y;
+    cube.heldBy = -1;
+    cube.collected = false;
+    cubes.push_back(cube);
+  }
+}
+
+double KinematicSim::castRay(int rover, double x, double y, double heading, double maxRange) {
+  double dirX = cos(heading);
+  double dirY = sin(heading);
+  double range = maxRange;
+
+  // the four walls
+  double half = config.arenaSize / 2;
+  if (dirX > 0) range = std::min(range, (half - x) / dirX);
+  if (dirX < 0) range = std::min(range, (-half - x) / dirX);
+  if (dirY > 0) range = std::min(range, (half - y) / dirY);
+  if (dirY < 0) range = std::min(range, (-half - y) / dirY);
+
+  // the other rovers, as circles
+  for (size_t i = 0; i < rovers.size(); i++) {
+    if ((int)i == rover) continue;
+
+    double toX = rovers[i]->pose.x - x;
+    double toY = rovers[i]->pose.y - y;
+    double along = toX * dirX + toY * dirY;
+    if (along <= 0) continue;
+
+    double across = toX * dirY - toY * dirX;
+    if (fabs(across) >= roverRadius) continue;
+
+    double hit = along - sqrt(roverRadius * roverRadius - across * across);
+    if (hit >= 0 && hit < range) range = hit;
+  }
+
+  return range < 0 ? 0 : range;
+}
+
+KinematicSim::Rover::Rover(KinematicSim* sim, int index, unsigned int seed) : sim(sim), index(index), cameraNoise(seed) {
+  pose.x = startPositions[index][0];
+  pose.y = startPositions[index][1];
+  pose.theta = startPositions[index][2];
+  distanceDriven = 0;
+  lastCameraFrame = -1;
+  swarmMapTicks = 0;
+
+  std::stringstream name;
+  name << "rover" << index;
+  swarmName = name.str();
+
+  searchController.setSeed(seed);
+  searchController.setMode(sim->config.searchMode);
+  searchController.setOccupancyGrid(&occupancyGrid);
+  searchController.setCoverageMap(&coverageMap);
+  if (sim->config.targetMemory) searchController.setTargetMemory(&targetMemory);
+
+  pickUpController.setParams(sim->config.params);
+  dropOffController.setParams(sim->config.params);
+
+  targetDetected = false;
+  targetCollected = false;
+  lockTarget = false;
+  blockBlock = false;
+  centerSeen = false;
+  reachedCollectionPoint = false;
+  init = false;
+  avoidingObstacle = false;
+  obstacleCode = 0;
+  lastObstacleMessage = 0;
+  stateMachineState = STATE_MACHINE_TRANSFORM;
+  searchVelocity = sim->config.params.searchVelocity;
+
+  goalLocation.theta = 0;
+  goalLocation.x = 0.5 * cos(goalLocation.theta + M_PI);
+  goalLocation.y = 0.5 * sin(goalLocation.theta + M_PI);
+
+  centerLocation.x = 0;
+  centerLocation.y = 0;
+  centerLocation.theta = 0;
+  centerLocationOdom = centerLocation;
+
+  timerStartTime = 0;
+  timerTimeElapsed = 0;
+
+  for (int i = 0; i < 3; i++) {
+    sonarRanges[i] = sonarMaxRange;
+  }
+
+  linear = 0;
+  angular = 0;
+  fingerAngle = 0;
+  wristAngle = 0;
+}
+
+void KinematicSim::Rover::sense(double now) {
+  currentLocation = pose;
+  coverageMap.markFootprint(pose.x, pose.y, pose.theta);
+  if (sim->config.swarmMap) swarmMap.markFootprint(pose.x, pose.y, pose.theta);
+  sim->arenaCoverage.markFootprint(pose.x, pose.y, pose.theta);
+
+  double cosTheta = cos(pose.theta);
+  double sinTheta = sin(pose.theta);
+
+  // sonars, the shortest of three rays across each cone
+  bool holding = false;
+  for (size_t i = 0; i < sim->cubes.size(); i++) {
+    if (sim->cubes[i].heldBy == index) holding = true;
+  }
+
+  occupancyGrid.recenter(pose.x, pose.y);
+
+  for (int i = 0; i < 3; i++) {
+    const SonarMount& mount = sonarMounts[i];
+    double x = pose.x + mount.x * cosTheta - mount.y * sinTheta;
+    double y = pose.y + mount.x * sinTheta + mount.y * cosTheta;
+
+    double range = sonarMaxRange;
+    for (int ray = -1; ray <= 1; ray++) {
+      range = std::min(range, sim->castRay(index, x, y, pose.theta + mount.heading + ray * sonarHalfAngle, sonarMaxRange));
+    }
+
+    if (i == 1 && holding && wristAngle < wristClearsSonar) range = heldCubeRange;
+    sonarRanges[i] = range;
+
+    for (int ray = -1; ray <= 1; ray++) {
+      occupancyGrid.addRay(x, y, pose.theta + mount.heading + ray * sonarHalfAngle, range, range < sonarMaxRange);
+    }
+  }
+
+  // the obstacle node's codes, passed on when they change and repeated as
+  // its keepalive
+  unsigned char code = 0;
+  if (sonarRanges[1] < blockDistance) {
+    code = 4;
+  } else if (sonarRanges[0] < collisionDistance || sonarRanges[1] < collisionDistance || sonarRanges[2] < collisionDistance) {
+    code = (sonarRanges[0] >= collisionDistance && sonarRanges[2] < collisionDistance) ? 1 : 2;
+  }
+  if (code != obstacleCode || now - lastObstacleMessage >= obstacleKeepalive) {
+    lastObstacleMessage = now;
+    processObstacle(code);
+  }
+
+  // the camera, one detector message per frame
+  int frame = (int)floor(now * cameraRate + 1e-6);
+  if (frame == lastCameraFrame) return;
+  lastCameraFrame = frame;
+
+  if (!cameraMessage || !cameraMessage.unique()) {
+    cameraMessage.reset(new apriltags_ros::AprilTagDetectionArray());
+    cameraMessage->detections.reserve(sim->cubes.size() + sim->centerTags.size());
+  }
+  apriltags_ros::AprilTagDetectionArray& message = *cameraMessage;
+  message.detections.clear();
+  double cameraX = pose.x + cameraForward * cosTheta;
+  double cameraY = pose.y + cameraForward * sinTheta;
+
+  for (size_t i = 0; i < sim->cubes.size() + sim->centerTags.size(); i++) {
+    bool isCube = i < sim->cubes.size();
+    double x, y;
+
+    if (isCube) {
+      const Cube& cube = sim->cubes[i];
+      if (cube.heldBy >= 0 || cube.collected) continue;
+      x = cube.x;
+      y = cube.y;
+    } else {
+      x = sim->centerTags[i - sim->cubes.size()].x;
+      y = sim->centerTags[i - sim->cubes.size()].y;
+    }
+
+    double forward = (x - cameraX) * cosTheta + (y - cameraY) * sinTheta;
+    double lateral = -(x - cameraX) * sinTheta + (y - cameraY) * cosTheta;
+    if (forward < cameraNear || forward > cameraFar || fabs(lateral) > forward * tan(cameraHalfFov)) continue;
+    if (forward > cameraReliable && cameraNoise.uniformReal(cameraReliable, cameraFar) < forward) continue;
+
+    // optical frame: x right, y down, z forward
+    apriltags_ros::AprilTagDetection detection;
+    detection.id = isCube ? 0 : 256;
+    detection.pose.pose.position.x = -lateral - cameraOffsetCorrection;
+    detection.pose.pose.position.y = cameraHeight;
+    detection.pose.pose.position.z = forward;
+    detection.pose.pose.orientation.w = 1;
+    message.detections.push_back(detection);
+  }
+
+  processTargets(cameraMessage);
+}
+
+bool KinematicSim::Rover::buildSwarmMessage(mobility::SwarmMapDelta& message) {
+  // every so often the whole map for rovers that missed a delta
+  bool full = swarmMapTicks % swarmMapFullEvery == 0;
+  swarmMapTicks++;
+
+  if (!swarmMap.buildMessage(message, full)) return false;
+
+  message.rover = swarmName;
+  return true;
+}
+
+void KinematicSim::Rover::mergeSwarmMessage(const mobility::SwarmMapDelta& message) {
+  newlyCovered.clear();
+  if (!swarmMap.merge(message, &newlyCovered)) return;
+
+  for (size_t i = 0; i < newlyCovered.size(); i++) {
+    double x, y;
+    swarmMap.getCellCenter(newlyCovered[i], x, y);
+
+    int cell = coverageMap.cellIndex(x, y);
+    if (cell >= 0) coverageMap.markCell(cell);
+  }
+}
+
+void KinematicSim::Rover::control(double now) {
+  // RoverBrain counts whole seconds since timerStartTime
+  timerTimeElapsed = (long)now - timerStartTime;
+  runStateMachine(now);
+}
+
+void KinematicSim::Rover::move(double dt) {
+  double theta = pose.theta + angular * dt;
+  double x = pose.x + linear * cos(theta) * dt;
+  double y = pose.y + linear * sin(theta) * dt;
+
+  // a rover pushing into another slides along it, as the two would shove
+  // each other aside in Gazebo rather than lock up
+  for (size_t i = 0; i < sim->rovers.size(); i++) {
+    if ((int)i == index) continue;
+
+    double awayX = x - sim->rovers[i]->pose.x;
+    double awayY = y - sim->rovers[i]->pose.y;
+    double distance = hypot(awayX, awayY);
+    if (distance >= 2 * roverRadius || distance == 0) continue;
+
+    awayX /= distance;
+    awayY /= distance;
+    double into = (x - pose.x) * awayX + (y - pose.y) * awayY;
+    if (into < 0) {
+      x -= into * awayX;
+      y -= into * awayY;
+    }
+  }
+
+  // walls stop the rover, turning in place still works
+  double half = sim->config.arenaSize / 2 - roverRadius;
+  bool blocked = fabs(x) > half || fabs(y) > half;
+
+  pose.theta = angles::normalize_angle(theta);
+  if (!blocked) {
+    distanceDriven += hypot(x - pose.x, y - pose.y);
+    pose.x = x;
+    pose.y = y;
+  }
+}
+
+void KinematicSim::Rover::sendDriveCommand(double linearVel, double angularError) {
+  // sbridge's proportional mapping onto the Gazebo skid steer plugin
+  float PV = 255 * linearVel;
+  if (PV > 255) PV = 255;
+  if (PV < -255) PV = -255;
+
+  float PA = 200 * angularError;
+  if (PA > 255) PA = 255;
+  if (PA < -255) PA = -255;
+
+  float turn = PA / 60;
+  float forward = PV / 355;
+
+  if (linearVel >= 0 && forward <= 0) forward = 0;
+  if (linearVel <= 0 && forward >= 0) forward = 0;
+
+  linear = forward;
+  angular = turn;
+}
+
+void KinematicSim::Rover::publishFingerAngle(float angle) {
+  fingerAngle = angle;
+
+  std::vector<Cube>& cubes = sim->cubes;
+
+  if (angle < 0.1) {
+    // closing on whatever is between the fingers, which holds one cube
+    for (size_t i = 0; i < cubes.size(); i++) {
+      if (cubes[i].heldBy == index) return;
+    }
+
+    for (size_t i = 0; i < cubes.size(); i++) {
+      if (cubes[i].heldBy >= 0 || cubes[i].collected) continue;
+
+      double forward = (cubes[i].x - pose.x) * cos(pose.theta) + (cubes[i].y - pose.y) * sin(pose.theta);
+      double lateral = -(cubes[i].x - pose.x) * sin(pose.theta) + (cubes[i].y - pose.y) * cos(pose.theta);
+      if (forward > gripperNear && forward < gripperFar && fabs(lateral) < gripperHalfWidth) {
+        cubes[i].heldBy = index;
+        return;
+      }
+    }
+  } else {
+    // opening drops a held cube, it counts once it lands on the disk
+    for (size_t i = 0; i < cubes.size(); i++) {
+      if (cubes[i].heldBy != index) continue;
+
+      cubes[i].heldBy = -1;
+      cubes[i].x = pose.x + gripperDropDistance * cos(pose.theta);
+      cubes[i].y = pose.y + gripperDropDistance * sin(pose.theta);
+
+      if (fabs(cubes[i].x) < diskHalfSize && fabs(cubes[i].y) < diskHalfSize) {
+        cubes[i].collected = true;
+
+        double now = ros::Time::now().toSec() - 1;
+        if (sim->result.firstCollection < 0) sim->result.firstCollection = now;
+        sim->result.lastCollection = now;
+        sim->result.collected++;
+      }
+    }
+  }
+}
+
+void KinematicSim::Rover::publishWristAngle(float angle) {
+  wristAngle = angle;
+}
+
+void KinematicSim::Rover::processObstacle(unsigned char code) {
+  blockBlock = code == 4;
+
+  bool changed = code != obstacleCode;
+  obstacleCode = code;
+
+  if ((!targetDetected || targetCollected) && (code > 0)) {
+    if (!changed && avoidingObstacle) return;
+
+    avoidObstacle(code);
+
+    // start turning away now rather than on the next state machine tick
+    if (init) {
+      sendDriveCommand(0.05, angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta));
+    }
+  }
+}
+
+void KinematicSim::Rover::avoidObstacle(unsigned char code) {
+  if (code == 1 || code == 2) {
+    float turn = 0.6;
+    float left = currentLocation.theta + turn;
+    float right = currentLocation.theta - turn;
+
+    bool leftClear = occupancyGrid.isSegmentClear(currentLocation.x, currentLocation.y, currentLocation.x + cos(left), currentLocation.y + sin(left));
+    bool rightClear = occupancyGrid.isSegmentClear(currentLocation.x, currentLocation.y, currentLocation.x + cos(right), currentLocation.y + sin(right));
+
+    if (!leftClear && rightClear) {
+      turn = -turn;
+    }
+
+    goalLocation.theta = currentLocation.theta + turn;
+  }
+
+  goalLocation = searchController.continueInterruptedSearch(currentLocation, goalLocation);
+  stateMachineState = STATE_MACHINE_ROTATE;
+  avoidingObstacle = true;
+}
+
+void KinematicSim::Rover::processTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message) {
+  // remembered for later like RoverBrain::rememberTargets(), positions are exact here
+  for (size_t i = 0; i < message->detections.size(); i++) {
+    if (message->detections[i].id == 256) continue;
+
+    const geometry_msgs::Point& position = message->detections[i].pose.pose.position;
+    double range = sqrt(position.x * position.x + position.y * position.y + position.z * position.z);
+    if (range < 0.3 || range > 2.0) continue;
+
+    double forward = cameraForward + position.z;
+    double lateral = -(position.x + cameraOffsetCorrection);
+    double x = currentLocation.x + forward * cos(currentLocation.theta) - lateral * sin(currentLocation.theta);
+    double y = currentLocation.y + forward * sin(currentLocation.theta) + lateral * cos(currentLocation.theta);
+
+    if (hypot(x - centerLocation.x, y - centerLocation.y) < 1.0) continue;
+    targetMemory.add(message->detections[i].id, x, y, ros::Time::now().toSec());
+  }
+
+  // shared with the swarm where RoverBrain would put it
+  for (size_t i = 0; sim->config.swarmMap && i < message->detections.size(); i++) {
+    if (message->detections[i].id != 256) {
+      swarmMap.addTargetSeen(currentLocation.x + targetSightingDistance * cos(currentLocation.theta),
+                             currentLocation.y + targetSightingDistance * sin(currentLocation.theta));
+      break;
+    }
+  }
+
+  if (message->detections.size() > 0 && !reachedCollectionPoint) {
+    centerSeen = false;
+    double count = 0;
+    double countRight = 0;
+    double countLeft = 0;
+
+    for (size_t i = 0; i < message->detections.size(); i++) {
+      if (message->detections[i].id == 256) {
+        if (message->detections[i].pose.pose.position.x + cameraOffsetCorrection > 0) {
+          countRight++;
+        } else {
+          countLeft++;
+        }
+
+        centerSeen = true;
+        count++;
+      }
+    }
+
+    if (centerSeen && targetCollected) {
+      stateMachineState = STATE_MACHINE_TRANSFORM;
+      goalLocation = currentLocation;
+    }
+
+    dropOffController.setDataTargets(count, countLeft, countRight);
+
+    if (centerSeen && !targetCollected) {
+      // RoverBrain tests std::right here, which is always true, so it
+      // always turns left away from the center
+      goalLocation.theta += 0.15;
+      stateMachineState = STATE_MACHINE_TRANSFORM;
+      goalLocation = searchController.continueInterruptedSearch(currentLocation, goalLocation);
+
+      targetDetected = false;
+      pickUpController.reset();
+      return;
+    }
+  }
+
+  if (message->detections.size() > 0 && !targetCollected && timerTimeElapsed > 5) {
+    targetDetected = true;
+    stateMachineState = STATE_MACHINE_PICKUP;
+
+    PickUpResult result = pickUpController.selectTarget(message);
+    if (result.fingerAngle != -1) publishFingerAngle(result.fingerAngle);
+    if (result.wristAngle != -1) publishWristAngle(result.wristAngle);
+  }
+}
+
+void KinematicSim::Rover::runStateMachine(double now) {
+  float rotateOnlyAngleTolerance = sim->config.params.rotateOnlyAngleTolerance;
+  float returnToSearchDelay = sim->config.params.returnToSearchDelay;
+
+  if (!init) {
+    if (timerTimeElapsed > 1) {
+      init = true;
+    } else {
+      return;
+    }
+  }
+
+  if (!targetCollected && !targetDetected) {
+    publishFingerAngle(M_PI_2);
+    publishWristAngle(0);
+  }
+
+  switch (stateMachineState) {
+
+  case STATE_MACHINE_TRANSFORM: {
+    if (targetCollected && !avoidingObstacle) {
+      dropOffController.setCenterDist(hypot(centerLocation.x - currentLocation.x, centerLocation.y - currentLocation.y));
+      dropOffController.setDataLocations(centerLocation, currentLocation, timerTimeElapsed);
+
+      DropOffResult result = dropOffController.getState();
+
+      if (result.timer) {
+        timerStartTime = (long)now;
+        reachedCollectionPoint = true;
+      }
+
+      if (result.fingerAngle != -1) publishFingerAngle(result.fingerAngle);
+      if (result.wristAngle != -1) publishWristAngle(result.wristAngle);
+
+      if (result.reset) {
+        timerStartTime = (long)now;
+        targetCollected = false;
+        targetDetected = false;
+        lockTarget = false;
+        sendDriveCommand(0.0, 0);
+
+        stateMachineState = STATE_MACHINE_TRANSFORM;
+        reachedCollectionPoint = false;
+        centerLocationOdom = currentLocation;
+
+        dropOffController.reset();
+      } else if (result.goalDriving && timerTimeElapsed >= 5) {
+        goalLocation = result.centerGoal;
+        stateMachineState = STATE_MACHINE_ROTATE;
+        timerStartTime = (long)now;
+      } else {
+        goalLocation = currentLocation;
+        sendDriveCommand(result.cmdVel, result.angleError);
+        stateMachineState = STATE_MACHINE_TRANSFORM;
+        break;
+      }
+    } else if (fabs(angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta)) > rotateOnlyAngleTolerance) {
+      stateMachineState = STATE_MACHINE_ROTATE;
+    } else if (fabs(angles::shortest_angular_distance(currentLocation.theta, atan2(goalLocation.y - currentLocation.y, goalLocation.x - currentLocation.x))) < M_PI_2) {
+      stateMachineState = STATE_MACHINE_SKID_STEER;
+    } else if (!targetDetected && timerTimeElapsed > returnToSearchDelay) {
+      goalLocation = searchController.search(currentLocation);
+    }
+  }
+  // fall through
+
+  case STATE_MACHINE_ROTATE: {
+    float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+
+    if (fabs(errorYaw) > rotateOnlyAngleTolerance) {
+      sendDriveCommand(0.05, errorYaw);
+      break;
+    } else if (avoidingObstacle && (obstacleCode == 1 || obstacleCode == 2) && (!targetDetected || targetCollected)) {
+      avoidObstacle(obstacleCode);
+      break;
+    } else {
+      stateMachineState = STATE_MACHINE_SKID_STEER;
+    }
+  }
+  // fall through
+
+  case STATE_MACHINE_SKID_STEER: {
+    float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+
+    if (fabs(angles::shortest_angular_distance(currentLocation.theta, atan2(goalLocation.y - currentLocation.y, goalLocation.x - currentLocation.x))) < M_PI_2) {
+      sendDriveCommand(searchVelocity, errorYaw / 2);
+    } else if (fabs(errorYaw) > 0.1) {
+      sendDriveCommand(0.0, errorYaw);
+    } else {
+      sendDriveCommand(0.0, 0.0);
+      avoidingObstacle = false;
+      stateMachineState = STATE_MACHINE_TRANSFORM;
+    }
+    break;
+  }
+
+  case STATE_MACHINE_PICKUP: {
+    if (targetDetected && !targetCollected) {
+      PickUpResult result = pickUpController.pickUpSelectedTarget(blockBlock);
+      sendDriveCommand(result.cmdVel, result.angleError);
+
+      if (result.fingerAngle != -1) publishFingerAngle(result.fingerAngle);
+      if (result.wristAngle != -1) publishWristAngle(result.wristAngle);
+
+      if (result.giveUp) {
+        targetDetected = false;
+        stateMachineState = STATE_MACHINE_TRANSFORM;
+        sendDriveCommand(0, 0);
+        pickUpController.reset();
+      }
+
+      if (result.pickedUp) {
+        pickUpController.reset();
+        targetCollected = true;
+
+        if (sim->config.swarmMap) {
+          swarmMap.addTargetCollected(currentLocation.x + targetSightingDistance * cos(currentLocation.theta),
+                                      currentLocation.y + targetSightingDistance * sin(currentLocation.theta));
+        }
+        targetMemory.forgetNear(currentLocation.x, currentLocation.y, 0.5);
+        searchController.targetPickedUp();
+
+        stateMachineState = STATE_MACHINE_ROTATE;
+        goalLocation.theta = atan2(centerLocationOdom.y - currentLocation.y, centerLocationOdom.x - currentLocation.x);
+        goalLocation.x = centerLocationOdom.x = 0;
+        goalLocation.y = centerLocationOdom.y;
+
+        publishWristAngle(0.8);
+        sendDriveCommand(0.0, 0);
+      }
+    } else {
+      stateMachineState = STATE_MACHINE_TRANSFORM;
+    }
+    break;
+  }
+
+  default:
+    break;
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef KINEMATIC_SIM_H
+#define KINEMATIC_SIM_H
+
+#include <string>
+#include <vector>
+
+#include <geometry_msgs/Pose2D.h>
+
+#include "CoverageMap.h"
+#include "RoverParams.h"
+#include "SearchController.h"
+#include "SwarmMap.h"
+
+/**
+ * A flat 2D stand-in for the Gazebo arena, fast enough to run a full round in
+ * well under a second.
+ *
+ * Rovers drive as points with a 0.2m radius under the same drive command to
+ * wheel speed mapping as sbridge, and see the world through three sonar cones,
+ * a camera cone that reports cube and collection disk tags the way the
+ * apriltag detector does at 6 frames a second, missing more of them towards
+ * the far edge of the image, and a gripper that holds one cube when the
+ * fingers close on it. Rovers that run into each other slide apart. Localisation is perfect: odom is the arena frame and the
+ * collection disk is at its origin.
+ *
+ * Each rover runs the real PickUpController, DropOffController and
+ * SearchController under a copy of RoverBrain's state machine, and shares
+ * its SwarmMap with the others every two seconds, so search strategies and
+ * their parameters can be compared without Gazebo. The clock
+ * is ros::Time in sim time mode, driven by the simulation, and every random
+ * choice comes from the configured seed, so a run is reproducible.
+ * Only one simulation can run per process at a time because of the clock.
+ */
+class KinematicSim {
+
+  public:
+
+    struct Config {
+      Config();
+
+      double arenaSize;          // m, 15 for the preliminary round, 23.1 for the final
+      int rovers;                // up to 6, placed like the rqt GUI does
+      double duration;           // simulated seconds
+      unsigned int seed;
+      SearchController::Mode searchMode;
+      bool targetMemory;         // return to cubes seen while carrying one, as RoverBrain does
+      bool swarmMap;             // share coverage and target sightings on a simulated /swarmMap
+      std::vector<geometry_msgs::Pose2D> targets; // empty for 256 placed uniformly
+      RoverParams params;
+    };
+
+    struct Result {
+      int collected;
+      double firstCollection; // simulated seconds, -1 if none
+      double lastCollection;  // simulated seconds, -1 if none
+      double distanceDriven;  // m, all rovers together
+      double areaCovered;     // share of the arena any rover's camera has seen
+      long ticks;
+
+      // /swarmMap traffic, serialized messages as every subscriber is sent
+      // them, counted once when sent and once when received, the way
+      // WirelessDiags counts a rover's wireless bytes
+      unsigned long swarmMessages;
+      double swarmBytes;
+    };
+
+    KinematicSim(const Config& config);
+    ~KinematicSim();
+
+    Result run();
+
+    // one control tick: every rover senses, runs its state machine and
+    // drives for a tenth of a second
+    void step();
+
+    // reads the cube positions (models named at<n>) out of a Gazebo .world
+    // file such as simulation/worlds/uniform_targets_example.world, false if
+    // the file cannot be read or holds no cubes
+    static bool loadWorldTargets(const std::string& path, std::vector<geometry_msgs::Pose2D>& targets);
+
+  private:
+
+    class Rover;
+    friend class Rover;
+
+    struct Cube {
+      double x;
+      double y;
+      int heldBy; // rover index, -1 when on the ground
+      bool collected;
+    };
+
+    void placeTargets();
+
+    // distance along a ray to the nearest wall or other rover, capped at maxRange
+    double castRay(int rover, double x, double y, double heading, double maxRange);
+
+    // every rover publishes its swarm map and merges everyone else's
+    void exchangeSwarmMaps();
+
+    Config config;
+    std::vector<Rover*> rovers;
+    std::vector<Cube> cubes;
+
+    // collection disk tags, points around the edge of the disk
+    std::vector<geometry_msgs::Pose2D> centerTags;
+
+    // the camera footprints of all the rovers, over exactly the arena
+    CoverageMap arenaCoverage;
+
+    // reused for every rover's /swarmMap message
+    mobility::SwarmMapDelta swarmMessage;
+
+    Result result;
+};
+
+#endif /* KINEMATIC_SIM_H */
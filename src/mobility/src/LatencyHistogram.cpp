@@ -0,0 +1,71 @@
+#include "LatencyHistogram.h"
+
+#include <stdio.h>
+
+LatencyHistogram::LatencyHistogram(std::string name) {
+  this->name = name;
+  reset();
+}
+
+void LatencyHistogram::record(double seconds) {
+  if (seconds < 0) seconds = 0;
+
+  // find the first power of two microseconds larger than the sample
+  unsigned long micros = seconds * 1e6;
+  int bucket = 0;
+  while (micros > 0 && bucket < numBuckets - 1) {
+    micros >>= 1;
+    bucket++;
+  }
+
+  buckets[bucket]++;
+  count++;
+  total += seconds;
+  if (seconds > max) max = seconds;
+}
+
+double LatencyHistogram::getPercentile(double fraction) {
+  if (count == 0) return 0;
+
+  unsigned long threshold = fraction * count;
+  unsigned long seen = 0;
+
+  for (int i = 0; i < numBuckets; i++) {
+    seen += buckets[i];
+    if (seen > threshold) {
+      // bucket i holds samples below 2^i microseconds, but never report more
+      // than the largest sample actually seen
+      double upperBound = (1ul << i) * 1e-6;
+      return upperBound < max ? upperBound : max;
+    }
+  }
+
+  return max;
+}
+
+std::string LatencyHistogram::summary() {
+  char buffer[256];
+  format(buffer, sizeof(buffer));
+  return buffer;
+}
+
+void LatencyHistogram::format(char* buffer, size_t size) {
+  if (count == 0) {
+    snprintf(buffer, size, "%s: n=0", name.c_str());
+    return;
+  }
+
+  snprintf(buffer, size, "%s: n=%lu mean=%gms p50<%gms p90<%gms p99<%gms max=%gms",
+           name.c_str(), count, total / count * 1e3, getPercentile(0.5) * 1e3, getPercentile(0.9) * 1e3,
+           getPercentile(0.99) * 1e3, max * 1e3);
+}
+
+void LatencyHistogram::reset() {
+  for (int i = 0; i < numBuckets; i++) {
+    buckets[i] = 0;
+  }
+
+  count = 0;
+  total = 0;
+  max = 0;
+}
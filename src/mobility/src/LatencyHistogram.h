@@ -0,0 +1,47 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * Fixed size histogram of durations with power of two microsecond buckets
+ * (<1us, <2us, <4us, ... ). Recording is O(1) and never allocates, so it can
+ * be used inside the control loop. Not thread safe, record from one thread.
+ */
+class LatencyHistogram {
+
+  public:
+
+    LatencyHistogram(std::string name);
+
+    // record a duration in seconds
+    void record(double seconds);
+
+    // one line summary: count, mean, p50, p90, p99 and max
+    std::string summary();
+
+    // the same summary into a caller's buffer, truncated to fit, for the
+    // control loop where building a string would allocate
+    void format(char* buffer, size_t size);
+
+    void reset();
+
+    unsigned long getCount() {return count;}
+    double getMax() {return max;}
+
+    // upper bound of the bucket containing the given fraction of samples
+    double getPercentile(double fraction);
+
+  private:
+
+    static const int numBuckets = 24; // last bucket holds everything >= ~8s
+
+    std::string name;
+    unsigned long buckets[numBuckets];
+    unsigned long count;
+    double total;
+    double max;
+};
+
+#endif /* LATENCY_HISTOGRAM_H */
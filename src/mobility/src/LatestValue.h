@@ -0,0 +1,93 @@
+#ifndef LATEST_VALUE_H
+#define LATEST_VALUE_H
+
+#include <atomic>
+#include <boost/shared_ptr.hpp>
+
+/**
+ * A mailbox that holds only the most recently written value.
+ *
+ * One thread writes and any number of threads read. Neither side takes a
+ * lock: the value is guarded by a sequence counter that is odd while a write
+ * is in progress, and readers retry the copy if it changed underneath them
+ * (a seqlock). Writes are never delayed by readers.
+ *
+ * T must be plain data, i.e. copying a half-written T must not be able to
+ * crash. Use it for structs of numbers, not for strings or message pointers.
+ */
+template <typename T>
+class LatestValue {
+
+  public:
+
+    LatestValue() : sequence(0) {}
+
+    // publish a new value, only one thread may call this
+    void write(const T& newValue) {
+      unsigned int seq = sequence.load(std::memory_order_relaxed);
+      sequence.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      value = newValue;
+
+      sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // copies the latest value into out and returns how many writes have been
+    // made so far, 0 means nothing has been written yet and out is untouched
+    unsigned int read(T& out) const {
+      unsigned int before;
+      unsigned int after;
+      T copy;
+
+      do {
+        before = sequence.load(std::memory_order_acquire);
+        copy = value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+      } while ((before & 1) || before != after);
+
+      if (before == 0) return 0;
+
+      out = copy;
+      return before / 2;
+    }
+
+    // number of completed writes, lets a reader check for new data cheaply
+    unsigned int version() const {
+      return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+  private:
+
+    std::atomic<unsigned int> sequence;
+    T value;
+};
+
+/**
+ * The same idea as LatestValue for ROS messages, which hold strings and
+ * vectors and so cannot be copied while they are being written. Only the
+ * shared pointer is swapped, using boost's atomic shared_ptr operations, so
+ * the message itself is never copied. A reader can tell whether a message is
+ * new by comparing the returned pointer with the last one it handled.
+ */
+template <typename M>
+class LatestMessage {
+
+  public:
+
+    void write(const boost::shared_ptr<const M>& message) {
+      boost::atomic_store(&latest, message);
+    }
+
+    // returns the latest message, or an empty pointer if none has arrived
+    boost::shared_ptr<const M> read() const {
+      return boost::atomic_load(&latest);
+    }
+
+  private:
+
+    boost::shared_ptr<const M> latest;
+};
+
+#endif /* LATEST_VALUE_H */
@@ -0,0 +1,168 @@
+#include "OccupancyGrid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// longest line through the window, in cells
+static const int maxTraceCells = 2 * OccupancyGrid::size;
+
+// Cells on the line from (x0, y0) to (x1, y1), both ends included
+// (Bresenham). Stops after maxCells, returns the number of cells written.
+static int traceCells(int x0, int y0, int x1, int y1, int* xs, int* ys, int maxCells) {
+  int dx = abs(x1 - x0);
+  int dy = -abs(y1 - y0);
+  int stepX = x0 < x1 ? 1 : -1;
+  int stepY = y0 < y1 ? 1 : -1;
+  int error = dx + dy;
+  int count = 0;
+
+  while (count < maxCells) {
+    xs[count] = x0;
+    ys[count] = y0;
+    count++;
+
+    if (x0 == x1 && y0 == y1) break;
+
+    int error2 = 2 * error;
+    if (error2 >= dy) {
+      error += dy;
+      x0 += stepX;
+    }
+    if (error2 <= dx) {
+      error += dx;
+      y0 += stepY;
+    }
+  }
+
+  return count;
+}
+
+OccupancyGrid::OccupancyGrid(float resolution) {
+  if (resolution <= 0) resolution = 0.1;
+  this->resolution = resolution;
+
+  hitLogOdds = 24;
+  missLogOdds = -6;
+  minLogOdds = -64;
+  maxLogOdds = 96;
+  occupiedLogOdds = 40;
+
+  cellUpdates = 0;
+
+  reset();
+}
+
+void OccupancyGrid::recenter(double x, double y) {
+  int newOriginX = cellCoordinate(x) - size / 2;
+  int newOriginY = cellCoordinate(y) - size / 2;
+
+  int shiftX = newOriginX - originX;
+  int shiftY = newOriginY - originY;
+
+  if (shiftX == 0 && shiftY == 0) return;
+
+  if (abs(shiftX) >= size || abs(shiftY) >= size) {
+    memset(cells, 0, sizeof(cells));
+  } else {
+    // the cells that scroll into view share memory with the ones that
+    // scrolled out, which now describe somewhere else
+    if (shiftX > 0) {
+      clearColumns(originX + size, newOriginX + size - 1);
+    } else if (shiftX < 0) {
+      clearColumns(newOriginX, originX - 1);
+    }
+
+    if (shiftY > 0) {
+      clearRows(originY + size, newOriginY + size - 1);
+    } else if (shiftY < 0) {
+      clearRows(newOriginY, originY - 1);
+    }
+  }
+
+  originX = newOriginX;
+  originY = newOriginY;
+}
+
+void OccupancyGrid::addRay(double x, double y, double angle, double range, bool hit) {
+  if (range < 0) return;
+
+  // nothing past the window can be stored anyway
+  double maxRange = size * resolution;
+  if (range > maxRange) {
+    range = maxRange;
+    hit = false;
+  }
+
+  int xs[maxTraceCells];
+  int ys[maxTraceCells];
+  int count = traceCells(cellCoordinate(x), cellCoordinate(y),
+                         cellCoordinate(x + range * cos(angle)), cellCoordinate(y + range * sin(angle)),
+                         xs, ys, maxTraceCells);
+
+  for (int i = 0; i < count - 1; i++) {
+    update(xs[i], ys[i], missLogOdds);
+  }
+
+  update(xs[count - 1], ys[count - 1], hit ? hitLogOdds : missLogOdds);
+}
+
+int8_t OccupancyGrid::getLogOdds(double x, double y) {
+  int cellX = cellCoordinate(x);
+  int cellY = cellCoordinate(y);
+
+  if (!inWindow(cellX, cellY)) return 0;
+  return cell(cellX, cellY);
+}
+
+bool OccupancyGrid::isOccupied(double x, double y) {
+  return getLogOdds(x, y) >= occupiedLogOdds;
+}
+
+bool OccupancyGrid::isSegmentClear(double x0, double y0, double x1, double y1) {
+  int xs[maxTraceCells];
+  int ys[maxTraceCells];
+  int count = traceCells(cellCoordinate(x0), cellCoordinate(y0), cellCoordinate(x1), cellCoordinate(y1),
+                         xs, ys, maxTraceCells);
+
+  for (int i = 0; i < count; i++) {
+    if (inWindow(xs[i], ys[i]) && cell(xs[i], ys[i]) >= occupiedLogOdds) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void OccupancyGrid::reset() {
+  memset(cells, 0, sizeof(cells));
+  originX = -size / 2;
+  originY = -size / 2;
+}
+
+void OccupancyGrid::update(int cellX, int cellY, int change) {
+  if (!inWindow(cellX, cellY)) return;
+
+  int8_t& value = cell(cellX, cellY);
+  int updated = value + change;
+
+  if (updated < minLogOdds) updated = minLogOdds;
+  if (updated > maxLogOdds) updated = maxLogOdds;
+
+  value = updated;
+  cellUpdates++;
+}
+
+void OccupancyGrid::clearColumns(int first, int last) {
+  for (int column = first; column <= last; column++) {
+    int offset = column & mask;
+    for (int row = 0; row < size; row++) {
+      cells[(row << sizeBits) | offset] = 0;
+    }
+  }
+}
+
+void OccupancyGrid::clearRows(int first, int last) {
+  for (int row = first; row <= last; row++) {
+    memset(cells + ((row & mask) << sizeBits), 0, size);
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <cmath>
+#include <stdint.h>
+
+/**
+ * Fixed size occupancy grid that scrolls with the rover, so obstacles the
+ * sonars have seen are remembered after they leave the sonar cones.
+ *
+ * Each cell holds the log odds of being occupied as an int8, 0 meaning
+ * unknown. The grid covers size x size cells around the last recenter()
+ * position. Cells are addressed by their world cell coordinates modulo the
+ * grid size, so recentering only clears the strips of cells that scrolled
+ * into view instead of moving any memory. The whole grid is 16KB and fits in
+ * L1 cache. Coordinates are in whatever frame the caller uses consistently,
+ * mobility uses odom. Not thread safe.
+ */
+class OccupancyGrid {
+
+  public:
+
+    static const int sizeBits = 7;
+    static const int size = 1 << sizeBits; // cells along each side
+
+    OccupancyGrid(float resolution = 0.1);
+
+    // keeps the window centered on the given position
+    void recenter(double x, double y);
+
+    // one sonar ray from (x, y) along angle: cells before range become more
+    // likely free, and the cell at range more likely occupied if hit is set
+    void addRay(double x, double y, double angle, double range, bool hit);
+
+    // log odds of the cell containing (x, y), 0 when unknown or outside
+    int8_t getLogOdds(double x, double y);
+
+    bool isOccupied(double x, double y);
+
+    // true if no occupied cell lies on the segment between the two points
+    bool isSegmentClear(double x0, double y0, double x1, double y1);
+
+    float getResolution() {return resolution;}
+
+    void reset();
+
+    // log odds steps and limits, an occupied cell needs two hits by default
+    int hitLogOdds;
+    int missLogOdds;
+    int minLogOdds;
+    int maxLogOdds;
+    int occupiedLogOdds;
+
+    // cells changed since construction, for diagnostics
+    unsigned long cellUpdates;
+
+  private:
+
+    static const int mask = size - 1;
+
+    int cellCoordinate(double value) {return (int)floor(value / resolution);}
+
+    int8_t& cell(int cellX, int cellY) {
+      return cells[((cellY & mask) << sizeBits) | (cellX & mask)];
+    }
+
+    bool inWindow(int cellX, int cellY) {
+      return cellX >= originX && cellX < originX + size && cellY >= originY && cellY < originY + size;
+    }
+
+    void update(int cellX, int cellY, int change);
+
+    // clears world columns [first, last] or rows [first, last]
+    void clearColumns(int first, int last);
+    void clearRows(int first, int last);
+
+    float resolution; // meters per cell
+
+    // world cell coordinates of the window's lowest corner
+    int originX;
+    int originY;
+
+    int8_t cells[size * size];
+};
+
+#endif /* OCCUPANCY_GRID_H */
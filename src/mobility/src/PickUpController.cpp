@@ -1,6 +1,7 @@
 #include "PickUpController.h"
 
 PickUpController::PickUpController() {
+    targetDist = 0.25; //meters
     lockTarget = false;
     timeOut = false;
     nTargetsSeen = 0;
@@ -18,10 +19,6 @@ PickUpController::PickUpController() {
 }
 
 PickUpResult PickUpController::pickUpSelectedTarget(bool blockBlock) {
-    //threshold distance to be from the target block before attempting pickup
-    float targetDist = 0.25; //meters
-
-
     /*PickUpResult result;
   result.pickedUp = false;
   result.cmdVel = 0;
@@ -196,5 +193,9 @@ void PickUpController::reset() {
     result.giveUp = false;
 }
 
+void PickUpController::setParams(const RoverParams& params) {
+    targetDist = params.targetDistance;
+}
+
 PickUpController::~PickUpController() {
 }
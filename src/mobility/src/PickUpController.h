@@ -4,6 +4,8 @@
 #include <apriltags_ros/AprilTagDetectionArray.h>
 #include <ros/ros.h>
 
+#include "RoverParams.h"
+
 struct PickUpResult {
   float cmdVel;
   float angleError;
@@ -28,6 +30,9 @@ class PickUpController
 
   void reset();
 
+  // takes the pickup constants from params
+  void setParams(const RoverParams& params);
+
 private:
   //set true when the target block is less than targetDist so we continue attempting to pick it up rather than
   //switching to another block that is in view
@@ -44,6 +49,9 @@ private:
   //distance to target block from front of robot
   double blockDist;
 
+  //threshold distance to be from the target block before attempting pickup
+  float targetDist;
+
   //struct for returning data to mobility
   PickUpResult result;
 
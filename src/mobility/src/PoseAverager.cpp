@@ -0,0 +1,89 @@
+#include "PoseAverager.h"
+
+#include <cmath>
+
+PoseAverager::PoseAverager(unsigned int windowSize) {
+  if (windowSize == 0) windowSize = 1;
+
+  this->windowSize = windowSize;
+  window.resize(windowSize);
+  reset();
+}
+
+void PoseAverager::addPose(geometry_msgs::Pose2D pose) {
+  Sample sample;
+  sample.x = pose.x;
+  sample.y = pose.y;
+  sample.sinTheta = sin(pose.theta);
+  sample.cosTheta = cos(pose.theta);
+
+  // the window is full so the oldest sample leaves the sums
+  if (count == windowSize) {
+    Sample& oldest = window[next];
+    sumX -= oldest.x;
+    sumY -= oldest.y;
+    sumSin -= oldest.sinTheta;
+    sumCos -= oldest.cosTheta;
+  } else {
+    count++;
+  }
+
+  window[next] = sample;
+  sumX += sample.x;
+  sumY += sample.y;
+  sumSin += sample.sinTheta;
+  sumCos += sample.cosTheta;
+
+  next++;
+  if (next >= windowSize) {
+    next = 0;
+
+    // once per pass over the window, so still O(1) per pose on average
+    resum();
+  }
+}
+
+geometry_msgs::Pose2D PoseAverager::getAverage() {
+  geometry_msgs::Pose2D average;
+  average.x = 0;
+  average.y = 0;
+  average.theta = 0;
+
+  if (count == 0) return average;
+
+  average.x = sumX / count;
+  average.y = sumY / count;
+
+  // headings that cancel out completely have no meaningful mean, leave it at 0
+  if (sumSin != 0 || sumCos != 0) {
+    average.theta = atan2(sumSin, sumCos);
+  }
+
+  return average;
+}
+
+void PoseAverager::reset() {
+  next = 0;
+  count = 0;
+  sumX = 0;
+  sumY = 0;
+  sumSin = 0;
+  sumCos = 0;
+}
+
+void PoseAverager::resum() {
+  sumX = 0;
+  sumY = 0;
+  sumSin = 0;
+  sumCos = 0;
+
+  for (unsigned int i = 0; i < count; i++) {
+    sumX += window[i].x;
+    sumY += window[i].y;
+    sumSin += window[i].sinTheta;
+    sumCos += window[i].cosTheta;
+  }
+}
+
+PoseAverager::~PoseAverager() {
+}
@@ -0,0 +1,59 @@
+#ifndef POSE_AVERAGER_H
+#define POSE_AVERAGER_H
+
+#include <vector>
+#include <geometry_msgs/Pose2D.h>
+
+/**
+ * Keeps a sliding window of the most recent poses and their average.
+ *
+ * Running sums are updated as poses enter and leave the window so adding a
+ * pose costs O(1) regardless of the window size. Headings are averaged on the
+ * unit circle (sum of sin and cos) so poses on either side of the +/-PI wrap
+ * average to the correct heading instead of to zero.
+ */
+class PoseAverager {
+
+  public:
+
+    PoseAverager(unsigned int windowSize);
+    ~PoseAverager();
+
+    // adds a pose to the window, evicting the oldest pose once the window is full
+    void addPose(geometry_msgs::Pose2D pose);
+
+    // average of the poses currently in the window
+    geometry_msgs::Pose2D getAverage();
+
+    // number of poses currently in the window
+    unsigned int getCount() {return count;}
+    unsigned int getWindowSize() {return windowSize;}
+
+    void reset();
+
+  private:
+
+    // pose components as they are summed, heading stored as a unit vector
+    struct Sample {
+      double x;
+      double y;
+      double sinTheta;
+      double cosTheta;
+    };
+
+    // recompute the running sums from the window to discard accumulated
+    // floating point error
+    void resum();
+
+    std::vector<Sample> window;
+    unsigned int windowSize;
+    unsigned int next;  // index the next pose will be written to
+    unsigned int count; // number of valid poses in the window
+
+    double sumX;
+    double sumY;
+    double sumSin;
+    double sumCos;
+};
+
+#endif /* POSE_AVERAGER_H */
@@ -0,0 +1,1144 @@
+#include "RoverBrain.h"
+
+// ROS libraries
+#include <angles/angles.h>
+#include <tf/transform_datatypes.h>
+
+using namespace std;
+
+// state machine states
+#define STATE_MACHINE_TRANSFORM 0
+#define STATE_MACHINE_ROTATE 1
+#define STATE_MACHINE_SKID_STEER 2
+#define STATE_MACHINE_PICKUP 3
+#define STATE_MACHINE_DROPOFF 4
+
+// Where the sonars sit on the rover (meters, base_link) and which way they
+// face, as in the swarmie models. Each reading is drawn into the occupancy
+// grid as rays spread over the sonar's cone.
+struct SonarMount {
+    double x;
+    double y;
+    double heading;
+};
+
+static const SonarMount sonarMounts[] = {
+    {0.15, 0.07, 0.43633},  // left
+    {0.15, 0.0, 0.0},       // center
+    {0.15, -0.07, -0.43633} // right
+};
+
+static const double sonarHalfAngle = 0.25; // radians
+static const int raysPerSonar = 3;
+
+// how far ahead of the rover a target in view is taken to be (meters)
+static const double targetSightingDistance = 0.4;
+
+// Targets are only remembered when seen from farther than the one in the
+// gripper and closer than where the tag pose gets too noisy, and not within
+// this radius of the collection disk, where they have already been delivered
+// (meters)
+static const double minRememberDistance = 0.3;
+static const double maxRememberDistance = 2.0;
+static const double collectionDiskRadius = 1.0;
+
+// remembered targets this close to the rover are forgotten when it picks one up
+static const double pickedUpForgetRadius = 0.5;
+
+RoverBrain::RoverBrain(string publishedName, ros::NodeHandle& nodeHandle, ros::CallbackQueue* controlQueue, tf::TransformListener* tfListener, float loopRate) :
+    publishedName(publishedName),
+    mobilityLoopTimeStep(1 / loopRate),
+    mapAverager(mapHistorySize),
+    mapToOdomCache(tfListener, publishedName + "/odom", publishedName + "/map", 1 / mobilityLoopTimeStep),
+    cameraToBaseCache(tfListener, publishedName + "/base_link", publishedName + "/camera_link", 1),
+    controlQueue(controlQueue),
+    controlWakeupPending(false),
+    controlTickLatency("control tick"),
+    obstacleLatency("obstacle to drive command"),
+    modeLatency("mode change"),
+    joystickLatency("joystick to drive command"),
+    occupancyGridLatency("occupancy grid update") {
+
+    currentMode = 0;
+    status_publish_interval = 1;
+    killSwitchTimeout = 10;
+    targetDetected = false;
+    targetCollected = false;
+    heartbeat_publish_interval = 2;
+    lockTarget = false;
+    timeOut = false;
+    blockBlock = false;
+    centerSeen = false;
+    reachedCollectionPoint = false;
+    init = false;
+    avoidingObstacle = false;
+    obstacleCode = 0;
+    obstacleMessages = 0;
+    obstacleChanges = 0;
+    obstacleReplans = 0;
+    searchVelocity = 0.2; // meters/second
+    stateMachineState = STATE_MACHINE_TRANSFORM;
+    publishedStateMachineDisplay = -1;
+    startDelayInSeconds = 1;
+    timerTimeElapsed = 0;
+    maxTransformAge = 1.0; // seconds
+    transformStale = false;
+
+    odometryVersion = 0;
+    mapVersion = 0;
+    obstacleVersion = 0;
+    modeVersion = 0;
+    joystickVersion = 0;
+    for (int i = 0; i < SONAR_COUNT; i++) {
+        sonarVersions[i] = 0;
+    }
+
+    controlTickBudget = 0.05; // seconds
+    obstacleLatencyBudget = 0.02; // seconds
+    modeLatencyBudget = 0.05; // seconds
+    joystickLatencyBudget = 0.02; // seconds
+    latencyReportInterval = 60; // seconds
+
+    swarmMapPublishInterval = 2; // seconds
+    swarmMapFullEvery = 30;
+    swarmMapTicks = 0;
+    swarmMessagesSent = 0;
+    swarmBytesSent = 0;
+    swarmMessagesReceived = 0;
+    swarmBytesReceived = 0;
+    swarmInbox.reserve(maxSwarmInbox);
+    swarmMessages.reserve(maxSwarmInbox);
+
+    // Messages published every tick are built once here, a tick only
+    // changes their data
+    const char* stateMachineNames[DISPLAY_COUNT] = {"TRANSFORMING", "ROTATING", "SKID_STEER", "PICKUP", "DROPOFF", "WAITING"};
+    for (int i = 0; i < DISPLAY_COUNT; i++) {
+        stateMachineMessages[i].data = stateMachineNames[i];
+    }
+    statusMessage.data = "online";
+    heartbeatMessage.data = "";
+
+    //set initial random heading
+    goalLocation.theta = rng.uniformReal(0, 2 * M_PI);
+
+    //select initial search position 50 cm from center (0,0)
+    goalLocation.x = 0.5 * cos(goalLocation.theta+M_PI);
+    goalLocation.y = 0.5 * sin(goalLocation.theta+M_PI);
+
+    centerLocation.x = 0;
+    centerLocation.y = 0;
+    centerLocationOdom.x = 0;
+    centerLocationOdom.y = 0;
+
+    searchController.setOccupancyGrid(&occupancyGrid);
+    searchController.setCoverageMap(&coverageMap);
+    searchController.setTargetMemory(&targetMemory);
+    targetsDelivered = 0;
+
+    // Timers driving the control stage are serviced by the control queue
+    ros::NodeHandle controlNH(nodeHandle);
+    controlNH.setCallbackQueue(controlQueue);
+
+    joySubscriber = nodeHandle.subscribe((publishedName + "/joystick"), 10, &RoverBrain::joyCmdHandler, this);
+    modeSubscriber = nodeHandle.subscribe((publishedName + "/mode"), 1, &RoverBrain::modeHandler, this);
+    targetSubscriber = nodeHandle.subscribe((publishedName + "/targets"), 10, &RoverBrain::targetHandler, this);
+    obstacleSubscriber = nodeHandle.subscribe((publishedName + "/obstacle"), 10, &RoverBrain::obstacleHandler, this);
+    odometrySubscriber = nodeHandle.subscribe((publishedName + "/odom/filtered"), 10, &RoverBrain::odometryHandler, this);
+    mapSubscriber = nodeHandle.subscribe((publishedName + "/odom/ekf"), 10, &RoverBrain::mapHandler, this);
+
+    swarmMapSubscriber = nodeHandle.subscribe("/swarmMap", 100, &RoverBrain::swarmMapHandler, this);
+
+    const char* sonarTopics[SONAR_COUNT] = {"/sonarLeft", "/sonarCenter", "/sonarRight"};
+    for (int i = 0; i < SONAR_COUNT; i++) {
+        sonarSubscribers[i] = nodeHandle.subscribe<sensor_msgs::Range>((publishedName + sonarTopics[i]), 10, boost::bind(&RoverBrain::sonarHandler, this, (Sonar)i, _1));
+    }
+
+    status_publisher = nodeHandle.advertise<std_msgs::String>((publishedName + "/status"), 1, true);
+    stateMachinePublish = nodeHandle.advertise<std_msgs::String>((publishedName + "/state_machine"), 1, true);
+    fingerAnglePublish = nodeHandle.advertise<std_msgs::Float32>((publishedName + "/fingerAngle/cmd"), 1, true);
+    wristAnglePublish = nodeHandle.advertise<std_msgs::Float32>((publishedName + "/wristAngle/cmd"), 1, true);
+    infoLogPublisher = nodeHandle.advertise<std_msgs::String>("/infoLog", 1, true);
+    driveControlPublish = nodeHandle.advertise<geometry_msgs::Twist>((publishedName + "/driveControl"), 10);
+    heartbeatPublisher = nodeHandle.advertise<std_msgs::String>((publishedName + "/mobility/heartbeat"), 1, true);
+    swarmMapPublisher = nodeHandle.advertise<mobility::SwarmMapDelta>("/swarmMap", 10);
+
+    publish_status_timer = nodeHandle.createTimer(ros::Duration(status_publish_interval), &RoverBrain::publishStatusTimerEventHandler, this);
+    stateMachineTimer = controlNH.createTimer(ros::Duration(mobilityLoopTimeStep), &RoverBrain::mobilityStateMachine, this);
+    targetDetectedTimer = controlNH.createTimer(ros::Duration(0), &RoverBrain::targetDetectedReset, this, true);
+
+    publish_heartbeat_timer = nodeHandle.createTimer(ros::Duration(heartbeat_publish_interval), &RoverBrain::publishHeartBeatTimerEventHandler, this);
+
+    latencyReportTimer = controlNH.createTimer(ros::Duration(latencyReportInterval), &RoverBrain::latencyReportTimerEventHandler, this);
+    swarmMapTimer = controlNH.createTimer(ros::Duration(swarmMapPublishInterval), &RoverBrain::swarmMapTimerEventHandler, this);
+
+    // tf is polled on the control queue too, so a host adds no threads per rover
+    mapToOdomCache.start(controlNH);
+    cameraToBaseCache.start(controlNH);
+
+    std_msgs::String msg;
+    msg.data = "Log Started";
+    infoLogPublisher.publish(msg);
+
+    stringstream ss;
+    ss << "Rover start delay set to " << startDelayInSeconds << " seconds";
+    msg.data = ss.str();
+    infoLogPublisher.publish(msg);
+
+    timerStartTime = time(0);
+}
+
+// Stops all callbacks into this brain. Must be called before the brain is
+// destroyed while the spinners are still running.
+void RoverBrain::stop() {
+    joySubscriber.shutdown();
+    modeSubscriber.shutdown();
+    targetSubscriber.shutdown();
+    obstacleSubscriber.shutdown();
+    odometrySubscriber.shutdown();
+    mapSubscriber.shutdown();
+    for (int i = 0; i < SONAR_COUNT; i++) {
+        sonarSubscribers[i].shutdown();
+    }
+    swarmMapSubscriber.shutdown();
+
+    stateMachineTimer.stop();
+    publish_status_timer.stop();
+    targetDetectedTimer.stop();
+    publish_heartbeat_timer.stop();
+    latencyReportTimer.stop();
+    swarmMapTimer.stop();
+    mapToOdomCache.stop();
+    cameraToBaseCache.stop();
+
+    controlQueue->removeByID((uint64_t)this);
+}
+
+RoverBrain::~RoverBrain() {
+    stop();
+}
+
+void RoverBrain::setSearchMode(string mode) {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    if (mode == "coverage") {
+        searchController.setMode(SearchController::COVERAGE);
+    } else {
+        if (mode != "random") {
+            ROS_WARN("%s: unknown search mode %s, using random", publishedName.c_str(), mode.c_str());
+        }
+        searchController.setMode(SearchController::RANDOM_WALK);
+    }
+}
+
+void RoverBrain::setParams(const RoverParams& params) {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    this->params = params;
+    searchVelocity = params.searchVelocity;
+    pickUpController.setParams(params);
+    dropOffController.setParams(params);
+}
+
+// This is the top-most logic control block organised as a state machine.
+// This function calls the dropOff, pickUp, and search controllers.
+// This block passes the goal location to the proportional-integral-derivative
+// controllers in the abridge package.
+void RoverBrain::mobilityStateMachine(const ros::TimerEvent&) {
+    boost::mutex::scoped_lock lock(controlMutex);
+    ros::WallTime tickStart = ros::WallTime::now();
+
+    processInputs();
+    runStateMachine();
+
+    checkLatencyBudget(controlTickLatency, controlTickBudget, tickStart);
+}
+
+void RoverBrain::runStateMachine() {
+
+    int stateMachineDisplay = publishedStateMachineDisplay;
+    float rotateOnlyAngleTolerance = params.rotateOnlyAngleTolerance;
+    float returnToSearchDelay = params.returnToSearchDelay;
+
+    // calls the averaging function, also responsible for
+    // transform from Map frame to odom frame.
+    mapAverage();
+
+    // Robot is in automode
+    if (currentMode == 2 || currentMode == 3) {
+
+
+        // time since timerStartTime was set to current time
+        timerTimeElapsed = time(0) - timerStartTime;
+
+        // init code goes here. (code that runs only once at start of
+        // auto mode but wont work in main goes here)
+        if (!init) {
+            if (timerTimeElapsed > startDelayInSeconds) {
+                // Set the location of the center circle location in the map
+                // frame based upon our current average location on the map.
+                centerLocationMap.x = currentLocationAverage.x;
+                centerLocationMap.y = currentLocationAverage.y;
+                centerLocationMap.theta = currentLocationAverage.theta;
+
+                // initialization has run
+                init = true;
+            } else {
+                return;
+            }
+
+        }
+
+        // If no collected or detected blocks set fingers
+        // to open wide and raised position.
+        if (!targetCollected && !targetDetected) {
+            // open fingers
+            publishFingerAngle(M_PI_2);
+
+            // raise wrist
+            publishWristAngle(0);
+        }
+
+        // Select rotation or translation based on required adjustment
+        switch(stateMachineState) {
+
+        // If no adjustment needed, select new goal
+        case STATE_MACHINE_TRANSFORM: {
+            stateMachineDisplay = DISPLAY_TRANSFORMING;
+
+            // If returning with a target
+            if (targetCollected && !avoidingObstacle) {
+                // calculate the euclidean distance between
+                // centerLocation and currentLocation
+                dropOffController.setCenterDist(hypot(centerLocation.x - currentLocation.x, centerLocation.y - currentLocation.y));
+                dropOffController.setDataLocations(centerLocation, currentLocation, timerTimeElapsed);
+
+                DropOffResult result = dropOffController.getState();
+
+                if (result.timer) {
+                    timerStartTime = time(0);
+                    reachedCollectionPoint = true;
+                }
+
+                if (result.fingerAngle != -1) {
+                    publishFingerAngle(result.fingerAngle);
+                }
+
+                if (result.wristAngle != -1) {
+                    publishWristAngle(result.wristAngle);
+                }
+
+                if (result.reset) {
+                    timerStartTime = time(0);
+                    targetCollected = false;
+                    targetsDelivered++;
+                    targetDetected = false;
+                    lockTarget = false;
+                    sendDriveCommand(0.0,0);
+
+                    // move back to transform step
+                    stateMachineState = STATE_MACHINE_TRANSFORM;
+                    reachedCollectionPoint = false;;
+                    centerLocationOdom = currentLocation;
+
+                    dropOffController.reset();
+                } else if (result.goalDriving && timerTimeElapsed >= 5 ) {
+                    goalLocation = result.centerGoal;
+                    stateMachineState = STATE_MACHINE_ROTATE;
+                    timerStartTime = time(0);
+                }
+                // we are in precision/timed driving
+                else {
+                    goalLocation = currentLocation;
+                    sendDriveCommand(result.cmdVel,result.angleError);
+                    stateMachineState = STATE_MACHINE_TRANSFORM;
+
+                    break;
+                }
+            }
+            //If angle between current and goal is significant
+            //if error in heading is greater than 0.4 radians
+            else if (fabs(angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta)) > rotateOnlyAngleTolerance) {
+                stateMachineState = STATE_MACHINE_ROTATE;
+            }
+            //If goal has not yet been reached drive and maintane heading
+            else if (fabs(angles::shortest_angular_distance(currentLocation.theta, atan2(goalLocation.y - currentLocation.y, goalLocation.x - currentLocation.x))) < M_PI_2) {
+                stateMachineState = STATE_MACHINE_SKID_STEER;
+            }
+            //Otherwise, drop off target and select new random uniform heading
+            //If no targets have been detected, assign a new goal
+            else if (!targetDetected && timerTimeElapsed > returnToSearchDelay) {
+                goalLocation = searchController.search(currentLocation);
+            }
+
+            //Purposefully fall through to next case without breaking
+        }
+
+        // Calculate angle between currentLocation.theta and goalLocation.theta
+        // Rotate left or right depending on sign of angle
+        // Stay in this state until angle is minimized
+        case STATE_MACHINE_ROTATE: {
+            stateMachineDisplay = DISPLAY_ROTATING;
+            // Calculate the diffrence between current and desired
+            // heading in radians.
+            float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+
+            // If angle > 0.4 radians rotate but dont drive forward.
+            if (fabs(angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta)) > rotateOnlyAngleTolerance) {
+                // rotate but dont drive  0.05 is to prevent turning in reverse
+                sendDriveCommand(0.05, errorYaw);
+                break;
+            }
+            // Turned away but the obstacle is still there, so keep turning.
+            // This used to happen by the obstacle node repeating its code on
+            // every sonar reading, now it only reports changes.
+            else if (avoidingObstacle && (obstacleCode == 1 || obstacleCode == 2) && (!targetDetected || targetCollected)) {
+                avoidObstacle(obstacleCode);
+                obstacleReplans++;
+                break;
+            } else {
+                // move to differential drive step
+                stateMachineState = STATE_MACHINE_SKID_STEER;
+                //fall through on purpose.
+            }
+        }
+
+        // Calculate angle between currentLocation.x/y and goalLocation.x/y
+        // Drive forward
+        // Stay in this state until angle is at least PI/2
+        case STATE_MACHINE_SKID_STEER: {
+            stateMachineDisplay = DISPLAY_SKID_STEER;
+
+            // calculate the distance between current and desired heading in radians
+            float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+
+            // goal not yet reached drive while maintaining proper heading.
+            if (fabs(angles::shortest_angular_distance(currentLocation.theta, atan2(goalLocation.y - currentLocation.y, goalLocation.x - currentLocation.x))) < M_PI_2) {
+                // drive and turn simultaniously
+                sendDriveCommand(searchVelocity, errorYaw/2);
+            }
+            // goal is reached but desired heading is still wrong turn only
+            else if (fabs(angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta)) > 0.1) {
+                 // rotate but dont drive
+                sendDriveCommand(0.0, errorYaw);
+            }
+            else {
+                // stop
+                sendDriveCommand(0.0, 0.0);
+                avoidingObstacle = false;
+
+                // move back to transform step
+                stateMachineState = STATE_MACHINE_TRANSFORM;
+            }
+
+            break;
+        }
+
+        case STATE_MACHINE_PICKUP: {
+            stateMachineDisplay = DISPLAY_PICKUP;
+
+            PickUpResult result;
+
+            // we see a block and have not picked one up yet
+            if (targetDetected && !targetCollected) {
+                result = pickUpController.pickUpSelectedTarget(blockBlock);
+                sendDriveCommand(result.cmdVel,result.angleError);
+
+                if (result.fingerAngle != -1) {
+                    publishFingerAngle(result.fingerAngle);
+                }
+
+                if (result.wristAngle != -1) {
+                    // raise wrist
+                    publishWristAngle(result.wristAngle);
+                }
+
+                if (result.giveUp) {
+                    targetDetected = false;
+                    stateMachineState = STATE_MACHINE_TRANSFORM;
+                    sendDriveCommand(0,0);
+                    pickUpController.reset();
+                }
+
+                if (result.pickedUp) {
+                    pickUpController.reset();
+
+                    // assume target has been picked up by gripper
+                    targetCollected = true;
+
+                    // it was just in front of the rover, tell the others it is gone
+                    swarmMap.addTargetCollected(currentLocationMap.x + targetSightingDistance * cos(currentLocationMap.theta),
+                                                currentLocationMap.y + targetSightingDistance * sin(currentLocationMap.theta));
+
+                    // and forget it here, along with any other sighting of it
+                    targetMemory.forgetNear(currentLocation.x, currentLocation.y, pickedUpForgetRadius);
+                    searchController.targetPickedUp();
+                    result.pickedUp = false;
+                    stateMachineState = STATE_MACHINE_ROTATE;
+
+                    goalLocation.theta = atan2(centerLocationOdom.y - currentLocation.y, centerLocationOdom.x - currentLocation.x);
+
+                    // set center as goal position
+                    goalLocation.x = centerLocationOdom.x = 0;
+                    goalLocation.y = centerLocationOdom.y;
+
+                    // lower wrist to avoid ultrasound sensors
+                    publishWristAngle(0.8);
+                    sendDriveCommand(0.0,0);
+
+                    return;
+                }
+            } else {
+                stateMachineState = STATE_MACHINE_TRANSFORM;
+            }
+
+            break;
+        }
+
+        case STATE_MACHINE_DROPOFF: {
+            stateMachineDisplay = DISPLAY_DROPOFF;
+            break;
+        }
+
+        default: {
+            break;
+        }
+
+        } /* end of switch() */
+    }
+    // mode is NOT auto
+    else {
+        // publish current state for the operator to see
+        stateMachineDisplay = DISPLAY_WAITING;
+    }
+
+    // publish state machine string for user, only if it has changed, though
+    if (stateMachineDisplay != publishedStateMachineDisplay) {
+        stateMachinePublish.publish(stateMachineMessages[stateMachineDisplay]);
+        publishedStateMachineDisplay = stateMachineDisplay;
+    }
+}
+
+void RoverBrain::publishFingerAngle(float angle) {
+    fingerAngleMessage.data = angle;
+    fingerAnglePublish.publish(fingerAngleMessage);
+}
+
+void RoverBrain::publishWristAngle(float angle) {
+    wristAngleMessage.data = angle;
+    wristAnglePublish.publish(wristAngleMessage);
+}
+
+void RoverBrain::sendDriveCommand(double linearVel, double angularError)
+{
+    velocity.linear.x = linearVel,
+    velocity.angular.z = angularError;
+
+    // publish the drive commands
+    driveControlPublish.publish(velocity);
+}
+
+/*************************
+ * ROS CALLBACK HANDLERS *
+ *************************/
+
+// These run on the sensor threads. They only hand the message over to the
+// control stage and must not touch any other state.
+
+void RoverBrain::targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message) {
+    targetMailbox.write(message);
+    requestControlWakeup();
+}
+
+void RoverBrain::modeHandler(const std_msgs::UInt8::ConstPtr& message) {
+    ModeInput input;
+    input.mode = message->data;
+    input.received = ros::WallTime::now();
+    modeMailbox.write(input);
+    requestControlWakeup();
+}
+
+void RoverBrain::obstacleHandler(const std_msgs::UInt8::ConstPtr& message) {
+    ObstacleInput input;
+    input.code = message->data;
+    input.received = ros::WallTime::now();
+    obstacleMailbox.write(input);
+    requestControlWakeup();
+}
+
+void RoverBrain::odometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    PoseInput input;
+
+    //Get (x,y) location directly from pose
+    input.x = message->pose.pose.position.x;
+    input.y = message->pose.pose.position.y;
+
+    //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
+    tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
+    tf::Matrix3x3 m(q);
+    double roll, pitch, yaw;
+    m.getRPY(roll, pitch, yaw);
+    input.theta = yaw;
+
+    odometryMailbox.write(input);
+}
+
+void RoverBrain::mapHandler(const nav_msgs::Odometry::ConstPtr& message) {
+    PoseInput input;
+
+    //Get (x,y) location directly from pose
+    input.x = message->pose.pose.position.x;
+    input.y = message->pose.pose.position.y;
+
+    //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
+    tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
+    tf::Matrix3x3 m(q);
+    double roll, pitch, yaw;
+    m.getRPY(roll, pitch, yaw);
+    input.theta = yaw;
+
+    mapMailbox.write(input);
+}
+
+void RoverBrain::sonarHandler(Sonar sonar, const sensor_msgs::Range::ConstPtr& message) {
+    SonarInput input;
+    input.range = message->range;
+    input.maxRange = message->max_range;
+    sonarMailboxes[sonar].write(input);
+}
+
+void RoverBrain::swarmMapHandler(const mobility::SwarmMapDelta::ConstPtr& message) {
+    if (message->rover == publishedName) return;
+
+    boost::mutex::scoped_lock lock(swarmInboxMutex);
+
+    // a control stage that fell this far behind loses the oldest deltas,
+    // the next full map from each rover makes up for them
+    if (swarmInbox.size() >= maxSwarmInbox) {
+        swarmInbox.erase(swarmInbox.begin());
+    }
+    swarmInbox.push_back(message);
+}
+
+void RoverBrain::joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message) {
+    JoystickInput input;
+    input.linear = abs(message->axes[4]) >= 0.1 ? message->axes[4] : 0;
+    input.angular = abs(message->axes[3]) >= 0.1 ? message->axes[3] : 0;
+    input.received = ros::WallTime::now();
+    joystickMailbox.write(input);
+    requestControlWakeup();
+}
+
+/*****************
+ * CONTROL STAGE *
+ *****************/
+
+// Queued on the control queue to handle events between state machine ticks
+class RoverBrain::ControlWakeup : public ros::CallbackInterface {
+  public:
+    ControlWakeup(RoverBrain* brain) : brain(brain) {}
+
+    virtual CallResult call() {
+        brain->controlWakeup();
+        return Success;
+    }
+
+  private:
+    RoverBrain* brain;
+};
+
+void RoverBrain::requestControlWakeup() {
+    if (!controlWakeupPending.exchange(true)) {
+        // owned by this brain so pending wakeups are dropped when it is destroyed
+        controlQueue->addCallback(ros::CallbackInterfacePtr(new ControlWakeup(this)), (uint64_t)this);
+    }
+}
+
+void RoverBrain::controlWakeup() {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    controlWakeupPending = false;
+    processInputs();
+}
+
+// Apply whatever has arrived in the mailboxes since the last call
+void RoverBrain::processInputs() {
+    PoseInput pose;
+    unsigned int version;
+
+    version = odometryMailbox.read(pose);
+    if (version != odometryVersion) {
+        odometryVersion = version;
+        currentLocation.x = pose.x;
+        currentLocation.y = pose.y;
+        currentLocation.theta = pose.theta;
+
+        coverageMap.markFootprint(currentLocation.x, currentLocation.y, currentLocation.theta);
+    }
+
+    version = mapMailbox.read(pose);
+    if (version != mapVersion) {
+        mapVersion = version;
+        currentLocationMap.x = pose.x;
+        currentLocationMap.y = pose.y;
+        currentLocationMap.theta = pose.theta;
+
+        swarmMap.markFootprint(currentLocationMap.x, currentLocationMap.y, currentLocationMap.theta);
+    }
+
+    ModeInput mode;
+    version = modeMailbox.read(mode);
+    if (version != modeVersion) {
+        modeVersion = version;
+        processMode(mode);
+    }
+
+    updateOccupancyGrid();
+    mergeSwarmMaps();
+    targetMemory.expire(ros::Time::now().toSec());
+
+    ObstacleInput obstacle;
+    version = obstacleMailbox.read(obstacle);
+    if (version != obstacleVersion) {
+        obstacleVersion = version;
+        processObstacle(obstacle);
+    }
+
+    apriltags_ros::AprilTagDetectionArray::ConstPtr targets = targetMailbox.read();
+    if (targets && targets != lastTargets) {
+        lastTargets = targets;
+        processTargets(targets);
+    }
+
+    JoystickInput joystick;
+    version = joystickMailbox.read(joystick);
+    if (version != joystickVersion) {
+        joystickVersion = version;
+        processJoystick(joystick);
+    }
+}
+
+// Records how long ago an input was received and warns when that exceeds
+// the budget for that input
+void RoverBrain::checkLatencyBudget(LatencyHistogram& histogram, float budget, ros::WallTime received) {
+    double latency = (ros::WallTime::now() - received).toSec();
+    histogram.record(latency);
+
+    if (latency > budget) {
+        // formatted on the stack, the control loop is already running late
+        char summary[256];
+        histogram.format(summary, sizeof(summary));
+        ROS_WARN_THROTTLE(10, "%s: %s took %.1f ms, budget is %.1f ms", publishedName.c_str(), summary, latency * 1e3, budget * 1e3);
+    }
+}
+
+void RoverBrain::processTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message) {
+
+    // If in manual mode do not try to automatically pick up the target
+    if (currentMode == 1 || currentMode == 0) return;
+
+    rememberTargets(message);
+
+    // Share every target in view with the swarm, it may be a while before
+    // this rover can come back for it. The camera does not give a usable
+    // range, so the target is put in the middle of the camera's footprint.
+    for (int i = 0; i < message->detections.size(); i++) {
+        if (message->detections[i].id != 256) {
+            swarmMap.addTargetSeen(currentLocationMap.x + targetSightingDistance * cos(currentLocationMap.theta),
+                                   currentLocationMap.y + targetSightingDistance * sin(currentLocationMap.theta));
+            break;
+        }
+    }
+
+    // if a target is detected and we are looking for center tags
+    if (message->detections.size() > 0 && !reachedCollectionPoint) {
+        float cameraOffsetCorrection = 0.020; //meters;
+
+        centerSeen = false;
+        double count = 0;
+        double countRight = 0;
+        double countLeft = 0;
+
+        // this loop is to get the number of center tags
+        for (int i = 0; i < message->detections.size(); i++) {
+            if (message->detections[i].id == 256) {
+                geometry_msgs::PoseStamped cenPose = message->detections[i].pose;
+
+                // checks if tag is on the right or left side of the image
+                if (cenPose.pose.position.x + cameraOffsetCorrection > 0) {
+                    countRight++;
+
+                } else {
+                    countLeft++;
+                }
+
+                centerSeen = true;
+                count++;
+            }
+        }
+
+        if (centerSeen && targetCollected) {
+            stateMachineState = STATE_MACHINE_TRANSFORM;
+            goalLocation = currentLocation;
+        }
+
+        dropOffController.setDataTargets(count,countLeft,countRight);
+
+        // if we see the center and we dont have a target collected
+        if (centerSeen && !targetCollected) {
+
+            float centeringTurn = 0.15; //radians
+            stateMachineState = STATE_MACHINE_TRANSFORM;
+
+            // this code keeps the robot from driving over
+            // the center when searching for blocks
+            if (right) {
+                // turn away from the center to the left if just driving
+                // around/searching.
+                goalLocation.theta += centeringTurn;
+            } else {
+                // turn away from the center to the right if just driving
+                // around/searching.
+                goalLocation.theta -= centeringTurn;
+            }
+
+            // continues an interrupted search
+            goalLocation = searchController.continueInterruptedSearch(currentLocation, goalLocation);
+
+            targetDetected = false;
+            pickUpController.reset();
+
+            return;
+        }
+    }
+    // end found target and looking for center tags
+
+    // found a target april tag and looking for april cubes;
+    // with safety timer at greater than 5 seconds.
+    PickUpResult result;
+
+    if (message->detections.size() > 0 && !targetCollected && timerTimeElapsed > 5) {
+        targetDetected = true;
+
+        // pickup state so target handler can take over driving.
+        stateMachineState = STATE_MACHINE_PICKUP;
+        result = pickUpController.selectTarget(message);
+
+        if (result.fingerAngle != -1) {
+            publishFingerAngle(result.fingerAngle);
+        }
+
+        if (result.wristAngle != -1) {
+            publishWristAngle(result.wristAngle);
+        }
+    }
+}
+
+void RoverBrain::processMode(const ModeInput& input) {
+    currentMode = input.mode;
+    sendDriveCommand(0.0, 0.0);
+
+    checkLatencyBudget(modeLatency, modeLatencyBudget, input.received);
+}
+
+void RoverBrain::processObstacle(const ObstacleInput& input) {
+    obstacleMessages++;
+
+    // the front ultrasound is blocked very closely. 0.14m currently. Kept
+    // up to date on every message, keepalives included.
+    blockBlock = input.code == 4;
+
+    bool changed = input.code != obstacleCode;
+    obstacleCode = input.code;
+    if (changed) obstacleChanges++;
+
+    if ((!targetDetected || targetCollected) && (input.code > 0)) {
+        // a keepalive repeating the code the rover is already turning away
+        // from needs no new plan. One that finds it no longer avoiding, the
+        // turn having ended or a target having been dropped, does.
+        if (!changed && avoidingObstacle) return;
+
+        avoidObstacle(input.code);
+
+        // start turning away now rather than on the next state machine tick
+        if ((currentMode == 2 || currentMode == 3) && init) {
+            float errorYaw = angles::shortest_angular_distance(currentLocation.theta, goalLocation.theta);
+
+            // rotate but dont drive  0.05 is to prevent turning in reverse
+            sendDriveCommand(0.05, errorYaw);
+
+            checkLatencyBudget(obstacleLatency, obstacleLatencyBudget, input.received);
+        }
+    }
+}
+
+void RoverBrain::avoidObstacle(unsigned char code) {
+    if (code == 1 || code == 2) {
+        // turn left by default, unless the occupancy grid remembers an
+        // obstacle within a meter on the left and none on the right
+        float turn = 0.6;
+        float left = currentLocation.theta + turn;
+        float right = currentLocation.theta - turn;
+
+        bool leftClear = occupancyGrid.isSegmentClear(currentLocation.x, currentLocation.y, currentLocation.x + cos(left), currentLocation.y + sin(left));
+        bool rightClear = occupancyGrid.isSegmentClear(currentLocation.x, currentLocation.y, currentLocation.x + cos(right), currentLocation.y + sin(right));
+
+        if (!leftClear && rightClear) {
+            turn = -turn;
+        }
+
+        goalLocation.theta = currentLocation.theta + turn;
+    }
+
+    // continues an interrupted search
+    goalLocation = searchController.continueInterruptedSearch(currentLocation, goalLocation);
+
+    // switch to transform state to trigger collision avoidance
+    stateMachineState = STATE_MACHINE_ROTATE;
+
+    avoidingObstacle = true;
+}
+
+// Draws whatever the sonars reported since the last tick into the occupancy
+// grid, from the rover's current odometry pose
+void RoverBrain::updateOccupancyGrid() {
+    ros::WallTime start = ros::WallTime::now();
+    bool updated = false;
+
+    occupancyGrid.recenter(currentLocation.x, currentLocation.y);
+
+    double cosTheta = cos(currentLocation.theta);
+    double sinTheta = sin(currentLocation.theta);
+
+    for (int i = 0; i < SONAR_COUNT; i++) {
+        SonarInput sonar;
+        unsigned int version = sonarMailboxes[i].read(sonar);
+        if (version == sonarVersions[i]) continue;
+        sonarVersions[i] = version;
+
+        const SonarMount& mount = sonarMounts[i];
+        double x = currentLocation.x + mount.x * cosTheta - mount.y * sinTheta;
+        double y = currentLocation.y + mount.x * sinTheta + mount.y * cosTheta;
+
+        // a reading at the end of the sonar's range saw nothing. Without a
+        // max range the two cannot be told apart, so the reading only clears
+        // the cells it passed through rather than risk a phantom obstacle.
+        bool hit = sonar.maxRange > 0 && sonar.range < 0.95 * sonar.maxRange;
+
+        for (int ray = 0; ray < raysPerSonar; ray++) {
+            double offset = sonarHalfAngle * (2.0 * ray / (raysPerSonar - 1) - 1);
+            occupancyGrid.addRay(x, y, currentLocation.theta + mount.heading + offset, sonar.range, hit);
+        }
+
+        updated = true;
+    }
+
+    if (updated) {
+        occupancyGridLatency.record((ros::WallTime::now() - start).toSec());
+    }
+}
+
+// Remembers every target in view in the odom frame. Only the closest one is
+// picked up, and none while one is being carried, so the others would
+// otherwise be lost until the search happens to pass them again.
+void RoverBrain::rememberTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message) {
+    if (message->detections.empty()) return;
+
+    // The poses are in whatever frame the detector was set up with, usually
+    // the camera's optical frame. The camera is fixed to the chassis, so the
+    // transform only has to be looked up once, the cache keeps it handy.
+    const std::string& cameraFrame = message->detections[0].pose.header.frame_id;
+    if (!cameraFrame.empty()) {
+        cameraToBaseCache.setSourceFrame(cameraFrame);
+    }
+
+    tf::Transform cameraToBase;
+    ros::Duration transformAge;
+    if (!cameraToBaseCache.getTransform(cameraToBase, transformAge)) return;
+
+    double cosTheta = cos(currentLocation.theta);
+    double sinTheta = sin(currentLocation.theta);
+    double now = ros::Time::now().toSec();
+
+    for (int i = 0; i < message->detections.size(); i++) {
+        // collection disk tags are not targets
+        if (message->detections[i].id == 256) continue;
+
+        const geometry_msgs::Point& position = message->detections[i].pose.pose.position;
+        double range = sqrt(position.x * position.x + position.y * position.y + position.z * position.z);
+        if (range < minRememberDistance || range > maxRememberDistance) continue;
+
+        tf::Vector3 base = cameraToBase * tf::Vector3(position.x, position.y, position.z);
+
+        double x = currentLocation.x + base.x() * cosTheta - base.y() * sinTheta;
+        double y = currentLocation.y + base.x() * sinTheta + base.y() * cosTheta;
+
+        // targets on or next to the collection disk are most likely delivered ones
+        if (hypot(x - centerLocation.x, y - centerLocation.y) < collectionDiskRadius) continue;
+
+        targetMemory.add(message->detections[i].id, x, y, now);
+    }
+}
+
+// Merges the other rovers' maps that arrived since the last tick, and marks
+// the ground they covered in this rover's odom frame coverage map
+void RoverBrain::mergeSwarmMaps() {
+    // the two buffers trade places on every merge, both keep their capacity
+    {
+        boost::mutex::scoped_lock lock(swarmInboxMutex);
+        swarmMessages.swap(swarmInbox);
+    }
+
+    if (swarmMessages.empty()) return;
+
+    // without the transform the cells are still merged into the swarm map,
+    // they just do not steer this rover's coverage search
+    tf::Transform mapToOdom;
+    ros::Duration transformAge;
+    bool haveTransform = mapToOdomCache.getTransform(mapToOdom, transformAge);
+
+    for (size_t i = 0; i < swarmMessages.size(); i++) {
+        const mobility::SwarmMapDelta& message = *swarmMessages[i];
+
+        swarmMessagesReceived++;
+        swarmBytesReceived += message.covered.size() + message.targets_seen.size() + message.targets_collected.size();
+
+        newlyCovered.clear();
+        if (!swarmMap.merge(message, &newlyCovered)) {
+            ROS_WARN_THROTTLE(10, "%s: ignoring a swarm map from %s that does not match this rover's grid", publishedName.c_str(), message.rover.c_str());
+            continue;
+        }
+
+        if (!haveTransform) continue;
+
+        for (size_t j = 0; j < newlyCovered.size(); j++) {
+            double x, y;
+            swarmMap.getCellCenter(newlyCovered[j], x, y);
+
+            tf::Vector3 odom = mapToOdom * tf::Vector3(x, y, 0);
+            int index = coverageMap.cellIndex(odom.x(), odom.y());
+            if (index >= 0) coverageMap.markCell(index);
+        }
+    }
+
+    swarmMessages.clear();
+}
+
+void RoverBrain::swarmMapTimerEventHandler(const ros::TimerEvent&) {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    // every so often send the whole map for rovers that missed a delta
+    bool full = swarmMapTicks % swarmMapFullEvery == 0;
+    swarmMapTicks++;
+
+    mobility::SwarmMapDelta message;
+    if (!swarmMap.buildMessage(message, full)) return;
+
+    message.rover = publishedName;
+    swarmMapPublisher.publish(message);
+
+    swarmMessagesSent++;
+    swarmBytesSent += message.covered.size() + message.targets_seen.size() + message.targets_collected.size();
+}
+
+void RoverBrain::processJoystick(const JoystickInput& input) {
+    if (currentMode == 0 || currentMode == 1) {
+        sendDriveCommand(input.linear, input.angular);
+
+        checkLatencyBudget(joystickLatency, joystickLatencyBudget, input.received);
+    }
+}
+
+void RoverBrain::publishStatusTimerEventHandler(const ros::TimerEvent&) {
+    status_publisher.publish(statusMessage);
+}
+
+
+void RoverBrain::targetDetectedReset(const ros::TimerEvent& event) {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    targetDetected = false;
+
+    // close fingers
+    publishFingerAngle(0);
+
+    // raise wrist
+    publishWristAngle(0);
+}
+
+void RoverBrain::mapAverage() {
+    // store currentLocation in the averaging window
+    mapAverager.addPose(currentLocationMap);
+    currentLocationAverage = mapAverager.getAverage();
+
+    // only run below code if a centerLocation has been set by initilization
+    if (init) {
+        tf::Transform mapToOdom;
+        ros::Duration transformAge;
+
+        // use whatever transform the cache holds rather than waiting on tf,
+        // the center location stays where it was until one arrives
+        if (!mapToOdomCache.getTransform(mapToOdom, transformAge)) return;
+
+        bool stale = transformAge.toSec() > maxTransformAge;
+
+        // report staleness only when it changes to avoid flooding the log
+        if (stale != transformStale) {
+            transformStale = stale;
+
+            std_msgs::String msg;
+            stringstream ss;
+            if (stale) {
+                ss << publishedName << " map to odom transform is stale (" << transformAge.toSec() << " seconds old)";
+            } else {
+                ss << publishedName << " map to odom transform is current again";
+            }
+            msg.data = ss.str();
+            infoLogPublisher.publish(msg);
+        }
+
+        // transform the center location from the map frame to the odom frame
+        tf::Vector3 centerOdom = mapToOdom * tf::Vector3(centerLocationMap.x, centerLocationMap.y, 0);
+        centerLocation.x = centerOdom.x();
+        centerLocation.y = centerOdom.y();
+    }
+}
+
+void RoverBrain::publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
+    heartbeatPublisher.publish(heartbeatMessage);
+}
+
+void RoverBrain::latencyReportTimerEventHandler(const ros::TimerEvent&) {
+    boost::mutex::scoped_lock lock(controlMutex);
+
+    LatencyHistogram* histograms[] = {&controlTickLatency, &obstacleLatency, &modeLatency, &joystickLatency, &occupancyGridLatency};
+
+    for (int i = 0; i < 5; i++) {
+        if (histograms[i]->getCount() > 0) {
+            ROS_INFO_STREAM(publishedName << " " << histograms[i]->summary());
+        }
+        histograms[i]->reset();
+    }
+
+    ROS_INFO("%s search (%s): camera has covered %.1f square meters",
+             publishedName.c_str(), searchController.getMode() == SearchController::COVERAGE ? "coverage" : "random",
+             coverageMap.getCoveredCount() * coverageMap.getCellArea());
+
+    ROS_INFO("%s swarm map: sent %lu messages (%lu bytes of cells), merged %lu messages (%lu bytes of cells), %.1f square meters covered by the swarm",
+             publishedName.c_str(), swarmMessagesSent, swarmBytesSent, swarmMessagesReceived, swarmBytesReceived,
+             swarmMap.getCoveredCount() * swarmMap.getCellArea());
+    swarmMessagesSent = 0;
+    swarmBytesSent = 0;
+    swarmMessagesReceived = 0;
+    swarmBytesReceived = 0;
+
+    ROS_INFO("%s targets: %lu delivered, %d seen and remembered for later",
+             publishedName.c_str(), targetsDelivered, targetMemory.size());
+
+    if (obstacleMessages > 0) {
+        ROS_INFO("%s obstacle messages: %lu processed, %lu changed the code, %lu turns extended",
+                 publishedName.c_str(), obstacleMessages, obstacleChanges, obstacleReplans);
+    }
+    obstacleMessages = 0;
+    obstacleChanges = 0;
+    obstacleReplans = 0;
+}
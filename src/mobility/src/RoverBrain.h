@@ -0,0 +1,361 @@
+#ifndef ROVER_BRAIN_H
+#define ROVER_BRAIN_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+// ROS libraries
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <random_numbers/random_numbers.h>
+#include <tf/transform_listener.h>
+
+// ROS messages
+#include <std_msgs/UInt8.h>
+#include <std_msgs/Float32.h>
+#include <std_msgs/String.h>
+#include <sensor_msgs/Joy.h>
+#include <sensor_msgs/Range.h>
+#include <geometry_msgs/Pose2D.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/Odometry.h>
+#include <apriltags_ros/AprilTagDetectionArray.h>
+#include <mobility/SwarmMapDelta.h>
+
+// Include Controllers
+#include "PickUpController.h"
+#include "DropOffController.h"
+#include "SearchController.h"
+
+#include "RoverParams.h"
+#include "PoseAverager.h"
+#include "OccupancyGrid.h"
+#include "CoverageMap.h"
+#include "SwarmMap.h"
+#include "TargetMemory.h"
+#include "TransformCache.h"
+#include "LatencyHistogram.h"
+#include "LatestValue.h"
+
+/**
+ * All of the state and behaviour of a single rover's mobility node: the
+ * pickup, dropoff and search controllers, the state machine that sequences
+ * them, and the ROS topics they talk over.
+ *
+ * A RoverBrain runs in two stages. The sensor callbacks (ingest stage) only
+ * store the latest message for their topic in a lock-free mailbox. Everything
+ * that reads or changes the rover's state (control stage) runs from
+ * controlQueue and is serialised by controlMutex, so several brains can share
+ * one process, one tf listener and one pool of threads.
+ */
+class RoverBrain {
+
+  public:
+
+    // sensor callbacks are serviced by nodeHandle's queue, the control stage
+    // by controlQueue, which runs the state machine loopRate times a second
+    RoverBrain(std::string publishedName, ros::NodeHandle& nodeHandle, ros::CallbackQueue* controlQueue, tf::TransformListener* tfListener, float loopRate = 10);
+    ~RoverBrain();
+
+    void stop();
+
+    std::string getName() {return publishedName;}
+
+    // "random" or "coverage", see SearchController::Mode
+    void setSearchMode(std::string mode);
+
+    // the tunable constants, normally loaded from /<name>/mobility
+    void setParams(const RoverParams& params);
+
+  private:
+
+    class ControlWakeup;
+
+    // Latest message of each input topic, written by the ingest stage
+    struct PoseInput {
+      double x;
+      double y;
+      double theta;
+    };
+
+    struct ObstacleInput {
+      unsigned char code;
+      ros::WallTime received;
+    };
+
+    struct ModeInput {
+      unsigned char mode;
+      ros::WallTime received;
+    };
+
+    struct JoystickInput {
+      float linear;
+      float angular;
+      ros::WallTime received;
+    };
+
+    struct SonarInput {
+      float range;
+      float maxRange;
+    };
+
+    enum Sonar {
+      SONAR_LEFT = 0,
+      SONAR_CENTER = 1,
+      SONAR_RIGHT = 2,
+      SONAR_COUNT = 3
+    };
+
+    // Mobility Logic Functions
+    void sendDriveCommand(double linearVel, double angularVel);
+    void publishFingerAngle(float angle);
+    void publishWristAngle(float angle);
+    void mapAverage();  // constantly averages last mapHistorySize positions from map
+    void runStateMachine();
+
+    //Callback handlers, run on the sensor threads
+    void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message);
+    void modeHandler(const std_msgs::UInt8::ConstPtr& message);
+    void targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& tagInfo);
+    void obstacleHandler(const std_msgs::UInt8::ConstPtr& message);
+    void odometryHandler(const nav_msgs::Odometry::ConstPtr& message);
+    void mapHandler(const nav_msgs::Odometry::ConstPtr& message);
+    void sonarHandler(Sonar sonar, const sensor_msgs::Range::ConstPtr& message);
+    void swarmMapHandler(const mobility::SwarmMapDelta::ConstPtr& message);
+    void publishStatusTimerEventHandler(const ros::TimerEvent& event);
+    void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
+
+    // Control stage, only called from controlQueue
+    void mobilityStateMachine(const ros::TimerEvent&);
+    void targetDetectedReset(const ros::TimerEvent& event);
+    void latencyReportTimerEventHandler(const ros::TimerEvent& event);
+    void swarmMapTimerEventHandler(const ros::TimerEvent& event);
+    void controlWakeup();
+    void requestControlWakeup();
+    void processInputs();
+    void processTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message);
+    void processMode(const ModeInput& input);
+    void processObstacle(const ObstacleInput& input);
+    void avoidObstacle(unsigned char code);
+    void updateOccupancyGrid();
+    void mergeSwarmMaps();
+    void rememberTargets(const apriltags_ros::AprilTagDetectionArray::ConstPtr& message);
+    void processJoystick(const JoystickInput& input);
+    void checkLatencyBudget(LatencyHistogram& histogram, float budget, ros::WallTime received);
+
+    std::string publishedName;
+
+    // Random number generator
+    random_numbers::RandomNumberGenerator rng;
+
+    // Controllers
+    PickUpController pickUpController;
+    DropOffController dropOffController;
+    SearchController searchController;
+
+    // Obstacles seen by the sonars around the rover, in the odom frame
+    OccupancyGrid occupancyGrid;
+
+    // Ground the camera has already looked at, in the odom frame
+    CoverageMap coverageMap;
+
+    // Targets seen but not picked up yet, in the odom frame
+    TargetMemory targetMemory;
+    unsigned long targetsDelivered;
+
+    // What the whole swarm has seen, in the map frame. Other rovers' messages
+    // are queued by the ingest stage and merged by the control stage, which
+    // also marks their coverage in coverageMap.
+    SwarmMap swarmMap;
+    boost::mutex swarmInboxMutex;
+    std::vector<mobility::SwarmMapDelta::ConstPtr> swarmInbox;
+    static const size_t maxSwarmInbox = 64;
+
+    // swapped with swarmInbox by the control stage, which merges from it
+    std::vector<mobility::SwarmMapDelta::ConstPtr> swarmMessages;
+    std::vector<int> newlyCovered;
+
+    float swarmMapPublishInterval; // seconds
+    int swarmMapFullEvery; // every this many publish ticks sends the whole map
+    unsigned long swarmMapTicks;
+
+    // traffic on /swarmMap since the last report
+    unsigned long swarmMessagesSent;
+    unsigned long swarmBytesSent;
+    unsigned long swarmMessagesReceived;
+    unsigned long swarmBytesReceived;
+
+    // Numeric Variables for rover positioning
+    geometry_msgs::Pose2D currentLocation;
+    geometry_msgs::Pose2D currentLocationMap;
+    geometry_msgs::Pose2D currentLocationAverage;
+    geometry_msgs::Pose2D goalLocation;
+
+    geometry_msgs::Pose2D centerLocation;
+    geometry_msgs::Pose2D centerLocationMap;
+    geometry_msgs::Pose2D centerLocationOdom;
+
+    int currentMode;
+    float mobilityLoopTimeStep; // time between the mobility loop calls
+    float status_publish_interval;
+    float killSwitchTimeout;
+    bool targetDetected;
+    bool targetCollected;
+    float heartbeat_publish_interval;
+
+    // Set true when the target block is less than targetDist so we continue
+    // attempting to pick it up rather than switching to another block in view.
+    bool lockTarget;
+
+    // Failsafe state. No legitimate behavior state. If in this state for too long
+    // return to searching as default behavior.
+    bool timeOut;
+
+    // Set to true when the center ultrasound reads less than 0.14m. Usually means
+    // a picked up cube is in the way.
+    bool blockBlock;
+
+    // central collection point has been seen (aka the nest)
+    bool centerSeen;
+
+    // Set true when we are insie the center circle and we need to drop the block,
+    // back out, and reset the boolean cascade.
+    bool reachedCollectionPoint;
+
+    // used for calling code once but not in the constructor
+    bool init;
+
+    // How many points to use in calculating the map average position
+    static const unsigned int mapHistorySize = 500;
+
+    // Running average of the most recent map positions
+    PoseAverager mapAverager;
+
+    bool avoidingObstacle;
+
+    // Last obstacle code acted on. The obstacle node only publishes changes
+    // plus a slow keepalive, so a repeated code carries no new information.
+    unsigned char obstacleCode;
+
+    // obstacle messages received, how many changed the code, and how many
+    // times a finished turn was extended because the obstacle was still there
+    unsigned long obstacleMessages;
+    unsigned long obstacleChanges;
+    unsigned long obstacleReplans;
+
+    RoverParams params;
+    float searchVelocity; // meters/second
+
+    int stateMachineState;
+
+    // Outgoing messages, reused rather than built on every tick
+    geometry_msgs::Twist velocity;
+    std_msgs::Float32 fingerAngleMessage;
+    std_msgs::Float32 wristAngleMessage;
+    std_msgs::String statusMessage;
+    std_msgs::String heartbeatMessage;
+
+    // State machine names shown to the operator, one prebuilt message each
+    enum StateMachineDisplay {
+      DISPLAY_TRANSFORMING,
+      DISPLAY_ROTATING,
+      DISPLAY_SKID_STEER,
+      DISPLAY_PICKUP,
+      DISPLAY_DROPOFF,
+      DISPLAY_WAITING,
+      DISPLAY_COUNT
+    };
+    std_msgs::String stateMachineMessages[DISPLAY_COUNT];
+    int publishedStateMachineDisplay; // -1 until the first publish
+
+    // Publishers
+    ros::Publisher stateMachinePublish;
+    ros::Publisher status_publisher;
+    ros::Publisher fingerAnglePublish;
+    ros::Publisher wristAnglePublish;
+    ros::Publisher infoLogPublisher;
+    ros::Publisher driveControlPublish;
+    ros::Publisher heartbeatPublisher;
+    ros::Publisher swarmMapPublisher;
+
+    // Subscribers
+    ros::Subscriber joySubscriber;
+    ros::Subscriber modeSubscriber;
+    ros::Subscriber targetSubscriber;
+    ros::Subscriber obstacleSubscriber;
+    ros::Subscriber odometrySubscriber;
+    ros::Subscriber mapSubscriber;
+    ros::Subscriber sonarSubscribers[SONAR_COUNT];
+    ros::Subscriber swarmMapSubscriber;
+
+    // Timers
+    ros::Timer stateMachineTimer;
+    ros::Timer publish_status_timer;
+    ros::Timer targetDetectedTimer;
+    ros::Timer publish_heartbeat_timer;
+    ros::Timer latencyReportTimer;
+    ros::Timer swarmMapTimer;
+
+    // records time for delays in sequanced actions, 1 second resolution.
+    time_t timerStartTime;
+
+    // An initial delay to allow the rover to gather enough position data to
+    // average its location.
+    unsigned int startDelayInSeconds;
+    float timerTimeElapsed;
+
+    // Latest map to odom transform, looked up without ever blocking the control loop
+    TransformCache mapToOdomCache;
+
+    // Where the camera sits on the chassis, to place targets it sees
+    TransformCache cameraToBaseCache;
+
+    // The map to odom transform is reported as stale when older than this
+    float maxTransformAge; // seconds
+    bool transformStale;
+
+    // Serialises the control stage when controlQueue is serviced by more
+    // than one thread
+    ros::CallbackQueue* controlQueue;
+    boost::mutex controlMutex;
+
+    LatestValue<PoseInput> odometryMailbox;
+    LatestValue<PoseInput> mapMailbox;
+    LatestValue<ObstacleInput> obstacleMailbox;
+    LatestValue<ModeInput> modeMailbox;
+    LatestValue<JoystickInput> joystickMailbox;
+    LatestValue<SonarInput> sonarMailboxes[SONAR_COUNT];
+    LatestMessage<apriltags_ros::AprilTagDetectionArray> targetMailbox;
+
+    // What the control stage has already consumed from the mailboxes
+    unsigned int odometryVersion;
+    unsigned int mapVersion;
+    unsigned int obstacleVersion;
+    unsigned int modeVersion;
+    unsigned int joystickVersion;
+    unsigned int sonarVersions[SONAR_COUNT];
+    apriltags_ros::AprilTagDetectionArray::ConstPtr lastTargets;
+
+    // Set while a wakeup of the control stage is queued so bursts of events
+    // only queue one
+    std::atomic<bool> controlWakeupPending;
+
+    // How long each pass through the state machine takes, and the latency
+    // from a message arriving to the control stage acting on it. A warning is
+    // logged whenever one of these budgets is exceeded.
+    LatencyHistogram controlTickLatency;
+    LatencyHistogram obstacleLatency;
+    LatencyHistogram modeLatency;
+    LatencyHistogram joystickLatency;
+    LatencyHistogram occupancyGridLatency;
+    float controlTickBudget; // seconds
+    float obstacleLatencyBudget; // seconds
+    float modeLatencyBudget; // seconds
+    float joystickLatencyBudget; // seconds
+    float latencyReportInterval; // seconds
+};
+
+#endif /* ROVER_BRAIN_H */
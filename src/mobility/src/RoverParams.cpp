@@ -0,0 +1,62 @@
+#include "RoverParams.h"
+
+// the parameter server name of each field, so load() and set() share one
+// list and a new parameter only needs adding here and in the constructor
+struct RoverParamField {
+  const char* name;
+  double RoverParams::* value;
+};
+
+static const RoverParamField fields[] = {
+  {"search_velocity", &RoverParams::searchVelocity},
+  {"rotate_only_angle_tolerance", &RoverParams::rotateOnlyAngleTolerance},
+  {"return_to_search_delay", &RoverParams::returnToSearchDelay},
+  {"target_distance", &RoverParams::targetDistance},
+  {"center_search_velocity", &RoverParams::centerSearchVelocity},
+  {"centering_turn", &RoverParams::centeringTurn},
+  {"seen_enough_center_tags", &RoverParams::seenEnoughCenterTags},
+  {"collection_point_visual_distance", &RoverParams::collectionPointVisualDistance},
+  {"spin_size", &RoverParams::spinSize},
+  {"spin_size_increment", &RoverParams::spinSizeIncrement}
+};
+
+static const int fieldCount = sizeof(fields) / sizeof(fields[0]);
+
+RoverParams::RoverParams() {
+  searchVelocity = 0.2;
+  rotateOnlyAngleTolerance = 0.4;
+  returnToSearchDelay = 5;
+
+  targetDistance = 0.25;
+
+  centerSearchVelocity = 0.15;
+  centeringTurn = 0.15;
+  seenEnoughCenterTags = 10;
+  collectionPointVisualDistance = 0.5;
+  spinSize = 0.10;
+  spinSizeIncrement = 0.10;
+}
+
+void RoverParams::load(const ros::NodeHandle& node) {
+  for (int i = 0; i < fieldCount; i++) {
+    node.param(fields[i].name, this->*fields[i].value, this->*fields[i].value);
+  }
+}
+
+bool RoverParams::set(const std::string& name, double value) {
+  for (int i = 0; i < fieldCount; i++) {
+    if (name == fields[i].name) {
+      this->*fields[i].value = value;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RoverParams::getNames(std::vector<std::string>& names) {
+  names.clear();
+  for (int i = 0; i < fieldCount; i++) {
+    names.push_back(fields[i].name);
+  }
+}
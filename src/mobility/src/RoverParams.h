@@ -0,0 +1,49 @@
+#ifndef ROVER_PARAMS_H
+#define ROVER_PARAMS_H
+
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+/**
+ * The tunable constants of the mobility behaviour, gathered from RoverBrain,
+ * PickUpController and DropOffController so they can be set without
+ * rebuilding. The defaults are the values the code was tuned with.
+ *
+ * On a rover they come from the mobility group of launch/rover_params.yaml,
+ * which swarmie.launch loads under the rover's name, so load() reads
+ * /<rover>/mobility/search_velocity and so on. mobility_sim takes the same
+ * names on its command line, which is how param_sweep.py sweeps them.
+ */
+struct RoverParams {
+  RoverParams();
+
+  // RoverBrain
+  double searchVelocity;            // m/s, driving to a search goal
+  double rotateOnlyAngleTolerance;  // radians off the goal heading before turning on the spot
+  double returnToSearchDelay;       // s after a drop off or a lost target before searching again
+
+  // PickUpController
+  double targetDistance;            // m from the cube at which the final approach starts
+
+  // DropOffController
+  double centerSearchVelocity;      // m/s, driving in over the collection disk
+  double centeringTurn;             // radians, turn towards the side of the disk in view
+  double seenEnoughCenterTags;      // tags in one frame that mean the rover is heading onto the disk
+  double collectionPointVisualDistance; // m from the disk center it should be in view
+  double spinSize;                  // m, radius of the first loop of the spiral search for the disk
+  double spinSizeIncrement;         // m added to the spiral's radius each loop
+
+  // reads every parameter set under node, keeping the default for the rest
+  void load(const ros::NodeHandle& node);
+
+  // sets one parameter by its parameter server name, false if there is no
+  // such parameter
+  bool set(const std::string& name, double value);
+
+  // the parameter server names, in the order they are listed above
+  static void getNames(std::vector<std::string>& names);
+};
+
+#endif /* ROVER_PARAMS_H */
@@ -1,17 +1,78 @@
 #include "SearchController.h"
 
+#include <angles/angles.h>
+
+// candidate goals the coverage search compares, every 22.5 degrees at each
+// of these distances
+static const int coverageHeadings = 16;
+static const double coverageDistances[] = {1.0, 2.0};
+static const int coverageDistanceCount = sizeof(coverageDistances) / sizeof(coverageDistances[0]);
+
+// meters of driving a radian of turning is worth when comparing goals
+static const double coverageTurnCost = 0.5;
+
+// farthest a single goal toward a distant uncovered cell is placed
+static const double coverageMaxStep = 3.0;
+
+// remembered targets within this distance of each other are gone after as one
+static const double rememberedClusterRadius = 0.75;
+
+// a search goal reached this close to a remembered group of targets without
+// seeing any of them means they are not there anymore
+static const double rememberedArrivalDistance = 0.5;
+
+// goals placed at the same group before giving up on it, for groups that
+// obstacles keep the rover from reaching
+static const int maxRememberedAttempts = 4;
+
 SearchController::SearchController() {
   rng = new random_numbers::RandomNumberGenerator();
+  occupancyGrid = NULL;
+  coverageMap = NULL;
+  targetMemory = NULL;
+  mode = RANDOM_WALK;
+
+  seekingRememberedTarget = false;
+  rememberedTargetAttempts = 0;
+}
+
+void SearchController::setSeed(unsigned int seed) {
+  delete rng;
+  rng = new random_numbers::RandomNumberGenerator(seed);
+}
+
+geometry_msgs::Pose2D SearchController::search(geometry_msgs::Pose2D currentLocation) {
+  geometry_msgs::Pose2D goalLocation;
+  if (rememberedTargetGoal(currentLocation, goalLocation)) {
+    return goalLocation;
+  }
+
+  if (mode == COVERAGE && coverageMap != NULL) {
+    return coverageSearch(currentLocation);
+  }
+
+  return randomWalk(currentLocation);
 }
 
 /**
  * This code implements a basic random walk search.
  */
-geometry_msgs::Pose2D SearchController::search(geometry_msgs::Pose2D currentLocation) {
+geometry_msgs::Pose2D SearchController::randomWalk(geometry_msgs::Pose2D currentLocation) {
   geometry_msgs::Pose2D goalLocation;
 
-  //select new heading from Gaussian distribution around current heading
-  goalLocation.theta = rng->gaussian(currentLocation.theta, 0.25);
+  //select new heading from Gaussian distribution around current heading,
+  //widening the spread while the occupancy grid remembers an obstacle
+  //within a meter along the chosen heading
+  double spread = 0.25;
+  for (int attempt = 0; attempt < 5; attempt++) {
+    goalLocation.theta = rng->gaussian(currentLocation.theta, spread);
+
+    if (isPathClear(currentLocation, currentLocation.x + cos(goalLocation.theta), currentLocation.y + sin(goalLocation.theta))) {
+      break;
+    }
+
+    spread *= 2;
+  }
 
   //select new position 50 cm from current location
   goalLocation.x = currentLocation.x + (0.5 * cos(goalLocation.theta));
@@ -20,6 +81,99 @@ geometry_msgs::Pose2D SearchController::search(geometry_msgs::Pose2D currentLoca
   return goalLocation;
 }
 
+/**
+ * Picks the nearby goal that sweeps the camera over the most ground it has not
+ * seen yet per meter driven, counting turning as driving. Once everything
+ * nearby has been seen it heads for the closest unseen cell, and once the
+ * whole map has been seen it starts a new pass.
+ */
+geometry_msgs::Pose2D SearchController::coverageSearch(geometry_msgs::Pose2D currentLocation) {
+  geometry_msgs::Pose2D goalLocation;
+  double bestScore = 0;
+
+  for (int i = 0; i < coverageHeadings; i++) {
+    double turn = angles::normalize_angle(2 * M_PI * i / coverageHeadings);
+    double theta = currentLocation.theta + turn;
+
+    for (int j = 0; j < coverageDistanceCount; j++) {
+      double distance = coverageDistances[j];
+      double x = currentLocation.x + distance * cos(theta);
+      double y = currentLocation.y + distance * sin(theta);
+
+      if (!coverageMap->contains(x, y) || !isPathClear(currentLocation, x, y)) continue;
+
+      double score = coverageMap->uncoveredAlong(currentLocation.x, currentLocation.y, x, y) / (distance + coverageTurnCost * fabs(turn));
+      if (score > bestScore) {
+        bestScore = score;
+        goalLocation.x = x;
+        goalLocation.y = y;
+        goalLocation.theta = theta;
+      }
+    }
+  }
+
+  if (bestScore > 0) return goalLocation;
+
+  double uncoveredX, uncoveredY;
+  if (!coverageMap->nearestUncovered(currentLocation.x, currentLocation.y, uncoveredX, uncoveredY)) {
+    coverageMap->reset();
+    return randomWalk(currentLocation);
+  }
+
+  double distance = hypot(uncoveredX - currentLocation.x, uncoveredY - currentLocation.y);
+  double step = distance < coverageMaxStep ? distance : coverageMaxStep;
+
+  goalLocation.theta = atan2(uncoveredY - currentLocation.y, uncoveredX - currentLocation.x);
+  goalLocation.x = currentLocation.x + step * cos(goalLocation.theta);
+  goalLocation.y = currentLocation.y + step * sin(goalLocation.theta);
+
+  return goalLocation;
+}
+
+/**
+ * Sends the rover straight to the closest group of targets it saw earlier but
+ * could not pick up. search() is only called once a goal has been reached
+ * without a target in view, so reaching a remembered group means it is gone.
+ */
+bool SearchController::rememberedTargetGoal(geometry_msgs::Pose2D currentLocation, geometry_msgs::Pose2D& goalLocation) {
+  if (targetMemory == NULL) return false;
+
+  if (seekingRememberedTarget) {
+    double distance = hypot(rememberedTarget.x - currentLocation.x, rememberedTarget.y - currentLocation.y);
+
+    if (distance < rememberedArrivalDistance || rememberedTargetAttempts >= maxRememberedAttempts) {
+      targetMemory->forgetNear(rememberedTarget.x, rememberedTarget.y, rememberedClusterRadius);
+      seekingRememberedTarget = false;
+    }
+  }
+
+  double clusterX, clusterY;
+  int clusterSize;
+  if (!targetMemory->nearestCluster(currentLocation.x, currentLocation.y, rememberedClusterRadius, clusterX, clusterY, clusterSize)) {
+    seekingRememberedTarget = false;
+    return false;
+  }
+
+  // a new group, or the same one again after an interruption
+  if (!seekingRememberedTarget || hypot(clusterX - rememberedTarget.x, clusterY - rememberedTarget.y) > rememberedClusterRadius) {
+    rememberedTargetAttempts = 0;
+  }
+
+  seekingRememberedTarget = true;
+  rememberedTarget.x = clusterX;
+  rememberedTarget.y = clusterY;
+  rememberedTargetAttempts++;
+
+  goalLocation.theta = atan2(clusterY - currentLocation.y, clusterX - currentLocation.x);
+  goalLocation.x = clusterX;
+  goalLocation.y = clusterY;
+  return true;
+}
+
+bool SearchController::isPathClear(geometry_msgs::Pose2D from, double x, double y) {
+  return occupancyGrid == NULL || occupancyGrid->isSegmentClear(from.x, from.y, x, y);
+}
+
 /**
  * Continues search pattern after interruption. For example, avoiding the
  * center or collisions.
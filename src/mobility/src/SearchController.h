@@ -4,6 +4,10 @@
 #include <geometry_msgs/Pose2D.h>
 #include <random_numbers/random_numbers.h>
 
+#include "OccupancyGrid.h"
+#include "CoverageMap.h"
+#include "TargetMemory.h"
+
 /**
  * This class implements the search control algorithm for the rovers. The code
  * here should be modified and enhanced to improve search performance.
@@ -12,17 +16,62 @@ class SearchController {
 
   public:
 
+    enum Mode {
+      RANDOM_WALK, // Gaussian random walk around the current heading
+      COVERAGE     // drive where the most unseen ground is per meter
+    };
+
     SearchController();
 
+    // restarts the random walk's random numbers from seed, so a simulated
+    // run can be repeated exactly
+    void setSeed(unsigned int seed);
+
     // performs search pattern
     geometry_msgs::Pose2D search(geometry_msgs::Pose2D currentLocation);
 
     // continues search pattern after interruption
     geometry_msgs::Pose2D continueInterruptedSearch(geometry_msgs::Pose2D currentLocation, geometry_msgs::Pose2D oldGoalLocation);
 
+    // obstacles to steer the search away from, may be NULL
+    void setOccupancyGrid(OccupancyGrid* grid) {occupancyGrid = grid;}
+
+    // where the camera has already looked, COVERAGE falls back to the random
+    // walk without one
+    void setCoverageMap(CoverageMap* map) {coverageMap = map;}
+
+    // targets seen but not picked up, search() heads for the nearest group of
+    // them before searching any further, may be NULL
+    void setTargetMemory(TargetMemory* memory) {targetMemory = memory;}
+
+    // a target was picked up, the next goal at a remembered group starts a
+    // fresh count of attempts
+    void targetPickedUp() {seekingRememberedTarget = false;}
+
+    void setMode(Mode mode) {this->mode = mode;}
+    Mode getMode() {return mode;}
+
   private:
 
+    geometry_msgs::Pose2D randomWalk(geometry_msgs::Pose2D currentLocation);
+    geometry_msgs::Pose2D coverageSearch(geometry_msgs::Pose2D currentLocation);
+
+    bool isPathClear(geometry_msgs::Pose2D from, double x, double y);
+
+    // goal at the nearest remembered group of targets, false if none is left
+    bool rememberedTargetGoal(geometry_msgs::Pose2D currentLocation, geometry_msgs::Pose2D& goalLocation);
+
     random_numbers::RandomNumberGenerator* rng;
+    OccupancyGrid* occupancyGrid;
+    CoverageMap* coverageMap;
+    TargetMemory* targetMemory;
+    Mode mode;
+
+    // the remembered group of targets the last goal was placed at, and how
+    // many goals in a row have been
+    bool seekingRememberedTarget;
+    geometry_msgs::Pose2D rememberedTarget;
+    int rememberedTargetAttempts;
 };
 
 #endif /* SEARCH_CONTROLLER */
@@ -0,0 +1,186 @@
+#include "SwarmMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+static void putVarint(uint32_t value, std::vector<uint8_t>& out) {
+  while (value >= 0x80) {
+    out.push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(value);
+}
+
+static bool getVarint(const std::vector<uint8_t>& data, size_t& position, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 32 && position < data.size(); shift += 7) {
+    uint8_t byte = data[position++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+SwarmMap::SwarmMap(double halfSize, double resolution) :
+  covered(halfSize, resolution),
+  targetsSeen(halfSize, resolution),
+  targetsCollected(halfSize, resolution) {
+  sequence = 0;
+}
+
+void SwarmMap::markFootprint(double x, double y, double theta) {
+  covered.markFootprint(x, y, theta, &pendingCovered);
+}
+
+void SwarmMap::addTargetSeen(double x, double y) {
+  addCell(targetsSeen, pendingSeen, x, y);
+}
+
+void SwarmMap::addTargetCollected(double x, double y) {
+  addCell(targetsCollected, pendingCollected, x, y);
+}
+
+bool SwarmMap::buildMessage(mobility::SwarmMapDelta& message, bool full) {
+  CoverageMap* sets[3] = {&covered, &targetsSeen, &targetsCollected};
+  std::vector<int>* pending[3] = {&pendingCovered, &pendingSeen, &pendingCollected};
+  std::vector<uint8_t>* lists[3] = {&message.covered, &message.targets_seen, &message.targets_collected};
+
+  bool empty = true;
+  for (int i = 0; i < 3; i++) {
+    std::vector<int>& cells = full ? allCells : *pending[i];
+    if (full) {
+      allCells.clear();
+      for (int index = 0; index < (int)sets[i]->getCellCount(); index++) {
+        if (sets[i]->isCellCovered(index)) allCells.push_back(index);
+      }
+    }
+
+    lists[i]->clear();
+    encodeCells(cells, *lists[i]);
+    if (!cells.empty()) empty = false;
+
+    // cleared rather than swapped out so it keeps its capacity
+    pending[i]->clear();
+  }
+
+  if (empty) return false;
+
+  message.sequence = sequence++;
+  message.full = full;
+  message.resolution = covered.getResolution();
+  message.cells_per_side = covered.getCellsPerSide();
+  return true;
+}
+
+bool SwarmMap::merge(const mobility::SwarmMapDelta& message, std::vector<int>* newlyCovered) {
+  if (message.cells_per_side != covered.getCellsPerSide() || fabs(message.resolution - covered.getResolution()) > 1e-6) {
+    return false;
+  }
+
+  // decode everything before changing anything so a bad message has no effect
+  int cellCount = covered.getCellCount();
+  coveredCells.clear();
+  seenCells.clear();
+  collectedCells.clear();
+  if (!decodeCells(message.covered, cellCount, coveredCells) ||
+      !decodeCells(message.targets_seen, cellCount, seenCells) ||
+      !decodeCells(message.targets_collected, cellCount, collectedCells)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < coveredCells.size(); i++) {
+    if (covered.markCell(coveredCells[i]) && newlyCovered != NULL) {
+      newlyCovered->push_back(coveredCells[i]);
+    }
+  }
+
+  addAll(targetsSeen, seenCells);
+  addAll(targetsCollected, collectedCells);
+  return true;
+}
+
+void SwarmMap::getUncollectedTargets(std::vector<geometry_msgs::Pose2D>& targets) {
+  targets.clear();
+
+  for (int index = 0; index < (int)targetsSeen.getCellCount(); index++) {
+    if (!targetsSeen.isCellCovered(index) || isCollected(index)) continue;
+
+    geometry_msgs::Pose2D target;
+    targetsSeen.getCellCenter(index, target.x, target.y);
+    target.theta = 0;
+    targets.push_back(target);
+  }
+}
+
+void SwarmMap::encodeCells(std::vector<int>& cells, std::vector<uint8_t>& out) {
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  int previousEnd = 0;
+  size_t i = 0;
+  while (i < cells.size()) {
+    int start = cells[i];
+    int length = 1;
+    while (i + length < cells.size() && cells[i + length] == start + length) {
+      length++;
+    }
+
+    putVarint(start - previousEnd, out);
+    putVarint(length, out);
+
+    previousEnd = start + length;
+    i += length;
+  }
+}
+
+bool SwarmMap::decodeCells(const std::vector<uint8_t>& data, int cellCount, std::vector<int>& cells) {
+  size_t position = 0;
+  uint32_t next = 0;
+
+  while (position < data.size()) {
+    uint32_t gap, length;
+    if (!getVarint(data, position, gap) || !getVarint(data, position, length)) return false;
+
+    // runs are stored in order and never run past the end of the grid
+    if (gap > (uint32_t)cellCount || length > (uint32_t)cellCount) return false;
+    uint32_t start = next + gap;
+    if (start + length > (uint32_t)cellCount) return false;
+
+    for (uint32_t cell = start; cell < start + length; cell++) {
+      cells.push_back(cell);
+    }
+    next = start + length;
+  }
+
+  return true;
+}
+
+void SwarmMap::addCell(CoverageMap& set, std::vector<int>& pending, double x, double y) {
+  int index = set.cellIndex(x, y);
+  if (index >= 0 && set.markCell(index)) {
+    pending.push_back(index);
+  }
+}
+
+void SwarmMap::addAll(CoverageMap& set, std::vector<int>& cells) {
+  for (size_t i = 0; i < cells.size(); i++) {
+    set.markCell(cells[i]);
+  }
+}
+
+bool SwarmMap::isCollected(int index) {
+  int side = targetsCollected.getCellsPerSide();
+  int cellX = index % side;
+  int cellY = index / side;
+
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      int x = cellX + dx;
+      int y = cellY + dy;
+      if (x < 0 || x >= side || y < 0 || y >= side) continue;
+      if (targetsCollected.isCellCovered(y * side + x)) return true;
+    }
+  }
+
+  return false;
+}
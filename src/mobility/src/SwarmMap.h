@@ -0,0 +1,87 @@
+#ifndef SWARM_MAP_H
+#define SWARM_MAP_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <geometry_msgs/Pose2D.h>
+#include <mobility/SwarmMapDelta.h>
+
+#include "CoverageMap.h"
+
+/**
+ * What the whole swarm knows about the arena, in the map frame: the ground
+ * any rover's camera has covered, where targets were seen, and where targets
+ * were picked up from. Every rover's navsat_transform_node is given the same
+ * datum, the collection disk, so their map frames share an origin and cells
+ * mean the same place to every rover.
+ *
+ * Each of the three is a grow-only set of cells, so merging another rover's
+ * message is a union that can be repeated or reordered freely and every rover
+ * ends up with the same map once it has heard from everyone. A rover
+ * publishes only the cells that changed since its last message, plus the
+ * whole map now and then for rovers that missed some messages or started
+ * late. Not thread safe.
+ */
+class SwarmMap {
+
+  public:
+
+    SwarmMap(double halfSize = 15, double resolution = 0.25);
+
+    // this rover's own observations, in the map frame
+    void markFootprint(double x, double y, double theta);
+    void addTargetSeen(double x, double y);
+    void addTargetCollected(double x, double y);
+
+    // fills message with the changes since the last call, or with the whole
+    // map if full is set, returns false if there is nothing to send
+    bool buildMessage(mobility::SwarmMapDelta& message, bool full);
+
+    // merges another rover's message, appending the cells it covered that
+    // were not covered here yet to newlyCovered if it is given. Returns false
+    // and changes nothing if the message is malformed or uses another grid.
+    bool merge(const mobility::SwarmMapDelta& message, std::vector<int>* newlyCovered = NULL);
+
+    // targets seen but not picked up since, cell centers in the map frame
+    void getUncollectedTargets(std::vector<geometry_msgs::Pose2D>& targets);
+
+    void getCellCenter(int index, double& x, double& y) {covered.getCellCenter(index, x, y);}
+
+    unsigned int getCoveredCount() {return covered.getCoveredCount();}
+    double getCellArea() {return covered.getCellArea();}
+
+    // run length varint encoding of a sorted list of cells, see SwarmMapDelta.msg
+    static void encodeCells(std::vector<int>& cells, std::vector<uint8_t>& out);
+    static bool decodeCells(const std::vector<uint8_t>& data, int cellCount, std::vector<int>& cells);
+
+  private:
+
+    void addCell(CoverageMap& set, std::vector<int>& pending, double x, double y);
+    void addAll(CoverageMap& set, std::vector<int>& cells);
+
+    // a target counts as picked up if one was picked up from its cell or
+    // from a neighbouring one
+    bool isCollected(int index);
+
+    // the sets reuse CoverageMap as a bitset over the same grid
+    CoverageMap covered;
+    CoverageMap targetsSeen;
+    CoverageMap targetsCollected;
+
+    // cells this rover added since its last message
+    std::vector<int> pendingCovered;
+    std::vector<int> pendingSeen;
+    std::vector<int> pendingCollected;
+
+    // decoded cells and full map listings, kept so merging and publishing
+    // reuse their storage
+    std::vector<int> coveredCells;
+    std::vector<int> seenCells;
+    std::vector<int> collectedCells;
+    std::vector<int> allCells;
+
+    uint32_t sequence;
+};
+
+#endif /* SWARM_MAP_H */
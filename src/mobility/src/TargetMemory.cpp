@@ -0,0 +1,223 @@
+#include "TargetMemory.h"
+
+#include <algorithm>
+#include <cmath>
+
+// a remembered position is the running mean of its sightings, weighted so
+// that later ones still move it, early sightings are the least accurate as
+// they are made from farthest away
+static const int maxSightingWeight = 10;
+
+TargetMemory::TargetMemory(double cellSize, double mergeDistance, double maxAge) {
+  if (cellSize <= 0) cellSize = 0.5;
+
+  this->cellSize = cellSize;
+  this->mergeDistance = mergeDistance;
+  this->maxAge = maxAge;
+  count = 0;
+  oldestSeen = 0;
+}
+
+void TargetMemory::add(int id, double x, double y, double time) {
+  if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+    ids.push_back(id);
+  }
+
+  // look for a target of the same id close enough to be this one, the cell
+  // holding it may be a neighbour of the one the sighting falls in
+  int cellX = cellCoordinate(x);
+  int cellY = cellCoordinate(y);
+  int reach = (int)ceil(mergeDistance / cellSize);
+
+  for (int dy = -reach; dy <= reach; dy++) {
+    for (int dx = -reach; dx <= reach; dx++) {
+      std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.find(cellKey(id, cellX + dx, cellY + dy));
+      if (cell == cells.end()) continue;
+
+      std::vector<Target>& targets = cell->second;
+      for (size_t i = 0; i < targets.size(); i++) {
+        if (hypot(targets[i].x - x, targets[i].y - y) > mergeDistance) continue;
+
+        Target& target = targets[i];
+        int weight = std::min(target.sightings, maxSightingWeight);
+        target.x = (target.x * weight + x) / (weight + 1);
+        target.y = (target.y * weight + y) / (weight + 1);
+        target.sightings++;
+        target.lastSeen = time;
+
+        // the mean only rarely moves into another cell, moving it then is
+        // the only time a repeat sighting allocates
+        if (cellCoordinate(target.x) != cellX + dx || cellCoordinate(target.y) != cellY + dy) {
+          Target moved = target;
+          targets.erase(targets.begin() + i);
+          if (targets.empty()) cells.erase(cell);
+          count--;
+
+          insert(moved);
+        }
+        return;
+      }
+    }
+  }
+
+  Target target;
+  target.id = id;
+  target.x = x;
+  target.y = y;
+  target.sightings = 1;
+  target.lastSeen = time;
+  insert(target);
+}
+
+int TargetMemory::forgetNear(double x, double y, double radius) {
+  std::vector<int64_t>& keys = nearKeys;
+  cellsNear(x, y, radius, keys);
+
+  int forgotten = 0;
+  for (size_t k = 0; k < keys.size(); k++) {
+    std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.find(keys[k]);
+    if (cell == cells.end()) continue;
+
+    std::vector<Target>& targets = cell->second;
+    for (size_t i = 0; i < targets.size();) {
+      if (hypot(targets[i].x - x, targets[i].y - y) <= radius) {
+        targets.erase(targets.begin() + i);
+        forgotten++;
+      } else {
+        i++;
+      }
+    }
+
+    if (targets.empty()) cells.erase(cell);
+  }
+
+  count -= forgotten;
+  return forgotten;
+}
+
+void TargetMemory::expire(double time) {
+  // called every control tick, but nothing can be due before the oldest
+  // sighting is
+  if (time - oldestSeen <= maxAge) return;
+
+  oldestSeen = time;
+  std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.begin();
+
+  while (cell != cells.end()) {
+    std::vector<Target>& targets = cell->second;
+
+    for (size_t i = 0; i < targets.size();) {
+      if (time - targets[i].lastSeen > maxAge) {
+        targets.erase(targets.begin() + i);
+        count--;
+      } else {
+        oldestSeen = std::min(oldestSeen, targets[i].lastSeen);
+        i++;
+      }
+    }
+
+    if (targets.empty()) {
+      cell = cells.erase(cell);
+    } else {
+      cell++;
+    }
+  }
+}
+
+bool TargetMemory::nearestCluster(double x, double y, double clusterRadius, double& clusterX, double& clusterY, int& clusterSize) {
+  if (count == 0) return false;
+
+  // only a handful of targets are ever remembered, a scan is cheaper than
+  // searching outward ring by ring
+  const Target* nearest = NULL;
+  double nearestDistance = 0;
+
+  for (std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.begin(); cell != cells.end(); cell++) {
+    for (size_t i = 0; i < cell->second.size(); i++) {
+      const Target& target = cell->second[i];
+      double distance = hypot(target.x - x, target.y - y);
+
+      if (nearest == NULL || distance < nearestDistance) {
+        nearest = &target;
+        nearestDistance = distance;
+      }
+    }
+  }
+
+  double centerX = nearest->x;
+  double centerY = nearest->y;
+  double sumX = 0;
+  double sumY = 0;
+  clusterSize = 0;
+
+  std::vector<int64_t>& keys = nearKeys;
+  cellsNear(centerX, centerY, clusterRadius, keys);
+
+  for (size_t k = 0; k < keys.size(); k++) {
+    std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.find(keys[k]);
+    if (cell == cells.end()) continue;
+
+    for (size_t i = 0; i < cell->second.size(); i++) {
+      const Target& target = cell->second[i];
+      if (hypot(target.x - centerX, target.y - centerY) > clusterRadius) continue;
+
+      sumX += target.x;
+      sumY += target.y;
+      clusterSize++;
+    }
+  }
+
+  clusterX = sumX / clusterSize;
+  clusterY = sumY / clusterSize;
+  return true;
+}
+
+void TargetMemory::getTargets(std::vector<Target>& targets) {
+  targets.clear();
+
+  for (std::unordered_map<int64_t, std::vector<Target> >::iterator cell = cells.begin(); cell != cells.end(); cell++) {
+    targets.insert(targets.end(), cell->second.begin(), cell->second.end());
+  }
+}
+
+void TargetMemory::clear() {
+  cells.clear();
+  ids.clear();
+  count = 0;
+  oldestSeen = 0;
+}
+
+// 16 bits of tag id and 24 bits of each cell coordinate, which covers several
+// kilometers at any sensible cell size
+int64_t TargetMemory::cellKey(int id, int cellX, int cellY) {
+  return ((int64_t)(id & 0xFFFF) << 48) |
+         ((int64_t)((cellX + (1 << 23)) & 0xFFFFFF) << 24) |
+         (int64_t)((cellY + (1 << 23)) & 0xFFFFFF);
+}
+
+int TargetMemory::cellCoordinate(double value) {
+  return (int)floor(value / cellSize);
+}
+
+void TargetMemory::insert(const Target& target) {
+  if (count == 0 || target.lastSeen < oldestSeen) oldestSeen = target.lastSeen;
+
+  cells[cellKey(target.id, cellCoordinate(target.x), cellCoordinate(target.y))].push_back(target);
+  count++;
+}
+
+void TargetMemory::cellsNear(double x, double y, double radius, std::vector<int64_t>& keys) {
+  int minX = cellCoordinate(x - radius);
+  int maxX = cellCoordinate(x + radius);
+  int minY = cellCoordinate(y - radius);
+  int maxY = cellCoordinate(y + radius);
+
+  keys.clear();
+  for (size_t i = 0; i < ids.size(); i++) {
+    for (int cellY = minY; cellY <= maxY; cellY++) {
+      for (int cellX = minX; cellX <= maxX; cellX++) {
+        keys.push_back(cellKey(ids[i], cellX, cellY));
+      }
+    }
+  }
+}
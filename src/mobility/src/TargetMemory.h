@@ -0,0 +1,78 @@
+#ifndef TARGET_MEMORY_H
+#define TARGET_MEMORY_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * Remembers targets the rover saw but could not pick up at the time, most
+ * often because it was already carrying one, so it can come back for them.
+ *
+ * Sightings are kept in a hash grid keyed by tag id and cell. A new sighting
+ * within mergeDistance of a remembered target of the same id is folded into it
+ * rather than added, so a target that stays in view for a few seconds is
+ * remembered once. Targets not seen again for maxAge seconds are forgotten.
+ * Positions are in whatever frame the caller feeds in, mobility uses odom.
+ * Not thread safe.
+ */
+class TargetMemory {
+
+  public:
+
+    struct Target {
+      int id;
+      double x;
+      double y;
+      int sightings;
+      double lastSeen; // seconds
+    };
+
+    TargetMemory(double cellSize = 0.5, double mergeDistance = 0.25, double maxAge = 600);
+
+    // records a sighting, time in seconds
+    void add(int id, double x, double y, double time);
+
+    // forgets every target within radius of (x, y), after one was picked up
+    // there or the rover went there and found nothing
+    int forgetNear(double x, double y, double radius);
+
+    // forgets targets last seen more than maxAge seconds before time
+    void expire(double time);
+
+    // finds the remembered target closest to (x, y) and returns the centroid
+    // of the targets within clusterRadius of it, false if nothing is remembered
+    bool nearestCluster(double x, double y, double clusterRadius, double& clusterX, double& clusterY, int& clusterSize);
+
+    void getTargets(std::vector<Target>& targets);
+
+    int size() {return count;}
+    void clear();
+
+  private:
+
+    int64_t cellKey(int id, int cellX, int cellY);
+    int cellCoordinate(double value);
+
+    void insert(const Target& target);
+
+    // keys of every cell, for every tag id, within radius of (x, y)
+    void cellsNear(double x, double y, double radius, std::vector<int64_t>& keys);
+
+    double cellSize;
+    double mergeDistance;
+    double maxAge;
+    int count;
+    double oldestSeen; // no remembered target was last seen before this
+
+    // tag ids seen so far, so neighbourhood queries can look up every id
+    std::vector<int> ids;
+
+    std::unordered_map<int64_t, std::vector<Target> > cells;
+
+    // reused by every neighbourhood query, so the cluster lookup in a
+    // control tick stops allocating once it has grown
+    std::vector<int64_t> nearKeys;
+};
+
+#endif /* TARGET_MEMORY_H */
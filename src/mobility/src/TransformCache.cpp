@@ -0,0 +1,91 @@
+#include "TransformCache.h"
+
+TransformCache::TransformCache(tf::TransformListener* listener, std::string targetFrame, std::string sourceFrame, double updateRate) {
+  this->listener = listener;
+  this->targetFrame = targetFrame;
+  this->sourceFrame = sourceFrame;
+  sourceFrameVersion = 0;
+  this->updateRate = updateRate;
+}
+
+void TransformCache::start(ros::NodeHandle& nodeHandle) {
+  if (updateTimer) return;
+
+  updateTimer = nodeHandle.createTimer(ros::Duration(1.0 / updateRate), &TransformCache::updateTimerEventHandler, this);
+}
+
+void TransformCache::stop() {
+  updateTimer.stop();
+}
+
+bool TransformCache::getTransform(tf::Transform& transform, ros::Duration& age) {
+  Sample sample;
+
+  if (latest.read(sample) == 0) return false;
+  if (sample.frameVersion != sourceFrameVersion.load(std::memory_order_acquire)) return false;
+
+  transform.setOrigin(tf::Vector3(sample.x, sample.y, sample.z));
+  transform.setRotation(tf::Quaternion(sample.qx, sample.qy, sample.qz, sample.qw));
+  age = ros::Time::now() - sample.stamp;
+
+  return true;
+}
+
+void TransformCache::setSourceFrame(const std::string& frame) {
+  boost::mutex::scoped_lock lock(frameMutex);
+  if (frame == sourceFrame) return;
+
+  sourceFrame = frame;
+  sourceFrameVersion.fetch_add(1, std::memory_order_release);
+}
+
+std::string TransformCache::getSourceFrame() {
+  boost::mutex::scoped_lock lock(frameMutex);
+  return sourceFrame;
+}
+
+void TransformCache::updateTimerEventHandler(const ros::TimerEvent&) {
+  update();
+}
+
+// Runs on a callback queue shared with other work, so it only takes what tf
+// already has rather than waiting for a newer transform.
+void TransformCache::update() {
+  boost::mutex::scoped_try_lock updateLock(updateMutex);
+  if (!updateLock) return;
+
+  tf::StampedTransform stampedTransform;
+  std::string sourceFrame;
+  unsigned int frameVersion;
+  {
+    boost::mutex::scoped_lock lock(frameMutex);
+    sourceFrame = this->sourceFrame;
+    frameVersion = sourceFrameVersion.load(std::memory_order_relaxed);
+  }
+
+  try {
+    // ros::Time(0) asks for the newest transform available
+    listener->lookupTransform(targetFrame, sourceFrame, ros::Time(0), stampedTransform);
+  }
+  catch(tf::TransformException& ex) {
+    ROS_WARN_THROTTLE(5, "Could not look up the transform from \"%s\" to \"%s\": %s", sourceFrame.c_str(), targetFrame.c_str(), ex.what());
+    return;
+  }
+
+  Sample sample;
+  sample.x = stampedTransform.getOrigin().x();
+  sample.y = stampedTransform.getOrigin().y();
+  sample.z = stampedTransform.getOrigin().z();
+  sample.qx = stampedTransform.getRotation().x();
+  sample.qy = stampedTransform.getRotation().y();
+  sample.qz = stampedTransform.getRotation().z();
+  sample.qw = stampedTransform.getRotation().w();
+  sample.stamp = stampedTransform.stamp_;
+  sample.frameVersion = frameVersion;
+
+  latest.write(sample);
+}
+
+TransformCache::~TransformCache() {
+  stop();
+}
@@ -0,0 +1,81 @@
+#ifndef TRANSFORM_CACHE_H
+#define TRANSFORM_CACHE_H
+
+#include <atomic>
+#include <string>
+
+#include <boost/thread.hpp>
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+
+#include "LatestValue.h"
+
+/**
+ * Keeps the latest transform between two frames available without blocking.
+ *
+ * A timer looks the newest transform up at a fixed rate and stores the
+ * result; getTransform() only copies the stored value, so the control loop
+ * never waits on tf. The age of the stored transform is returned alongside it
+ * so the caller can decide what to do with stale data.
+ *
+ * The lookup never waits either, so the timer can share a callback queue
+ * with the control stage and a host running many rovers needs no thread
+ * per cache.
+ */
+class TransformCache {
+
+  public:
+
+    // targetFrame and sourceFrame follow tf::TransformListener::lookupTransform()
+    TransformCache(tf::TransformListener* listener, std::string targetFrame, std::string sourceFrame, double updateRate);
+    ~TransformCache();
+
+    // looks the transform up on a timer serviced by nodeHandle's callback queue
+    void start(ros::NodeHandle& nodeHandle);
+    void stop();
+
+    // looks the transform up once, keeping the previous one if tf has none
+    void update();
+
+    // copies the most recent transform, returns false if none has been received yet
+    bool getTransform(tf::Transform& transform, ros::Duration& age);
+
+    // Changes the frame looked up from, for when it is only known once data
+    // stamped with it arrives. Transforms from the old frame are forgotten.
+    void setSourceFrame(const std::string& frame);
+    std::string getSourceFrame();
+
+  private:
+
+    // plain data version of tf::StampedTransform that can be stored in a LatestValue
+    struct Sample {
+      double x;
+      double y;
+      double z;
+      double qx;
+      double qy;
+      double qz;
+      double qw;
+      ros::Time stamp;
+      unsigned int frameVersion; // sourceFrameVersion when it was looked up
+    };
+
+    void updateTimerEventHandler(const ros::TimerEvent&);
+
+    tf::TransformListener* listener;
+    std::string targetFrame;
+    std::string sourceFrame;
+    boost::mutex frameMutex; // guards sourceFrame
+
+    // bumped with every change of sourceFrame, atomic so getTransform() can
+    // check a sample against it without taking frameMutex
+    std::atomic<unsigned int> sourceFrameVersion;
+    double updateRate;
+
+    LatestValue<Sample> latest;
+
+    ros::Timer updateTimer;
+    boost::mutex updateMutex; // keeps to one writer if updates overlap
+};
+
+#endif /* TRANSFORM_CACHE_H */
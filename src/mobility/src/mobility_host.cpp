@@ -0,0 +1,129 @@
+#include <ros/ros.h>
+
+// ROS libraries
+#include <ros/callback_queue.h>
+#include <tf/transform_listener.h>
+
+#include <boost/thread/thread.hpp>
+
+#include "RoverBrain.h"
+
+// To handle shutdown signals so the node quits
+// properly in response to "rosnode kill"
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fstream>
+#include <vector>
+
+/*
+ * Runs the mobility behaviour of several rovers in one process. Each rover
+ * named on the command line gets its own RoverBrain; all of them share one
+ * node, one tf listener and two thread pools, one for the sensor callbacks
+ * and one for the control stage. This avoids paying for a process, a set of
+ * ROS connections and a tf buffer per rover in large simulated swarms.
+ *
+ * usage: rosrun mobility mobility_host achilles aeneas ajax ... [_threads:=N]
+ */
+
+using namespace std;
+
+vector<RoverBrain*> brains;
+ros::CallbackQueue controlQueue;
+
+// cpu time used by the process at the last resource report
+double previousCpuTime = 0;
+ros::WallTime previousReportTime;
+float resourceReportInterval = 60; // seconds
+
+// OS Signal Handler
+void sigintEventHandler(int signal);
+
+void resourceReportTimerEventHandler(const ros::WallTimerEvent& event);
+
+int main(int argc, char **argv) {
+
+    // NoSignalHandler so we can catch SIGINT ourselves and shutdown the node
+    ros::init(argc, argv, "MOBILITY_HOST", ros::init_options::NoSigintHandler);
+    ros::NodeHandle mNH;
+    ros::NodeHandle param("~");
+
+    // Register the SIGINT event handler so the node can shutdown properly
+    signal(SIGINT, sigintEventHandler);
+
+    // ros::init strips the remapping arguments so only rover names are left
+    if (argc < 2) {
+        cout << "Usage: mobility_host <rover name> [<rover name> ...]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    int threads;
+    param.param("threads", threads, (int)boost::thread::hardware_concurrency());
+    if (threads < 1) threads = 1;
+
+    // state machine ticks per second, abridge's ~control_rate should match
+    float loopRate;
+    param.param("loop_rate", loopRate, 10.0f);
+
+    // "random" walk or "coverage" planner, for every rover
+    string searchMode;
+    param.param("search_mode", searchMode, string("random"));
+
+    tf::TransformListener tfListener;
+
+    for (int i = 1; i < argc; i++) {
+        brains.push_back(new RoverBrain(argv[i], mNH, &controlQueue, &tfListener, loopRate));
+        brains.back()->setSearchMode(searchMode);
+
+        // tuning constants from launch/rover_params.yaml, see RoverParams.h
+        RoverParams params;
+        params.load(ros::NodeHandle(string(argv[i]) + "/mobility"));
+        brains.back()->setParams(params);
+    }
+
+    cout << "Mobility host started " << brains.size() << " rovers on " << threads << " threads." << endl;
+
+    ros::WallTimer resourceReportTimer = mNH.createWallTimer(ros::WallDuration(resourceReportInterval), resourceReportTimerEventHandler);
+    previousReportTime = ros::WallTime::now();
+
+    ros::AsyncSpinner sensorSpinner(threads);
+    ros::AsyncSpinner controlSpinner(threads, &controlQueue);
+    sensorSpinner.start();
+    controlSpinner.start();
+
+    ros::waitForShutdown();
+
+    for (int i = 0; i < brains.size(); i++) {
+        brains[i]->stop();
+        delete brains[i];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Logs the memory and cpu used by the whole process so the cost per rover
+// can be compared with running one mobility process per rover
+void resourceReportTimerEventHandler(const ros::WallTimerEvent& event) {
+    long pages = 0;
+    long residentPages = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> residentPages;
+    double residentMB = residentPages * (double)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpuTime = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    ros::WallTime now = ros::WallTime::now();
+    double cpuPercent = 100 * (cpuTime - previousCpuTime) / (now - previousReportTime).toSec();
+    previousCpuTime = cpuTime;
+    previousReportTime = now;
+
+    ROS_INFO("Mobility host: %lu rovers, RSS %.1f MB (%.2f MB per rover), CPU %.1f%% (%.2f%% per rover)",
+             brains.size(), residentMB, residentMB / brains.size(), cpuPercent, cpuPercent / brains.size());
+}
+
+void sigintEventHandler(int sig) {
+    // All the default sigint handler does is call shutdown()
+    ros::shutdown();
+}
@@ -0,0 +1,252 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <ros/ros.h>
+
+#include "KinematicSim.h"
+
+/*
+ * Runs many rounds of the mobility behaviour in KinematicSim, spread over
+ * worker processes, and prints one CSV line per round on stdout and a summary
+ * on stderr. Round n uses seed + n, so the output only depends on the
+ * arguments, not on how many workers ran it.
+ *
+ * No ROS master is needed, this is a plain executable.
+ *
+ * usage: rosrun mobility mobility_sim [--world <file>] [--final] [--rovers N]
+ *          [--minutes M] [--rounds N] [--seed S] [--search random|coverage]
+ *          [--no-target-memory] [--no-swarm-map] [--jobs J]
+ *          [--param name=value ...]
+ *
+ * --param sets one of the RoverParams by its parameter server name, for
+ * example --param search_velocity=0.25, and may be repeated.
+ * --no-target-memory leaves the search to forget the cubes a rover saw while
+ * it was carrying one, as mobility did before it remembered them.
+ * --no-swarm-map keeps each rover to its own coverage, with no /swarmMap.
+ *
+ * swarm_bytes_per_second is the /swarmMap traffic through each rover's
+ * wireless interface, sent and received, in the bytes per second that
+ * WirelessDiags reports as bandwidth used.
+ */
+
+using namespace std;
+
+struct Options {
+  KinematicSim::Config config;
+  int rounds;
+  int jobs;
+  string search;
+};
+
+// One worker, runs rounds first, first + step, ... and writes their CSV lines
+// to fd
+void runWorker(const Options& options, int first, int step, int fd);
+
+bool parseOptions(int argc, char** argv, Options& options);
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        cerr << "Usage: mobility_sim [--world <file>] [--final] [--rovers N] [--minutes M] [--rounds N] [--seed S] [--search random|coverage] [--no-target-memory] [--no-swarm-map] [--jobs J] [--param name=value ...]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    int jobs = min(options.jobs, options.rounds);
+    ros::WallTime start = ros::WallTime::now();
+
+    vector<pid_t> workers;
+    vector<FILE*> outputs;
+
+    for (int i = 0; i < jobs; i++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            cerr << "mobility_sim: pipe failed: " << strerror(errno) << endl;
+            return EXIT_FAILURE;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "mobility_sim: fork failed: " << strerror(errno) << endl;
+            return EXIT_FAILURE;
+        }
+
+        if (pid == 0) {
+            close(fds[0]);
+            runWorker(options, i, jobs, fds[1]);
+            close(fds[1]);
+            _exit(EXIT_SUCCESS);
+        }
+
+        close(fds[1]);
+        workers.push_back(pid);
+        outputs.push_back(fdopen(fds[0], "r"));
+    }
+
+    // round n comes from worker n % jobs as its (n / jobs)th line
+    vector<vector<string> > lines(jobs);
+    for (int i = 0; i < jobs; i++) {
+        char buffer[512];
+        while (fgets(buffer, sizeof(buffer), outputs[i]) != NULL) {
+            lines[i].push_back(buffer);
+        }
+        fclose(outputs[i]);
+    }
+
+    bool failed = false;
+    for (size_t i = 0; i < workers.size(); i++) {
+        int status;
+        waitpid(workers[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+    }
+
+    cout << "round,seed,rovers,arena_size,search,minutes,collected,first_collection,last_collection,distance_driven,area_covered,swarm_bytes_per_second" << endl;
+
+    vector<double> collected;
+    double swarmBytesPerSecond = 0;
+    for (int round = 0; round < options.rounds; round++) {
+        int worker = round % jobs;
+        size_t line = round / jobs;
+        if (line >= lines[worker].size()) {
+            failed = true;
+            continue;
+        }
+
+        cout << lines[worker][line];
+
+        // the collected count is the seventh column
+        stringstream fields(lines[worker][line]);
+        string field;
+        for (int column = 0; column < 7; column++) getline(fields, field, ',');
+        collected.push_back(atof(field.c_str()));
+
+        // and the swarm map traffic the twelfth
+        for (int column = 7; column < 12; column++) getline(fields, field, ',');
+        swarmBytesPerSecond += atof(field.c_str());
+    }
+
+    if (collected.empty()) return EXIT_FAILURE;
+
+    double mean = 0;
+    for (size_t i = 0; i < collected.size(); i++) mean += collected[i];
+    mean /= collected.size();
+
+    double variance = 0;
+    for (size_t i = 0; i < collected.size(); i++) variance += (collected[i] - mean) * (collected[i] - mean);
+    if (collected.size() > 1) variance /= collected.size() - 1;
+
+    double wallSeconds = (ros::WallTime::now() - start).toSec();
+    double simulatedSeconds = options.config.duration * options.rounds;
+
+    cerr << "mobility_sim: " << options.rounds << " rounds on " << jobs << " workers in " << wallSeconds << " s, "
+         << simulatedSeconds / wallSeconds << "x real time" << endl;
+    cerr << "mobility_sim: collected " << mean << " +/- " << 1.96 * sqrt(variance / collected.size())
+         << " (95% confidence) cubes per round" << endl;
+    cerr << "mobility_sim: " << mean / (options.config.duration / 60) << " cubes per minute, "
+         << swarmBytesPerSecond / collected.size() << " bytes per second of /swarmMap per rover" << endl;
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void runWorker(const Options& options, int first, int step, int fd) {
+    FILE* output = fdopen(fd, "w");
+
+    for (int round = first; round < options.rounds; round += step) {
+        KinematicSim::Config config = options.config;
+        config.seed = options.config.seed + round;
+
+        KinematicSim sim(config);
+        KinematicSim::Result result = sim.run();
+
+        fprintf(output, "%d,%u,%d,%g,%s,%g,%d,%.1f,%.1f,%.1f,%.3f,%.1f\n",
+                round, config.seed, config.rovers, config.arenaSize, options.search.c_str(), config.duration / 60,
+                result.collected, result.firstCollection, result.lastCollection, result.distanceDriven, result.areaCovered,
+                result.swarmBytes / config.rovers / config.duration);
+        fflush(output);
+    }
+
+    fclose(output);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    options.rounds = 1;
+    options.jobs = boost::thread::hardware_concurrency();
+    options.search = "random";
+    if (options.jobs < 1) options.jobs = 1;
+
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+
+        if (option == "--final") {
+            options.config.arenaSize = 23.1;
+            continue;
+        }
+
+        if (option == "--no-target-memory") {
+            options.config.targetMemory = false;
+            continue;
+        }
+
+        if (option == "--no-swarm-map") {
+            options.config.swarmMap = false;
+            continue;
+        }
+
+        if (i + 1 >= argc) return false;
+        string value = argv[++i];
+
+        if (option == "--world") {
+            if (!KinematicSim::loadWorldTargets(value, options.config.targets)) {
+                cerr << "mobility_sim: no cubes found in " << value << endl;
+                return false;
+            }
+        } else if (option == "--rovers") {
+            options.config.rovers = atoi(value.c_str());
+        } else if (option == "--minutes") {
+            options.config.duration = 60 * atof(value.c_str());
+        } else if (option == "--rounds") {
+            options.rounds = atoi(value.c_str());
+        } else if (option == "--seed") {
+            options.config.seed = strtoul(value.c_str(), NULL, 10);
+        } else if (option == "--jobs") {
+            options.jobs = atoi(value.c_str());
+        } else if (option == "--search") {
+            if (value == "random") {
+                options.config.searchMode = SearchController::RANDOM_WALK;
+            } else if (value == "coverage") {
+                options.config.searchMode = SearchController::COVERAGE;
+            } else {
+                return false;
+            }
+            options.search = value;
+        } else if (option == "--param") {
+            size_t equals = value.find('=');
+            if (equals == string::npos ||
+                !options.config.params.set(value.substr(0, equals), atof(value.c_str() + equals + 1))) {
+                vector<string> names;
+                RoverParams::getNames(names);
+                cerr << "mobility_sim: unknown parameter " << value << ", expected name=value with name one of:";
+                for (size_t j = 0; j < names.size(); j++) cerr << " " << names[j];
+                cerr << endl;
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    // the GUI has start positions for six rovers
+    return options.rounds > 0 && options.jobs > 0 && options.config.duration > 0 &&
+           options.config.rovers >= 1 && options.config.rovers <= 6;
+}
@@ -0,0 +1,108 @@
+/*
+ * Cost of the occupancy grid work in a mobility control tick: recentering
+ * the grid on the rover and drawing a reading from each of the three sonars
+ * as RoverBrain::updateOccupancyGrid() does, and the 1 m segment queries
+ * the search and obstacle avoidance make.
+ *
+ * usage: bench_occupancy_grid [ticks]
+ */
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "OccupancyGrid.h"
+
+namespace {
+
+// as in RoverBrain.cpp
+struct SonarMount {
+  double x;
+  double y;
+  double heading;
+};
+
+const SonarMount sonarMounts[] = {
+  {0.15, 0.07, 0.43633},
+  {0.15, 0.0, 0.0},
+  {0.15, -0.07, -0.43633}
+};
+
+const double sonarHalfAngle = 0.25;
+const int raysPerSonar = 3;
+const double maxRange = 3;
+
+double now() {
+  timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+void updateGrid(OccupancyGrid& grid, double x, double y, double theta, const double* ranges) {
+  grid.recenter(x, y);
+
+  double cosTheta = cos(theta);
+  double sinTheta = sin(theta);
+
+  for (int i = 0; i < 3; i++) {
+    const SonarMount& mount = sonarMounts[i];
+    double sonarX = x + mount.x * cosTheta - mount.y * sinTheta;
+    double sonarY = y + mount.x * sinTheta + mount.y * cosTheta;
+    bool hit = ranges[i] < 0.95 * maxRange;
+
+    for (int ray = 0; ray < raysPerSonar; ray++) {
+      double offset = sonarHalfAngle * (2.0 * ray / (raysPerSonar - 1) - 1);
+      grid.addRay(sonarX, sonarY, theta + mount.heading + offset, ranges[i], hit);
+    }
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  int ticks = argc > 1 ? atoi(argv[1]) : 200000;
+  OccupancyGrid grid(0.1);
+
+  // keeps the compiler from dropping the queries
+  unsigned int clear = 0;
+
+  // driving a circle at 0.5 m/s at 10 Hz, with obstacles near and far
+  double x = 0, y = 0, theta = 0;
+  double updateStart = now();
+  for (int i = 0; i < ticks; i++) {
+    theta = i * 0.01;
+    x = 5 * sin(theta);
+    y = 5 - 5 * cos(theta);
+    double ranges[3] = {maxRange, 0.8 + 0.5 * sin(i * 0.1), 2.5};
+    updateGrid(grid, x, y, theta, ranges);
+  }
+  double updateTime = (now() - updateStart) / ticks;
+
+  // then stopped in front of a block, so some of the queries below run into it
+  double block[3] = {maxRange, 0.8, maxRange};
+  for (int i = 0; i < 5; i++) {
+    updateGrid(grid, x, y, theta, block);
+  }
+
+  double queryStart = now();
+  for (int i = 0; i < ticks; i++) {
+    double heading = theta + i * 0.37;
+    clear += grid.isSegmentClear(x, y, x + cos(heading), y + sin(heading));
+  }
+  double queryTime = (now() - queryStart) / ticks;
+
+  // a jump, as after an odometry reset, clears the whole grid
+  double jumpStart = now();
+  for (int i = 0; i < ticks / 10; i++) {
+    grid.recenter(i % 2 == 0 ? 100 : -100, 0);
+  }
+  double jumpTime = (now() - jumpStart) / (ticks / 10);
+
+  printf("update, recenter and %d rays: %.0f ns\n", 3 * raysPerSonar, updateTime * 1e9);
+  printf("1 m segment query: %.0f ns\n", queryTime * 1e9);
+  printf("recenter after a jump: %.0f ns\n", jumpTime * 1e9);
+  printf("segments clear: %.0f%%\n", 100.0 * clear / ticks);
+  return EXIT_SUCCESS;
+}
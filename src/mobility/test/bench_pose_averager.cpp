@@ -0,0 +1,105 @@
+/*
+ * Times one map pose update: adding the pose to the averaging window and
+ * reading the average back, as RoverBrain::mapAverage() does every tick.
+ * The old way wrote the pose into an array and summed the whole array, the
+ * new one keeps running sums in PoseAverager.
+ *
+ * usage: bench_pose_averager [updates]
+ */
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <geometry_msgs/Pose2D.h>
+
+#include "PoseAverager.h"
+
+namespace {
+
+double now() {
+  timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+// mapAverage() before PoseAverager, less its heading bug
+class RescanAverager {
+public:
+
+  RescanAverager(unsigned int windowSize) : window(windowSize) {
+    next = 0;
+  }
+
+  geometry_msgs::Pose2D update(const geometry_msgs::Pose2D& pose) {
+    window[next] = pose;
+    next++;
+    if (next >= window.size()) next = 0;
+
+    geometry_msgs::Pose2D average;
+    average.x = 0;
+    average.y = 0;
+    average.theta = 0;
+    for (size_t i = 0; i < window.size(); i++) {
+      average.x += window[i].x;
+      average.y += window[i].y;
+      average.theta += window[i].theta;
+    }
+    average.x /= window.size();
+    average.y /= window.size();
+    average.theta /= window.size();
+    return average;
+  }
+
+private:
+
+  std::vector<geometry_msgs::Pose2D> window;
+  size_t next;
+};
+
+geometry_msgs::Pose2D poseAt(int i) {
+  geometry_msgs::Pose2D pose;
+  pose.x = 0.01 * (i % 1000);
+  pose.y = 2 + 0.1 * sin(i * 0.01);
+  pose.theta = fmod(i * 0.001, 6) - 3;
+  return pose;
+}
+
+}
+
+int main(int argc, char** argv) {
+  int updates = argc > 1 ? atoi(argv[1]) : 1000000;
+  unsigned int windowSizes[] = {100, 500, 2000};
+
+  // keeps the compiler from dropping the averages
+  double checksum = 0;
+
+  printf("window  rescan ns/update  running sums ns/update\n");
+  for (int w = 0; w < 3; w++) {
+    RescanAverager rescan(windowSizes[w]);
+    PoseAverager averager(windowSizes[w]);
+
+    // the rescan is slow enough at large windows that fewer updates do
+    int rescanUpdates = updates / 10;
+    double start = now();
+    for (int i = 0; i < rescanUpdates; i++) {
+      checksum += rescan.update(poseAt(i)).x;
+    }
+    double rescanTime = (now() - start) / rescanUpdates;
+
+    start = now();
+    for (int i = 0; i < updates; i++) {
+      averager.addPose(poseAt(i));
+      checksum += averager.getAverage().x;
+    }
+    double runningTime = (now() - start) / updates;
+
+    printf("%6u  %16.1f  %22.1f\n", windowSizes[w], rescanTime * 1e9, runningTime * 1e9);
+  }
+
+  fprintf(stderr, "checksum %g\n", checksum);
+  return EXIT_SUCCESS;
+}
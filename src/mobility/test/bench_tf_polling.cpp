@@ -0,0 +1,246 @@
+/*
+ * Compares the resident memory and cpu time of the ways rovers have polled
+ * tf: in mobility_host, a thread per TransformCache, two per rover, each
+ * sleeping between lookups, against the lookups run as timers on one shared
+ * thread, and a process per rover running its own timers the way a mobility
+ * node per rover does.
+ *
+ * tf itself is stood in for by a mutex guarded map of transforms, the same
+ * cost in all of them, so the difference is what the threads and processes
+ * add. Nothing of roscpp is in here, the connections, spinner threads and
+ * buffers every node brings along come on top for each process.
+ *
+ * usage: bench_tf_polling <threads|timers|processes> <rovers> [seconds]
+ */
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+namespace {
+
+struct Transform {
+  double origin[3];
+  double rotation[4];
+};
+
+// stands in for the tf buffer every cache in the host reads from
+class TransformBuffer {
+public:
+
+  void set(const string& frame, const Transform& transform) {
+    boost::mutex::scoped_lock lock(mutex);
+    transforms[frame] = transform;
+  }
+
+  bool lookup(const string& frame, Transform& transform) {
+    boost::mutex::scoped_lock lock(mutex);
+    map<string, Transform>::iterator it = transforms.find(frame);
+    if (it == transforms.end()) return false;
+    transform = it->second;
+    return true;
+  }
+
+private:
+
+  boost::mutex mutex;
+  map<string, Transform> transforms;
+};
+
+TransformBuffer buffer;
+volatile bool running = true;
+volatile long* lookups; // shared with the rover processes
+
+struct Poll {
+  string frame;
+  double interval; // seconds
+  double next;
+  Transform latest;
+};
+
+double now() {
+  timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+void sleepUntil(double time) {
+  double remaining = time - now();
+  if (remaining > 0) usleep(remaining * 1e6);
+}
+
+// the old TransformCache::updateLoop()
+void pollThread(Poll* poll) {
+  while (running) {
+    buffer.lookup(poll->frame, poll->latest);
+    __sync_fetch_and_add(lookups, 1);
+    poll->next += poll->interval;
+    sleepUntil(poll->next);
+  }
+}
+
+// the timers on the shared control queue
+void timerThread(vector<Poll>* polls) {
+  while (running) {
+    double wake = 1e300;
+    for (size_t i = 0; i < polls->size(); i++) {
+      Poll& poll = (*polls)[i];
+      if (now() >= poll.next) {
+        buffer.lookup(poll.frame, poll.latest);
+        __sync_fetch_and_add(lookups, 1);
+        poll.next += poll.interval;
+      }
+      if (poll.next < wake) wake = poll.next;
+    }
+    sleepUntil(wake);
+  }
+}
+
+// of a process, "self" for this one
+long residentKilobytes(const string& pid) {
+  ifstream statm(("/proc/" + pid + "/statm").c_str());
+  long pages, resident;
+  statm >> pages >> resident;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// resident memory with shared pages split between the processes sharing
+// them, so libraries mapped by every rover process count once overall
+long proportionalKilobytes(const string& pid) {
+  ifstream rollup(("/proc/" + pid + "/smaps_rollup").c_str());
+  string line;
+  while (getline(rollup, line)) {
+    if (line.compare(0, 4, "Pss:") == 0) return atol(line.c_str() + 4);
+  }
+  return 0;
+}
+
+int countThreads(const string& pid) {
+  ifstream status(("/proc/" + pid + "/status").c_str());
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 8, "Threads:") == 0) return atoi(line.c_str() + 8);
+  }
+  return 0;
+}
+
+double cpuSeconds(int who) {
+  rusage usage;
+  getrusage(who, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3 || (strcmp(argv[1], "threads") != 0 && strcmp(argv[1], "timers") != 0 && strcmp(argv[1], "processes") != 0)) {
+    fprintf(stderr, "usage: %s <threads|timers|processes> <rovers> [seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  string mode = argv[1];
+  int rovers = atoi(argv[2]);
+  double seconds = argc > 3 ? atof(argv[3]) : 10;
+
+  lookups = (long*)mmap(NULL, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  *lookups = 0;
+
+  // map to odom at the control rate and the camera mount once a second, as RoverBrain asks for them
+  vector<Poll> polls;
+  double start = now();
+  for (int i = 0; i < rovers; i++) {
+    ostringstream name;
+    name << "rover" << i;
+
+    Poll poll;
+    poll.next = start;
+    poll.frame = name.str() + "/map";
+    poll.interval = 0.1;
+    polls.push_back(poll);
+    poll.frame = name.str() + "/camera_link";
+    poll.interval = 1;
+    polls.push_back(poll);
+  }
+
+  Transform identity = {{0, 0, 0}, {0, 0, 0, 1}};
+  for (size_t i = 0; i < polls.size(); i++) {
+    buffer.set(polls[i].frame, identity);
+  }
+
+  long resident = 0;
+  long proportional = 0;
+  int processCount = 0;
+  int threadCount = 0;
+  double cpu = 0;
+
+  if (mode == "processes") {
+    // each rover process only polls its own two frames, until it is killed
+    vector<pid_t> children;
+    for (int i = 0; i < rovers; i++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        vector<Poll> own(polls.begin() + 2 * i, polls.begin() + 2 * i + 2);
+        timerThread(&own);
+        _exit(EXIT_SUCCESS);
+      }
+      children.push_back(pid);
+    }
+
+    sleepUntil(start + seconds);
+    for (size_t i = 0; i < children.size(); i++) {
+      ostringstream pid;
+      pid << children[i];
+      resident += residentKilobytes(pid.str());
+      proportional += proportionalKilobytes(pid.str());
+      threadCount += countThreads(pid.str());
+      processCount++;
+    }
+
+    for (size_t i = 0; i < children.size(); i++) {
+      kill(children[i], SIGKILL);
+      waitpid(children[i], NULL, 0);
+    }
+    cpu = cpuSeconds(RUSAGE_CHILDREN);
+  } else {
+    double cpuBefore = cpuSeconds(RUSAGE_SELF);
+
+    boost::thread_group group;
+    if (mode == "threads") {
+      for (size_t i = 0; i < polls.size(); i++) {
+        group.create_thread(boost::bind(pollThread, &polls[i]));
+      }
+    } else {
+      group.create_thread(boost::bind(timerThread, &polls));
+    }
+
+    sleepUntil(start + seconds);
+    resident = residentKilobytes("self");
+    proportional = proportionalKilobytes("self");
+    threadCount = countThreads("self");
+    processCount = 1;
+    cpu = cpuSeconds(RUSAGE_SELF) - cpuBefore;
+
+    running = false;
+    group.join_all();
+  }
+
+  printf("%s rovers %d processes %d threads %d rss %ld kB pss %ld kB cpu %.1f ms/s lookups %.0f/s\n",
+         mode.c_str(), rovers, processCount, threadCount, resident, proportional, cpu / seconds * 1000, *lookups / seconds);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,185 @@
+/*
+ * Compares the control tick latency of the two ways mapAverage() has read
+ * the map to odom transform: waiting on tf for a transform at the tick's
+ * time, with the one second timeout it used, against copying the latest
+ * one out of a LatestValue the way TransformCache does now. Both kinds of
+ * tick run side by side on the same transform stream and are timed into a
+ * LatencyHistogram each, as mobility times its ticks.
+ *
+ * The stream is published at 10 Hz, the rate of the map ekf in
+ * swarmie.launch. Messages normally arrive a couple of milliseconds after
+ * their stamp, a given fraction of them arrive late, 0.2 to 1.5 seconds,
+ * holding up the ones behind them. tf is stood in for by a mutex guarded
+ * latest transform, polled every 10 ms while waiting as tf does.
+ *
+ * usage: bench_tick_latency [seconds] [late fraction]
+ */
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "LatencyHistogram.h"
+#include "LatestValue.h"
+
+namespace {
+
+const double tickPeriod = 0.1;    // seconds, the control stage's period
+const double publishPeriod = 0.1; // seconds, the map ekf's
+const double waitTimeout = 1.0;   // seconds, what mapAverage() waited
+const double pollInterval = 0.01; // seconds, tf's polling sleep in waitForTransform
+
+struct Transform {
+  double stamp;
+  double origin[3];
+  double rotation[4];
+};
+
+// stands in for the tf buffer, holding the latest transform delivered
+class TransformBuffer {
+public:
+
+  TransformBuffer() {
+    latest.stamp = -1;
+  }
+
+  void set(const Transform& transform) {
+    boost::mutex::scoped_lock lock(mutex);
+    latest = transform;
+  }
+
+  // true when a transform stamped at or after time has arrived
+  bool canTransform(double time) {
+    boost::mutex::scoped_lock lock(mutex);
+    return latest.stamp >= time;
+  }
+
+  bool lookup(Transform& transform) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (latest.stamp < 0) return false;
+    transform = latest;
+    return true;
+  }
+
+private:
+
+  boost::mutex mutex;
+  Transform latest;
+};
+
+TransformBuffer buffer;
+volatile bool running = true;
+
+double now() {
+  timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+void sleepUntil(double time) {
+  double remaining = time - now();
+  if (remaining > 0) usleep(remaining * 1e6);
+}
+
+void publish(double lateFraction) {
+  unsigned int seed = 11;
+  double next = now();
+
+  while (running) {
+    Transform transform;
+    transform.stamp = now();
+    transform.origin[0] = 0.01 * transform.stamp;
+    transform.origin[1] = 0;
+    transform.origin[2] = 0;
+    transform.rotation[0] = 0;
+    transform.rotation[1] = 0;
+    transform.rotation[2] = 0;
+    transform.rotation[3] = 1;
+
+    double delay = 0.002;
+    if (rand_r(&seed) < lateFraction * RAND_MAX) {
+      delay = 0.2 + 1.3 * rand_r(&seed) / RAND_MAX;
+    }
+    usleep(delay * 1e6);
+    buffer.set(transform);
+
+    // the messages held up behind a late one are not sent again
+    next += publishPeriod;
+    if (next < now()) next = now();
+    sleepUntil(next);
+  }
+}
+
+// mapAverage() before TransformCache
+void waitingTicks(LatencyHistogram* latency, int* timeouts) {
+  double next = now();
+
+  while (running) {
+    double start = now();
+
+    Transform transform;
+    while (!buffer.canTransform(start) && now() - start < waitTimeout) {
+      usleep(pollInterval * 1e6);
+    }
+    if (!buffer.canTransform(start) || !buffer.lookup(transform)) (*timeouts)++;
+
+    latency->record(now() - start);
+
+    // a ros::Timer fires again right away when a callback overran
+    next += tickPeriod;
+    if (next < now()) next = now();
+    sleepUntil(next);
+  }
+}
+
+// TransformCache updated from a timer and read by the tick
+void cachedTicks(LatencyHistogram* latency, int* stale) {
+  LatestValue<Transform> cache;
+  double next = now();
+
+  while (running) {
+    Transform transform;
+    if (buffer.lookup(transform)) cache.write(transform);
+
+    double start = now();
+    if (cache.read(transform) == 0 || start - transform.stamp > waitTimeout) (*stale)++;
+    latency->record(now() - start);
+
+    next += tickPeriod;
+    if (next < now()) next = now();
+    sleepUntil(next);
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  double seconds = argc > 1 ? atof(argv[1]) : 300;
+  double lateFraction = argc > 2 ? atof(argv[2]) : 0.02;
+
+  LatencyHistogram waiting("waitForTransform");
+  LatencyHistogram cached("TransformCache");
+  int timeouts = 0;
+  int stale = 0;
+
+  boost::thread publisher(boost::bind(publish, lateFraction));
+  usleep(publishPeriod * 1e6);
+  boost::thread waitingThread(boost::bind(waitingTicks, &waiting, &timeouts));
+  boost::thread cachedThread(boost::bind(cachedTicks, &cached, &stale));
+
+  usleep(seconds * 1e6);
+  running = false;
+  waitingThread.join();
+  cachedThread.join();
+  publisher.join();
+
+  printf("%.0f s, %.0f%% of transforms late\n", seconds, lateFraction * 100);
+  printf("%s, %d timed out\n", waiting.summary().c_str(), timeouts);
+  printf("%s, %d over a second old\n", cached.summary().c_str(), stale);
+  return EXIT_SUCCESS;
+}
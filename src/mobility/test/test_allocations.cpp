@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "CoverageMap.h"
+#include "KinematicSim.h"
+#include "LatencyHistogram.h"
+#include "OccupancyGrid.h"
+#include "SwarmMap.h"
+#include "TargetMemory.h"
+
+// Every heap allocation in the test binary goes through here, so a test can
+// count the ones made by the code it runs.
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL) throw std::bad_alloc();
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* memory) throw() {
+  free(memory);
+}
+
+void operator delete[](void* memory) throw() {
+  free(memory);
+}
+
+namespace {
+
+const double tick = 0.1; // seconds, the control stage's period
+
+// a target in view of a rover that is driving slowly past it
+void sightTarget(TargetMemory& memory, int tickNumber) {
+  double noise = 0.02 * sin(tickNumber * 0.7);
+  memory.add(3, 1.2 + noise, -0.4 - noise, tickNumber * tick);
+}
+
+void fillMessage(mobility::SwarmMapDelta& message, SwarmMap& other) {
+  for (int i = 0; i < 40; i++) {
+    other.markFootprint(-5 + i * 0.25, 2, 0);
+  }
+  other.addTargetSeen(3, 3);
+  other.addTargetCollected(-3, -3);
+  other.buildMessage(message, true);
+}
+
+}
+
+TEST(Allocations, TargetMemoryRepeatSightingAndExpire) {
+  TargetMemory memory(0.5, 0.25, 600);
+  memory.add(7, -2, 2, 0);
+
+  for (int i = 0; i < 10; i++) {
+    sightTarget(memory, i);
+    memory.expire(i * tick);
+  }
+
+  unsigned long before = allocations;
+  for (int i = 10; i < 1000; i++) {
+    sightTarget(memory, i);
+    memory.expire(i * tick);
+  }
+  EXPECT_EQ(0u, allocations - before);
+  EXPECT_EQ(2, memory.size());
+}
+
+// expire() skips its scan until something can be due, it must still forget
+// everything that is
+TEST(Allocations, TargetMemoryStillExpires) {
+  TargetMemory memory(0.5, 0.25, 10);
+  memory.add(1, 0.45, 0.45, 0);
+  memory.add(2, 5, 5, 4);
+
+  memory.expire(9);
+  EXPECT_EQ(2, memory.size());
+
+  // seen again, its mean staying in its cell and then crossing into the next
+  memory.add(1, 0.44, 0.44, 8);
+  memory.add(1, 0.6, 0.6, 8.5);
+  memory.add(1, 0.65, 0.65, 8.6);
+  EXPECT_EQ(2, memory.size());
+
+  memory.expire(12);
+  EXPECT_EQ(2, memory.size());
+  memory.expire(14.5);
+  EXPECT_EQ(1, memory.size());
+  memory.expire(18.7);
+  EXPECT_EQ(0, memory.size());
+
+  memory.add(3, 1, 1, 20);
+  memory.expire(29);
+  EXPECT_EQ(1, memory.size());
+  memory.expire(31);
+  EXPECT_EQ(0, memory.size());
+}
+
+TEST(Allocations, SwarmMapMerge) {
+  SwarmMap map(15, 0.25);
+  SwarmMap other(15, 0.25);
+  mobility::SwarmMapDelta message;
+  fillMessage(message, other);
+
+  std::vector<int> newlyCovered;
+  newlyCovered.reserve(1000);
+  ASSERT_TRUE(map.merge(message, &newlyCovered));
+  EXPECT_GT(newlyCovered.size(), 0u);
+
+  // the same full map, as every rover sends now and then
+  unsigned long before = allocations;
+  for (int i = 0; i < 100; i++) {
+    newlyCovered.clear();
+    ASSERT_TRUE(map.merge(message, &newlyCovered));
+  }
+  EXPECT_EQ(0u, allocations - before);
+  EXPECT_EQ(0u, newlyCovered.size());
+}
+
+// marking footprints each tick and building a delta every couple of
+// seconds, once the buffers have grown to a publish interval's worth
+TEST(Allocations, SwarmMapFootprintsAndDeltas) {
+  SwarmMap map(15, 0.25);
+  mobility::SwarmMapDelta message;
+  double x = -12;
+  unsigned long before = 0;
+
+  for (int publish = 0; publish < 20; publish++) {
+    if (publish == 2) before = allocations;
+
+    for (int i = 0; i < 20; i++) {
+      map.markFootprint(x, 0, 0);
+      x += 0.05;
+    }
+    ASSERT_TRUE(map.buildMessage(message, false));
+  }
+
+  EXPECT_EQ(0u, allocations - before);
+}
+
+TEST(Allocations, OccupancyGridAndCoverage) {
+  OccupancyGrid grid(0.1);
+  CoverageMap coverage(15, 0.25);
+
+  unsigned long before = allocations;
+  for (int i = 0; i < 1000; i++) {
+    double x = i * 0.02;
+    double theta = i * 0.01;
+    grid.recenter(x, 0);
+    for (int ray = 0; ray < 9; ray++) {
+      grid.addRay(x, 0, theta + (ray - 4) * 0.05, 1.5 + 0.5 * sin(i * 0.1), i % 3 != 0);
+    }
+    coverage.markFootprint(x, 0, theta);
+  }
+  EXPECT_EQ(0u, allocations - before);
+}
+
+// RoverBrain's control tick needs ROS, so this runs the simulator's copy of
+// it: the state machine and the real controllers, fed by the sonar and camera
+// models. The one cube is out of sight, remembering a new target is the only
+// tick work allowed to grow a container. The swarm map's buffers grow with
+// the map and are left to the tests above.
+TEST(Allocations, SimulatedControlTicks) {
+  KinematicSim::Config config;
+  config.rovers = 3;
+  config.swarmMap = false;
+  geometry_msgs::Pose2D cube;
+  cube.x = 100;
+  cube.y = 100;
+  cube.theta = 0;
+  config.targets.push_back(cube);
+
+  KinematicSim sim(config);
+  for (int tick = 0; tick < 600; tick++) {
+    sim.step();
+  }
+
+  unsigned long before = allocations;
+  for (int tick = 0; tick < 6000; tick++) {
+    sim.step();
+  }
+  EXPECT_EQ(0u, allocations - before);
+}
+
+// what a control tick over its budget logs
+TEST(Allocations, LatencyHistogramFormat) {
+  LatencyHistogram histogram("control tick");
+  char summary[256];
+
+  unsigned long before = allocations;
+  for (int i = 0; i < 1000; i++) {
+    histogram.record(i * 1e-5);
+    histogram.format(summary, sizeof(summary));
+  }
+  EXPECT_EQ(0u, allocations - before);
+  EXPECT_EQ(histogram.summary(), summary);
+}
@@ -0,0 +1,183 @@
+#include "ObstacleEngine.h"
+
+#include <cmath>
+#include <limits>
+
+ObstacleEngine::ObstacleEngine(int windowSize) {
+  if (windowSize < 1) windowSize = 1;
+  if (windowSize > maxWindowSize) windowSize = maxWindowSize;
+  this->windowSize = windowSize;
+
+  collisionDistance = 0.6;
+  collisionExitDistance = 0.7;
+  blockDistance = 0.12;
+  blockExitDistance = 0.15;
+  outlierDistance = 0.3;
+  minClosingSpeed = 0.02;
+  maxSampleGap = 1.0;
+
+  for (int i = 0; i < SECTOR_COUNT; i++) {
+    maxAge[i] = std::numeric_limits<double>::infinity();
+  }
+
+  readings = 0;
+  outliers = 0;
+  expired = 0;
+
+  reset();
+}
+
+void ObstacleEngine::addRange(Sector sector, float range, double time) {
+  Window& window = windows[sector];
+
+  // a sonar that went quiet has nothing useful left in its window, and old
+  // readings would make the closing speed fit meaningless
+  if (window.count > 0) {
+    int last = (window.next + windowSize - 1) % windowSize;
+    double gap = time - window.samples[last].time;
+    if (gap > maxSampleGap || gap < 0) {
+      window.count = 0;
+      window.next = 0;
+    }
+  }
+
+  window.samples[window.next].range = range;
+  window.samples[window.next].time = time;
+  window.next = (window.next + 1) % windowSize;
+  if (window.count < windowSize) window.count++;
+
+  readings++;
+  update(sector);
+}
+
+void ObstacleEngine::update(Sector sector) {
+  Window& window = windows[sector];
+  SectorState& state = sectors[sector];
+
+  // median by insertion sort of a copy, the window is only a handful of values
+  float sorted[maxWindowSize];
+  for (int i = 0; i < window.count; i++) {
+    float value = window.samples[i].range;
+    int j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+
+  float median;
+  if (window.count % 2 == 1) {
+    median = sorted[window.count / 2];
+  } else {
+    median = (sorted[window.count / 2 - 1] + sorted[window.count / 2]) / 2;
+  }
+
+  // least squares slope of the readings that agree with the median, times are
+  // taken relative to the newest reading to keep the sums small
+  int newest = (window.next + windowSize - 1) % windowSize;
+  double origin = window.samples[newest].time;
+  double sumT = 0, sumR = 0, sumTT = 0, sumTR = 0;
+  int inliers = 0;
+
+  for (int i = 0; i < window.count; i++) {
+    const Sample& sample = window.samples[i];
+    if (std::fabs(sample.range - median) > outlierDistance) continue;
+
+    double t = sample.time - origin;
+    sumT += t;
+    sumR += sample.range;
+    sumTT += t * t;
+    sumTR += t * sample.range;
+    inliers++;
+  }
+
+  if (std::fabs(window.samples[newest].range - median) > outlierDistance) {
+    outliers++;
+  }
+
+  float closingSpeed = 0;
+  double denominator = inliers * sumTT - sumT * sumT;
+  if (inliers >= 3 && denominator > 1e-9) {
+    closingSpeed = -(inliers * sumTR - sumT * sumR) / denominator;
+  }
+
+  state.distance = median;
+  state.confidence = (float)inliers / windowSize;
+  state.closingSpeed = closingSpeed;
+
+  if (closingSpeed > minClosingSpeed) {
+    state.timeToCollision = median / closingSpeed;
+  } else {
+    state.timeToCollision = -1;
+  }
+
+  updateObstructed(sector);
+}
+
+void ObstacleEngine::updateObstructed(Sector sector) {
+  float distance = sectors[sector].distance;
+
+  if (obstructed[sector]) {
+    obstructed[sector] = distance <= collisionExitDistance;
+  } else {
+    obstructed[sector] = distance < collisionDistance;
+  }
+
+  if (sector == CENTER) {
+    if (blocked) {
+      blocked = distance <= blockExitDistance;
+    } else {
+      blocked = distance < blockDistance;
+    }
+  }
+}
+
+void ObstacleEngine::expire(double time) {
+  for (int i = 0; i < SECTOR_COUNT; i++) {
+    Window& window = windows[i];
+    if (window.count == 0) continue;
+
+    int newest = (window.next + windowSize - 1) % windowSize;
+    if (time - window.samples[newest].time > maxAge[i]) {
+      clear((Sector)i);
+      expired++;
+    }
+  }
+}
+
+ObstacleEngine::Code ObstacleEngine::getCode() {
+  if (blocked) {
+    return BLOCK_FRONT;
+  }
+
+  if (!obstructed[LEFT] && !obstructed[CENTER] && !obstructed[RIGHT]) {
+    return CLEAR;
+  }
+
+  if (!obstructed[LEFT] && obstructed[RIGHT]) {
+    return OBSTACLE_RIGHT;
+  }
+
+  return OBSTACLE_FRONT_LEFT;
+}
+
+void ObstacleEngine::reset() {
+  for (int i = 0; i < SECTOR_COUNT; i++) {
+    clear((Sector)i);
+  }
+}
+
+void ObstacleEngine::clear(Sector sector) {
+  windows[sector].next = 0;
+  windows[sector].count = 0;
+
+  // nothing seen, which reads as clear
+  sectors[sector].distance = std::numeric_limits<float>::infinity();
+  sectors[sector].confidence = 0;
+  sectors[sector].closingSpeed = 0;
+  sectors[sector].timeToCollision = -1;
+
+  obstructed[sector] = false;
+  if (sector == CENTER) blocked = false;
+}
@@ -0,0 +1,112 @@
+#ifndef OBSTACLE_ENGINE_H
+#define OBSTACLE_ENGINE_H
+
+/**
+ * Filters the left, center and right sonar ranges before they are turned into
+ * obstacle decisions.
+ *
+ * Each sonar keeps its last few readings in a small ring buffer. Its distance
+ * is the median of that buffer, so a single spurious echo (a multipath return
+ * or a reading from the ground) no longer triggers an avoidance maneuver, and
+ * readings far from the median are left out of the closing speed estimate. The
+ * closing speed is a least squares fit of the remaining readings against time.
+ *
+ * Everything lives in fixed size arrays, so an update costs a few hundred
+ * floating point operations and never allocates. Not thread safe.
+ */
+class ObstacleEngine {
+
+  public:
+
+    enum Sector {
+      LEFT = 0,
+      CENTER = 1,
+      RIGHT = 2,
+      SECTOR_COUNT = 3
+    };
+
+    // legacy /obstacle codes
+    enum Code {
+      CLEAR = 0,
+      OBSTACLE_RIGHT = 1,
+      OBSTACLE_FRONT_LEFT = 2,
+      BLOCK_FRONT = 4
+    };
+
+    static const int maxWindowSize = 16;
+
+    struct SectorState {
+      float distance;        // m, median of the window
+      float confidence;      // 0 to 1
+      float closingSpeed;    // m/s, positive when approaching
+      float timeToCollision; // s, -1 when not closing
+    };
+
+    ObstacleEngine(int windowSize = 5);
+
+    // adds one reading to a sector, time in seconds
+    void addRange(Sector sector, float range, double time);
+
+    const SectorState& getSector(Sector sector) {return sectors[sector];}
+
+    // forgets sectors whose newest reading is older than their maxAge, so a
+    // sonar that stopped reporting reads as unknown (clear, confidence 0)
+    // instead of repeating its last distance forever
+    void expire(double time);
+
+    // legacy code for the current filtered distances, with hysteresis
+    Code getCode();
+
+    void reset();
+
+    // meters, a sector becomes obstructed closer than collisionDistance and
+    // clear again only beyond collisionExitDistance, so a reading hovering at
+    // the threshold does not flip the code back and forth. Likewise for a
+    // block in front of the center sonar.
+    float collisionDistance;
+    float collisionExitDistance;
+    float blockDistance;
+    float blockExitDistance;
+
+    // readings further than this from the median are outliers (m)
+    float outlierDistance;
+
+    // slower than this counts as not closing (m/s)
+    float minClosingSpeed;
+
+    // a sector whose last reading is older than this starts over (s)
+    double maxSampleGap;
+
+    // oldest reading expire() keeps for each sector (s)
+    double maxAge[SECTOR_COUNT];
+
+    // counters since construction, for diagnostics
+    unsigned long readings;
+    unsigned long outliers;
+    unsigned long expired;
+
+  private:
+
+    struct Sample {
+      float range;
+      double time;
+    };
+
+    struct Window {
+      Sample samples[maxWindowSize];
+      int next;
+      int count;
+    };
+
+    void update(Sector sector);
+    void updateObstructed(Sector sector);
+    void clear(Sector sector);
+
+    int windowSize;
+    Window windows[SECTOR_COUNT];
+    SectorState sectors[SECTOR_COUNT];
+    bool obstructed[SECTOR_COUNT];
+    bool blocked;
+};
+
+#endif /* OBSTACLE_ENGINE_H */
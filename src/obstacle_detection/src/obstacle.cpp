@@ -4,11 +4,15 @@
 #include <message_filters/subscriber.h>
 #include <message_filters/synchronizer.h>
 #include <message_filters/sync_policies/approximate_time.h>
+#include <boost/shared_ptr.hpp>
 
 //ROS messages
 #include <std_msgs/UInt8.h>
 #include <sensor_msgs/Range.h>
 #include <std_msgs/String.h>
+#include "obstacle_detection/ObstacleReport.h"
+
+#include "ObstacleEngine.h"
 
 using namespace std;
 
@@ -18,17 +22,43 @@ string publishedName;
 char host[128];
 
 float heartbeat_publish_interval = 2;
+float report_interval = 60; //seconds between filter statistics in the log, from the ~report_interval parameter
+float keepalive_interval = 1; //seconds an unchanged obstacle code is republished after, from the ~keepalive_interval parameter
+
+// "latest" evaluates whenever any sonar reports, using the newest reading of
+// the other two. "synchronized" waits for a matching triple like the node
+// always did. From the ~fusion parameter.
+string fusionMode = "latest";
+
+ObstacleEngine engine;
+ros::WallDuration processingTime(0);
+ros::WallDuration maxProcessingTime(0);
+unsigned long evaluations = 0;
+
+// time from the reading that changed the obstacle code to the publish
+ros::Duration detectionLatency(0);
+ros::Duration maxDetectionLatency(0);
+unsigned long detections = 0;
+uint8_t prevCode = ObstacleEngine::CLEAR;
+
+// /obstacle is only published when the code changes or the keepalive is due
+ros::Time lastCodePublishTime;
+unsigned long codePublishes = 0;
 
 //Publishers
 ros::Publisher obstaclePublish;
 ros::Publisher heartbeatPublisher;
+ros::Publisher obstacleReportPublish;
 
 //Timers
 ros::Timer publish_heartbeat_timer;
+ros::Timer report_timer;
 
 //Callback handlers
 void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight);
+void latestSonarHandler(ObstacleEngine::Sector sector, const sensor_msgs::Range::ConstPtr& sonar);
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
+void reportTimerEventHandler(const ros::TimerEvent& event);
 
 int main(int argc, char** argv) {
     gethostname(host, sizeof (host));
@@ -44,44 +74,161 @@ int main(int argc, char** argv) {
 
     ros::init(argc, argv, (publishedName + "_OBSTACLE"));
     ros::NodeHandle oNH;
+
+    ros::NodeHandle param("~");
+
+    // the thresholds default to the obstacle group of launch/rover_params.yaml,
+    // and a private parameter still overrides them
+    ros::NodeHandle shared(publishedName + "/obstacle");
+    double sharedCollisionDistance;
+    float sharedBlockDistance;
+    float sharedBlockExitDistance;
+    shared.param("collision_distance", sharedCollisionDistance, 0.6);
+    shared.param("block_distance", sharedBlockDistance, 0.12f);
+    shared.param("block_exit_distance", sharedBlockExitDistance, 0.15f);
+
+    int windowSize;
+    float outlierDistance;
+    float collisionExitDistance;
+    float blockDistance;
+    float blockExitDistance;
+    param.param("window_size", windowSize, 5);
+    param.param("collision_distance", collisionDistance, sharedCollisionDistance);
+    shared.param("collision_exit_distance", collisionExitDistance, (float)collisionDistance + 0.1f);
+    param.param("collision_exit_distance", collisionExitDistance, collisionExitDistance);
+    param.param("block_distance", blockDistance, sharedBlockDistance);
+    param.param("block_exit_distance", blockExitDistance, sharedBlockExitDistance);
+    param.param("outlier_distance", outlierDistance, 0.3f);
+    param.param("keepalive_interval", keepalive_interval, 1.0f);
+    param.param("report_interval", report_interval, 60.0f);
+    param.param("fusion", fusionMode, string("latest"));
+
+    engine = ObstacleEngine(windowSize);
+    engine.collisionDistance = collisionDistance;
+    engine.collisionExitDistance = collisionExitDistance;
+    engine.blockDistance = blockDistance;
+    engine.blockExitDistance = blockExitDistance;
+    engine.outlierDistance = outlierDistance;
+
+    // a sonar that has been quiet for longer than its max age is ignored
+    // rather than holding the rover on a stale reading
+    double maxAge;
+    param.param("max_age", maxAge, 0.5);
+    param.param("max_age_left", engine.maxAge[ObstacleEngine::LEFT], maxAge);
+    param.param("max_age_center", engine.maxAge[ObstacleEngine::CENTER], maxAge);
+    param.param("max_age_right", engine.maxAge[ObstacleEngine::RIGHT], maxAge);
     
     obstaclePublish = oNH.advertise<std_msgs::UInt8>((publishedName + "/obstacle"), 10);
     heartbeatPublisher = oNH.advertise<std_msgs::String>((publishedName + "/obstacle/heartbeat"), 1, true);
+    obstacleReportPublish = oNH.advertise<obstacle_detection::ObstacleReport>((publishedName + "/obstacle/report"), 10);
     
     message_filters::Subscriber<sensor_msgs::Range> sonarLeftSubscriber(oNH, (publishedName + "/sonarLeft"), 10);
     message_filters::Subscriber<sensor_msgs::Range> sonarCenterSubscriber(oNH, (publishedName + "/sonarCenter"), 10);
     message_filters::Subscriber<sensor_msgs::Range> sonarRightSubscriber(oNH, (publishedName + "/sonarRight"), 10);
 
     typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Range, sensor_msgs::Range, sensor_msgs::Range> sonarSyncPolicy;
+    boost::shared_ptr<message_filters::Synchronizer<sonarSyncPolicy> > sonarSync;
 
-    message_filters::Synchronizer<sonarSyncPolicy> sonarSync(sonarSyncPolicy(10), sonarLeftSubscriber, sonarCenterSubscriber, sonarRightSubscriber);
-    sonarSync.registerCallback(boost::bind(&sonarHandler, _1, _2, _3));
+    if (fusionMode == "synchronized") {
+        sonarSync.reset(new message_filters::Synchronizer<sonarSyncPolicy>(sonarSyncPolicy(10), sonarLeftSubscriber, sonarCenterSubscriber, sonarRightSubscriber));
+        sonarSync->registerCallback(boost::bind(&sonarHandler, _1, _2, _3));
+    } else {
+        if (fusionMode != "latest") {
+            ROS_WARN("Unknown fusion mode %s, using latest", fusionMode.c_str());
+            fusionMode = "latest";
+        }
+
+        sonarLeftSubscriber.registerCallback(boost::bind(&latestSonarHandler, ObstacleEngine::LEFT, _1));
+        sonarCenterSubscriber.registerCallback(boost::bind(&latestSonarHandler, ObstacleEngine::CENTER, _1));
+        sonarRightSubscriber.registerCallback(boost::bind(&latestSonarHandler, ObstacleEngine::RIGHT, _1));
+    }
 
     publish_heartbeat_timer = oNH.createTimer(ros::Duration(heartbeat_publish_interval), publishHeartBeatTimerEventHandler);
+    report_timer = oNH.createTimer(ros::Duration(report_interval), reportTimerEventHandler);
 
     ros::spin();
 
     return EXIT_SUCCESS;
 }
 
-void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight) {
-	std_msgs::UInt8 obstacleMode;
-	
-	if ((sonarLeft->range > collisionDistance) && (sonarCenter->range > collisionDistance) && (sonarRight->range > collisionDistance)) {
-		obstacleMode.data = 0; //no collision
-	}
-	else if ((sonarLeft->range > collisionDistance) && (sonarRight->range < collisionDistance)) {
-		obstacleMode.data = 1; //collision on right side
-	}
-	else {
-		obstacleMode.data = 2; //collision in front or on left side
-	}
-	if (sonarCenter->range < 0.12) //block in front of center unltrasound.
-	{
-		obstacleMode.data = 4;
-	}
-	
+// Readings are timed by their stamp when the sender sets one, otherwise by
+// when they arrived.
+double sonarTime(const sensor_msgs::Range::ConstPtr& sonar) {
+    if (sonar->header.stamp.isZero()) return ros::Time::now().toSec();
+    return sonar->header.stamp.toSec();
+}
+
+// Decides the obstacle code from what the engine holds now and publishes it.
+// readingStamp is the oldest of the readings that arrived for this decision,
+// so a code change can be timed from the reading that caused it.
+void evaluate(ros::Time readingStamp, ros::WallTime start) {
+    // a synchronized triple is only as fresh as its matching allows, so only
+    // the latest value mode drops stale sonars
+    if (fusionMode == "latest") {
+        engine.expire(ros::Time::now().toSec());
+    }
+
+    // same codes as always, decided on the median distances so one stray echo
+    // no longer sends the rover into an avoidance maneuver
+    std_msgs::UInt8 obstacleMode;
+    obstacleMode.data = engine.getCode();
+
+    ros::WallDuration elapsed = ros::WallTime::now() - start;
+    processingTime += elapsed;
+    if (elapsed > maxProcessingTime) maxProcessingTime = elapsed;
+    evaluations++;
+
+    // The code is published when it changes and otherwise only as a slow
+    // keepalive, so mobility no longer re-plans on every sonar reading.
+    ros::Time now = ros::Time::now();
+    bool changed = obstacleMode.data != prevCode;
+
+    if (changed || (now - lastCodePublishTime).toSec() >= keepalive_interval) {
         obstaclePublish.publish(obstacleMode);
+        lastCodePublishTime = now;
+        codePublishes++;
+    }
+
+    // the full report is only worth building for someone listening
+    if (obstacleReportPublish.getNumSubscribers() > 0) {
+        obstacle_detection::ObstacleReport report;
+        report.header.stamp = readingStamp;
+        report.code = obstacleMode.data;
+        for (int i = 0; i < ObstacleEngine::SECTOR_COUNT; i++) {
+            const ObstacleEngine::SectorState& sector = engine.getSector((ObstacleEngine::Sector)i);
+            report.distance[i] = sector.distance;
+            report.confidence[i] = sector.confidence;
+            report.closing_speed[i] = sector.closingSpeed;
+            report.time_to_collision[i] = sector.timeToCollision;
+        }
+        obstacleReportPublish.publish(report);
+    }
+
+    if (changed && !readingStamp.isZero()) {
+        ros::Duration latency = now - readingStamp;
+        detectionLatency += latency;
+        if (latency > maxDetectionLatency) maxDetectionLatency = latency;
+        detections++;
+    }
+    prevCode = obstacleMode.data;
+}
+
+void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight) {
+    ros::WallTime start = ros::WallTime::now();
+
+    engine.addRange(ObstacleEngine::LEFT, sonarLeft->range, sonarTime(sonarLeft));
+    engine.addRange(ObstacleEngine::CENTER, sonarCenter->range, sonarTime(sonarCenter));
+    engine.addRange(ObstacleEngine::RIGHT, sonarRight->range, sonarTime(sonarRight));
+
+    ros::Time oldest = min(sonarLeft->header.stamp, min(sonarCenter->header.stamp, sonarRight->header.stamp));
+    evaluate(oldest, start);
+}
+
+void latestSonarHandler(ObstacleEngine::Sector sector, const sensor_msgs::Range::ConstPtr& sonar) {
+    ros::WallTime start = ros::WallTime::now();
+
+    engine.addRange(sector, sonar->range, sonarTime(sonar));
+    evaluate(sonar->header.stamp, start);
 }
 
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
@@ -90,3 +237,32 @@ void publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
     heartbeatPublisher.publish(msg);
      ROS_INFO("yes");
 }
+
+void reportTimerEventHandler(const ros::TimerEvent&) {
+    if (evaluations == 0) return;
+
+    ROS_INFO("%s obstacle filter (%s): %lu updates, %lu of %lu readings were outliers, %lu stale sonar timeouts, %.1f us mean %.1f us max per update",
+             publishedName.c_str(), fusionMode.c_str(), evaluations, engine.outliers, engine.readings, engine.expired,
+             processingTime.toSec() * 1e6 / evaluations, maxProcessingTime.toSec() * 1e6);
+
+    ROS_INFO("%s obstacle codes published: %lu of %lu updates (%.0f%% fewer messages)",
+             publishedName.c_str(), codePublishes, evaluations, 100.0 * (evaluations - codePublishes) / evaluations);
+
+    if (detections > 0) {
+        ROS_INFO("%s obstacle detection latency (%s): %lu code changes, %.1f ms mean %.1f ms max from reading to publish",
+                 publishedName.c_str(), fusionMode.c_str(), detections,
+                 detectionLatency.toSec() * 1e3 / detections, maxDetectionLatency.toSec() * 1e3);
+    }
+
+    evaluations = 0;
+    codePublishes = 0;
+    processingTime = ros::WallDuration(0);
+    maxProcessingTime = ros::WallDuration(0);
+    engine.outliers = 0;
+    engine.readings = 0;
+    engine.expired = 0;
+
+    detections = 0;
+    detectionLatency = ros::Duration(0);
+    maxDetectionLatency = ros::Duration(0);
+}
@@ -0,0 +1,55 @@
+/*
+ * Cost of filtering one round of sonar readings, left, center and right,
+ * and deciding the obstacle code, at several window sizes.
+ *
+ * usage: bench_obstacle_engine [rounds]
+ */
+
+#include <sys/time.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "ObstacleEngine.h"
+
+namespace {
+
+double now() {
+  timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+}
+
+int main(int argc, char** argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 1000000;
+  int windowSizes[] = {3, 5, 9, 16};
+
+  // keeps the compiler from dropping the work
+  int codes = 0;
+
+  printf("window  ns/round\n");
+  for (int w = 0; w < 4; w++) {
+    ObstacleEngine engine(windowSizes[w]);
+
+    double start = now();
+    for (int i = 0; i < rounds; i++) {
+      double time = i * 0.1;
+
+      // a wall coming and going in front, noise on the sides
+      float center = 1.5 + sin(i * 0.05);
+      engine.addRange(ObstacleEngine::LEFT, 2 + 0.01 * (i % 7), time);
+      engine.addRange(ObstacleEngine::CENTER, center, time);
+      engine.addRange(ObstacleEngine::RIGHT, 2 - 0.01 * (i % 5), time);
+      codes += engine.getCode();
+    }
+    double elapsed = now() - start;
+
+    printf("%6d  %8.1f\n", windowSizes[w], elapsed / rounds * 1e9);
+  }
+
+  fprintf(stderr, "codes %d\n", codes);
+  return EXIT_SUCCESS;
+}
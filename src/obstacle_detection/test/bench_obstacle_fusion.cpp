@@ -0,0 +1,164 @@
+/*
+ * Detection latency of the two sonar fusion modes of the obstacle node when
+ * one sonar lags the others: "synchronized" evaluates a matched left, center
+ * and right triple once its last reading arrives, "latest" evaluates on every
+ * reading with the newest of the other two and expires sonars older than
+ * max_age. A simulated 10 Hz stream reads clear at 2 m until a wall appears
+ * in front of one sonar, and the latency is timed from that range drop to the
+ * publish of the changed code, filter window included.
+ *
+ * The synchronizer is modeled as releasing each round of readings when its
+ * last reading arrives, which is what ApproximateTime does for sonars that
+ * share their stamps.
+ *
+ * usage: bench_obstacle_fusion [trials]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ObstacleEngine.h"
+
+namespace {
+
+const double period = 0.1;   // s, the sonars report at 10 Hz together
+const double jitter = 0.005; // s, of delivery for a sonar that keeps up
+const double maxAge = 0.5;   // s, the node's ~max_age default
+const float clearRange = 2;
+const float wallRange = 0.3;
+
+struct Reading {
+  ObstacleEngine::Sector sector;
+  float range;
+  double stamp;
+  double arrival;
+};
+
+bool byArrival(const Reading& a, const Reading& b) {
+  return a.arrival < b.arrival;
+}
+
+double uniform() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// the wall shows up in front of the dropped sector at dropTime, and every
+// reading of the lagging sector is delivered lag late
+void makeStream(double dropTime, ObstacleEngine::Sector dropped, ObstacleEngine::Sector lagging, double lag, double duration, std::vector<Reading>& stream) {
+  stream.clear();
+  for (int round = 0; round * period < duration; round++) {
+    double stamp = round * period;
+    for (int i = 0; i < ObstacleEngine::SECTOR_COUNT; i++) {
+      Reading reading;
+      reading.sector = (ObstacleEngine::Sector)i;
+      reading.range = i == dropped && stamp >= dropTime ? wallRange : clearRange;
+      reading.stamp = stamp;
+      reading.arrival = stamp + jitter * uniform() + (i == lagging ? lag : 0);
+      stream.push_back(reading);
+    }
+  }
+  std::stable_sort(stream.begin(), stream.end(), byArrival);
+}
+
+ObstacleEngine makeEngine() {
+  ObstacleEngine engine(5);
+  for (int i = 0; i < ObstacleEngine::SECTOR_COUNT; i++) {
+    engine.maxAge[i] = maxAge;
+  }
+  return engine;
+}
+
+// time the first code change is published, or -1 if it never is
+double detectLatest(const std::vector<Reading>& stream) {
+  ObstacleEngine engine = makeEngine();
+  for (size_t i = 0; i < stream.size(); i++) {
+    engine.addRange(stream[i].sector, stream[i].range, stream[i].stamp);
+    engine.expire(stream[i].arrival);
+    if (engine.getCode() != ObstacleEngine::CLEAR) return stream[i].arrival;
+  }
+  return -1;
+}
+
+double detectSynchronized(const std::vector<Reading>& stream) {
+  ObstacleEngine engine = makeEngine();
+
+  // readings of each round as they arrive, released once all three are in
+  std::vector<std::vector<Reading> > rounds(stream.size() / ObstacleEngine::SECTOR_COUNT + 1);
+  for (size_t i = 0; i < stream.size(); i++) {
+    std::vector<Reading>& round = rounds[(int)(stream[i].stamp / period + 0.5)];
+    round.push_back(stream[i]);
+    if (round.size() < ObstacleEngine::SECTOR_COUNT) continue;
+
+    Reading triple[ObstacleEngine::SECTOR_COUNT];
+    for (int j = 0; j < ObstacleEngine::SECTOR_COUNT; j++) {
+      triple[round[j].sector] = round[j];
+    }
+    for (int j = 0; j < ObstacleEngine::SECTOR_COUNT; j++) {
+      engine.addRange(triple[j].sector, triple[j].range, triple[j].stamp);
+    }
+    if (engine.getCode() != ObstacleEngine::CLEAR) return stream[i].arrival;
+  }
+  return -1;
+}
+
+struct Latency {
+  double total;
+  double max;
+  int detected;
+  int trials;
+
+  Latency() : total(0), max(0), detected(0), trials(0) {}
+
+  void add(double publish, double dropTime) {
+    trials++;
+    if (publish < 0) return;
+    double latency = publish - dropTime;
+    total += latency;
+    if (latency > max) max = latency;
+    detected++;
+  }
+};
+
+void print(double lag, const char* wall, const char* mode, const Latency& latency) {
+  double mean = latency.detected > 0 ? latency.total / latency.detected * 1e3 : 0;
+  printf("%6.0f  %-6s  %-12s  %7.1f  %7.1f  %8.1f%%\n", lag * 1e3, wall, mode, mean, latency.max * 1e3,
+         100.0 * latency.detected / latency.trials);
+}
+
+}
+
+int main(int argc, char** argv) {
+  int trials = argc > 1 ? atoi(argv[1]) : 1000;
+  double lags[] = {0, 0.05, 0.2, 0.4, 0.6};
+
+  // the center sonar lags, the wall appears in front of it or of the left one
+  ObstacleEngine::Sector lagging = ObstacleEngine::CENTER;
+  ObstacleEngine::Sector walls[] = {ObstacleEngine::LEFT, ObstacleEngine::CENTER};
+  const char* wallNames[] = {"left", "center"};
+
+  srand(1);
+  std::vector<Reading> stream;
+
+  printf("center sonar lagging, %d trials, drop from %.1f m to %.1f m\n", trials, clearRange, wallRange);
+  printf("lag ms  wall    fusion        mean ms   max ms  detected\n");
+  for (int l = 0; l < 5; l++) {
+    for (int w = 0; w < 2; w++) {
+      Latency synchronized;
+      Latency latest;
+
+      for (int t = 0; t < trials; t++) {
+        double dropTime = 3 + period * uniform();
+        makeStream(dropTime, walls[w], lagging, lags[l], dropTime + 3, stream);
+        synchronized.add(detectSynchronized(stream), dropTime);
+        latest.add(detectLatest(stream), dropTime);
+      }
+
+      print(lags[l], wallNames[w], "synchronized", synchronized);
+      print(lags[l], wallNames[w], "latest", latest);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
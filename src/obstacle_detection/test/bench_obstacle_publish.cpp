@@ -0,0 +1,176 @@
+/*
+ * Messages per second on /obstacle from a simulated drive, replayed through
+ * the obstacle node's update path in both fusion modes: publishing every
+ * update as the node used to, against publishing when the code changes plus
+ * a keepalive while it does not. Each sonar reads open floor at 2.5 to 3 m
+ * with some noise and a stray echo now and then, and every few seconds an
+ * obstacle closes in on it and leaves again.
+ *
+ * usage: bench_obstacle_publish [seconds] [keepalive interval]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ObstacleEngine.h"
+
+namespace {
+
+const double period = 0.1;   // s, the sonars report at 10 Hz together
+const double jitter = 0.005; // s, of delivery
+const double maxAge = 0.5;   // s, the node's ~max_age default
+
+struct Reading {
+  ObstacleEngine::Sector sector;
+  float range;
+  double stamp;
+  double arrival;
+};
+
+bool byArrival(const Reading& a, const Reading& b) {
+  return a.arrival < b.arrival;
+}
+
+double uniform() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// one sonar's view of the drive, alternating open floor and an obstacle
+// closing in from 1.5 m
+class SonarTrack {
+  public:
+
+    SonarTrack() : obstacle(false), segmentEnd(uniform() * 10), segmentStart(0) {}
+
+    float range(double time) {
+      if (time >= segmentEnd) {
+        obstacle = !obstacle;
+        segmentStart = time;
+        segmentEnd = time + (obstacle ? 1 + 3 * uniform() : 5 + 15 * uniform());
+      }
+
+      if (uniform() < 0.01) return 0.1 + 2 * uniform();
+      float noise = 0.05 * (uniform() - 0.5);
+      if (!obstacle) return 2.75 + 0.25 * (uniform() - 0.5) + noise;
+
+      float closing = (time - segmentStart) / (segmentEnd - segmentStart);
+      return 1.5 - 1.3 * closing + noise;
+    }
+
+  private:
+
+    bool obstacle;
+    double segmentEnd;
+    double segmentStart;
+};
+
+void makeStream(double duration, std::vector<Reading>& stream) {
+  SonarTrack tracks[ObstacleEngine::SECTOR_COUNT];
+
+  stream.clear();
+  for (int round = 0; round * period < duration; round++) {
+    double stamp = round * period;
+    for (int i = 0; i < ObstacleEngine::SECTOR_COUNT; i++) {
+      Reading reading;
+      reading.sector = (ObstacleEngine::Sector)i;
+      reading.range = tracks[i].range(stamp);
+      reading.stamp = stamp;
+      reading.arrival = stamp + jitter * uniform();
+      stream.push_back(reading);
+    }
+  }
+  std::stable_sort(stream.begin(), stream.end(), byArrival);
+}
+
+// the publish decision at the end of the node's evaluate()
+struct CodePublisher {
+  double keepalive;
+  unsigned long updates;
+  unsigned long publishes;
+  unsigned long changes;
+  double lastPublish;
+  int prevCode;
+
+  CodePublisher(double keepalive) : keepalive(keepalive), updates(0), publishes(0), changes(0), lastPublish(0), prevCode(ObstacleEngine::CLEAR) {}
+
+  void evaluate(ObstacleEngine& engine, double now) {
+    int code = engine.getCode();
+    bool changed = code != prevCode;
+
+    updates++;
+    if (changed) changes++;
+    if (changed || now - lastPublish >= keepalive) {
+      publishes++;
+      lastPublish = now;
+    }
+    prevCode = code;
+  }
+};
+
+ObstacleEngine makeEngine() {
+  ObstacleEngine engine(5);
+  for (int i = 0; i < ObstacleEngine::SECTOR_COUNT; i++) {
+    engine.maxAge[i] = maxAge;
+  }
+  return engine;
+}
+
+void replayLatest(const std::vector<Reading>& stream, CodePublisher& publisher) {
+  ObstacleEngine engine = makeEngine();
+  for (size_t i = 0; i < stream.size(); i++) {
+    engine.addRange(stream[i].sector, stream[i].range, stream[i].stamp);
+    engine.expire(stream[i].arrival);
+    publisher.evaluate(engine, stream[i].arrival);
+  }
+}
+
+// each round is released once its last reading arrives
+void replaySynchronized(const std::vector<Reading>& stream, CodePublisher& publisher) {
+  ObstacleEngine engine = makeEngine();
+
+  std::vector<std::vector<Reading> > rounds(stream.size() / ObstacleEngine::SECTOR_COUNT + 1);
+  for (size_t i = 0; i < stream.size(); i++) {
+    std::vector<Reading>& round = rounds[(int)(stream[i].stamp / period + 0.5)];
+    round.push_back(stream[i]);
+    if (round.size() < ObstacleEngine::SECTOR_COUNT) continue;
+
+    Reading triple[ObstacleEngine::SECTOR_COUNT];
+    for (int j = 0; j < ObstacleEngine::SECTOR_COUNT; j++) {
+      triple[round[j].sector] = round[j];
+    }
+    for (int j = 0; j < ObstacleEngine::SECTOR_COUNT; j++) {
+      engine.addRange(triple[j].sector, triple[j].range, triple[j].stamp);
+    }
+    publisher.evaluate(engine, stream[i].arrival);
+  }
+}
+
+void print(const char* mode, const CodePublisher& publisher, double duration) {
+  printf("%-12s  %9.1f  %10.2f  %18.1f  %17.2f\n", mode, publisher.updates / duration, publisher.changes / duration,
+         publisher.updates / duration, publisher.publishes / duration);
+}
+
+}
+
+int main(int argc, char** argv) {
+  double duration = argc > 1 ? atof(argv[1]) : 3600;
+  double keepalive = argc > 2 ? atof(argv[2]) : 1;
+
+  srand(1);
+  std::vector<Reading> stream;
+  makeStream(duration, stream);
+
+  CodePublisher synchronized(keepalive);
+  CodePublisher latest(keepalive);
+  replaySynchronized(stream, synchronized);
+  replayLatest(stream, latest);
+
+  printf("%.0f s of sonar, %.1f s keepalive\n", duration, keepalive);
+  printf("fusion        updates/s  changes/s  every update msg/s  on change msg/s\n");
+  print("synchronized", synchronized, duration);
+  print("latest", latest, duration);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "ObstacleEngine.h"
+
+namespace {
+
+const double period = 0.1; // s, the sonars report at 10 Hz
+
+// the left and right sonars see nothing near
+void clearSides(ObstacleEngine& engine, double time) {
+  engine.addRange(ObstacleEngine::LEFT, 3, time);
+  engine.addRange(ObstacleEngine::RIGHT, 3, time);
+}
+
+}
+
+TEST(ObstacleEngine, MedianIgnoresASingleEcho) {
+  ObstacleEngine engine(5);
+
+  for (int i = 0; i < 10; i++) {
+    // a spurious return from the ground halfway through
+    float range = i == 5 ? 0.1 : 2;
+    engine.addRange(ObstacleEngine::CENTER, range, i * period);
+    clearSides(engine, i * period);
+
+    EXPECT_FLOAT_EQ(2, engine.getSector(ObstacleEngine::CENTER).distance) << "reading " << i;
+    EXPECT_EQ(ObstacleEngine::CLEAR, engine.getCode()) << "reading " << i;
+  }
+}
+
+TEST(ObstacleEngine, MedianOfAnEvenWindow) {
+  ObstacleEngine engine(4);
+  float ranges[] = {1.0, 1.4, 1.2, 1.1};
+
+  for (int i = 0; i < 4; i++) {
+    engine.addRange(ObstacleEngine::LEFT, ranges[i], i * period);
+  }
+
+  EXPECT_FLOAT_EQ(1.15, engine.getSector(ObstacleEngine::LEFT).distance);
+}
+
+TEST(ObstacleEngine, ClosingSpeedIsTheLeastSquaresSlope) {
+  ObstacleEngine engine(5);
+
+  // approaching at 0.5 m/s
+  for (int i = 0; i < 5; i++) {
+    engine.addRange(ObstacleEngine::CENTER, 2 - 0.05 * i, i * period);
+  }
+
+  const ObstacleEngine::SectorState& state = engine.getSector(ObstacleEngine::CENTER);
+  EXPECT_NEAR(0.5, state.closingSpeed, 1e-4);
+  EXPECT_FLOAT_EQ(1.9, state.distance);
+  EXPECT_NEAR(1.9 / 0.5, state.timeToCollision, 1e-3);
+
+  // receding is not closing
+  for (int i = 5; i < 10; i++) {
+    engine.addRange(ObstacleEngine::CENTER, 1.8 + 0.05 * (i - 5), i * period);
+  }
+  EXPECT_LT(engine.getSector(ObstacleEngine::CENTER).closingSpeed, 0);
+  EXPECT_FLOAT_EQ(-1, engine.getSector(ObstacleEngine::CENTER).timeToCollision);
+}
+
+// noisy readings around a steady approach, the fit should see through them
+TEST(ObstacleEngine, ClosingSpeedThroughNoise) {
+  ObstacleEngine engine(9);
+  float noise[] = {0.01, -0.02, 0.015, 0, -0.01, 0.02, -0.015, 0.005, -0.005};
+
+  for (int i = 0; i < 9; i++) {
+    engine.addRange(ObstacleEngine::RIGHT, 2 - 0.03 * i + noise[i], i * period);
+  }
+
+  EXPECT_NEAR(0.3, engine.getSector(ObstacleEngine::RIGHT).closingSpeed, 0.05);
+}
+
+TEST(ObstacleEngine, OutliersAreLeftOutOfTheFit) {
+  ObstacleEngine engine(5);
+
+  for (int i = 0; i < 5; i++) {
+    float range = 2 - 0.05 * i;
+    if (i == 2) range = 0.3;
+    engine.addRange(ObstacleEngine::CENTER, range, i * period);
+  }
+
+  const ObstacleEngine::SectorState& state = engine.getSector(ObstacleEngine::CENTER);
+  EXPECT_NEAR(0.5, state.closingSpeed, 1e-4);
+  EXPECT_FLOAT_EQ(4.0 / 5, state.confidence);
+}
+
+TEST(ObstacleEngine, ConfidenceGrowsWithTheWindow) {
+  ObstacleEngine engine(5);
+
+  EXPECT_FLOAT_EQ(0, engine.getSector(ObstacleEngine::LEFT).confidence);
+  for (int i = 0; i < 7; i++) {
+    engine.addRange(ObstacleEngine::LEFT, 1, i * period);
+    EXPECT_FLOAT_EQ(std::min(i + 1, 5) / 5.0, engine.getSector(ObstacleEngine::LEFT).confidence);
+  }
+
+  // fewer than three readings are not enough for a slope
+  ObstacleEngine fresh(5);
+  fresh.addRange(ObstacleEngine::LEFT, 2, 0);
+  fresh.addRange(ObstacleEngine::LEFT, 1, period);
+  EXPECT_FLOAT_EQ(0, fresh.getSector(ObstacleEngine::LEFT).closingSpeed);
+}
+
+TEST(ObstacleEngine, CollisionHysteresis) {
+  ObstacleEngine engine(1);
+
+  engine.addRange(ObstacleEngine::RIGHT, 0.65, 0);
+  EXPECT_EQ(ObstacleEngine::CLEAR, engine.getCode());
+  engine.addRange(ObstacleEngine::RIGHT, 0.55, period);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_RIGHT, engine.getCode());
+
+  // between the two thresholds it stays as it was
+  engine.addRange(ObstacleEngine::RIGHT, 0.65, 2 * period);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_RIGHT, engine.getCode());
+  engine.addRange(ObstacleEngine::RIGHT, 0.75, 3 * period);
+  EXPECT_EQ(ObstacleEngine::CLEAR, engine.getCode());
+
+  engine.addRange(ObstacleEngine::LEFT, 0.5, 4 * period);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_FRONT_LEFT, engine.getCode());
+  engine.addRange(ObstacleEngine::CENTER, 0.1, 4 * period);
+  EXPECT_EQ(ObstacleEngine::BLOCK_FRONT, engine.getCode());
+  engine.addRange(ObstacleEngine::CENTER, 0.14, 5 * period);
+  EXPECT_EQ(ObstacleEngine::BLOCK_FRONT, engine.getCode());
+  engine.addRange(ObstacleEngine::CENTER, 0.16, 6 * period);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_FRONT_LEFT, engine.getCode());
+}
+
+TEST(ObstacleEngine, GapStartsTheWindowOver) {
+  ObstacleEngine engine(5);
+
+  for (int i = 0; i < 5; i++) {
+    engine.addRange(ObstacleEngine::CENTER, 0.5, i * period);
+  }
+  engine.addRange(ObstacleEngine::CENTER, 2, 10);
+
+  EXPECT_FLOAT_EQ(2, engine.getSector(ObstacleEngine::CENTER).distance);
+  EXPECT_FLOAT_EQ(1.0 / 5, engine.getSector(ObstacleEngine::CENTER).confidence);
+}
+
+TEST(ObstacleEngine, ExpireForgetsQuietSonars) {
+  ObstacleEngine engine(5);
+  engine.maxAge[ObstacleEngine::LEFT] = 0.5;
+
+  engine.addRange(ObstacleEngine::LEFT, 0.3, 0);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_FRONT_LEFT, engine.getCode());
+
+  engine.expire(0.4);
+  EXPECT_EQ(ObstacleEngine::OBSTACLE_FRONT_LEFT, engine.getCode());
+
+  engine.expire(0.6);
+  EXPECT_EQ(ObstacleEngine::CLEAR, engine.getCode());
+  EXPECT_TRUE(std::isinf(engine.getSector(ObstacleEngine::LEFT).distance));
+  EXPECT_FLOAT_EQ(0, engine.getSector(ObstacleEngine::LEFT).confidence);
+  EXPECT_EQ(1u, engine.expired);
+}
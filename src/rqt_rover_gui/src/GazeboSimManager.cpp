@@ -1,5 +1,8 @@
 #include "GazeboSimManager.h"
 #include <QDir>
+#include <QFile>
+#include <gazebo_msgs/SpawnModel.h>
+#include <cmath>
 #include <string>
 #include <unistd.h>
 #include <iostream>
@@ -19,6 +22,7 @@ GazeboSimManager::GazeboSimManager()
     app_root_cstr = getenv(name);
     app_root = QString(app_root_cstr);
     custom_world_path = "";
+    writing_world_file = false;
 }
 
 // Load a default world path unless a custom path has been specified
@@ -97,6 +101,7 @@ void GazeboSimManager::cleanUpGazeboServer()
     gazebo_server_process->deleteLater();
     gazebo_server_process = NULL;
     model_locations.clear();
+    spawn_client.shutdown();
 }
 
 void GazeboSimManager::cleanUpGazeboClient()
@@ -178,43 +183,15 @@ QString GazeboSimManager::startRoverNode( QString rover_name )
 
 QString GazeboSimManager::addGroundPlane( QString ground_name )
 {
-    QString argument = QString("rosrun gazebo_ros spawn_model -sdf -file ")+app_root+"/simulation/models/" + ground_name + "/model.sdf -model " + ground_name;
-    QProcess sh;
-    sh.start("sh", QStringList() << "-c" << argument);
-
-    sh.waitForFinished();
-    QByteArray output = sh.readAll();
-    sh.close();
-
-    QString return_msg = "<br><font color='yellow'>" + output + "</font><br>";
-
-    return return_msg;
+    return spawnModel(ground_name, ground_name, 0, 0, 0, 0, 0, 0);
 }
 
 QString GazeboSimManager::addRover(QString rover_name, float x, float y, float z, float roll, float pitch, float yaw)
 {
     float rover_clearance = 0.45; //meters
-    model_locations.insert(make_tuple(x, y, rover_clearance));
-
-    QString argument = "rosrun gazebo_ros spawn_model -sdf -file "+app_root+"/simulation/models/" + rover_name + "/model.sdf "
-               + "-model " + rover_name
-               + " -x " + QString::number(x)
-               + " -y " + QString::number(y)
-               + " -z " + QString::number(z)
-               + " -R " + QString::number(roll)
-               + " -P " + QString::number(pitch)
-               + " -Y " + QString::number(yaw);
-
-    QProcess sh;
-    sh.start("sh", QStringList() << "-c" << argument);
-
-    sh.waitForFinished();
-    QByteArray output = sh.readAll();
-    sh.close();
-
-    QString return_msg = "<br><font color='yellow'>" + output + "</font><br>";
+    model_locations.insert(x, y, rover_clearance);
 
-    return return_msg;
+    return spawnModel(rover_name, rover_name, x, y, z, roll, pitch, yaw);
 }
 
 QString GazeboSimManager::removeRover( QString rover_name)
@@ -257,27 +234,74 @@ QString GazeboSimManager::addModel(QString model_name, QString unique_id, float
 
 QString GazeboSimManager::addModel(QString model_name, QString unique_id, float x, float y, float z, float roll, float pitch, float yaw, float clearance)
 {
-    model_locations.insert(make_tuple(x, y, clearance));
+    model_locations.insert(x, y, clearance);
 
-    QString argument = "rosrun gazebo_ros spawn_model -sdf -file "+app_root+"/simulation/models/" + model_name + "/model.sdf "
-            + "-model " + unique_id
-            + " -x "    + QString::number(x)
-            + " -y "    + QString::number(y)
-            + " -z "    + QString::number(z)
-            + " -R "    + QString::number(roll)
-            + " -P "    + QString::number(pitch)
-            + " -Y "    + QString::number(yaw);
+    return spawnModel(model_name, unique_id, x, y, z, roll, pitch, yaw);
+}
 
-    QProcess sh;
-    sh.start("sh", QStringList() << "-c" << argument);
+// Does what rosrun gazebo_ros spawn_model -sdf does, without starting a python
+// interpreter and reading the model file for every model. A round places 256
+// targets from the same model.sdf, so those savings are most of the time it takes
+// to build the world.
+QString GazeboSimManager::spawnModel(QString model_name, QString unique_id, float x, float y, float z, float roll, float pitch, float yaw)
+{
+    if (writing_world_file)
+    {
+        world_file_models += "    <include>\n"
+                "      <uri>model://" + model_name + "</uri>\n"
+                "      <name>" + unique_id + "</name>\n"
+                "      <pose>" + QString::number(x) + " " + QString::number(y) + " " + QString::number(z) + " "
+                + QString::number(roll) + " " + QString::number(pitch) + " " + QString::number(yaw) + "</pose>\n"
+                "    </include>\n";
+        return "";
+    }
 
-    sh.waitForFinished();
-    QByteArray output = sh.readAll();
-    sh.close();
+    map<QString, string>::iterator sdf = model_sdfs.find(model_name);
+    if (sdf == model_sdfs.end())
+    {
+        QFile file(app_root + "/simulation/models/" + model_name + "/model.sdf");
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            return "<br><font color='red'>Could not read " + file.fileName() + "</font><br>";
+        }
+        sdf = model_sdfs.insert(make_pair(model_name, QString(file.readAll()).toStdString())).first;
+    }
 
-    QString return_msg = "<br><font color='yellow'>" + output + "</font><br>";
+    // The connection is dropped when gazebo restarts, so it is made again then
+    if (!spawn_client.isValid())
+    {
+        if (!ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(60)))
+        {
+            return "<br><font color='red'>Gazebo's spawn_sdf_model service is not available, could not add " + unique_id + "</font><br>";
+        }
+        spawn_client = ros::NodeHandle().serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model", true);
+    }
 
-    return return_msg;
+    gazebo_msgs::SpawnModel spawn;
+    spawn.request.model_name = unique_id.toStdString();
+    spawn.request.model_xml = sdf->second;
+    spawn.request.robot_namespace = "/";
+    spawn.request.initial_pose.position.x = x;
+    spawn.request.initial_pose.position.y = y;
+    spawn.request.initial_pose.position.z = z;
+
+    // Fixed axis roll, pitch and yaw as a quaternion, the same as spawn_model
+    double cr = cos(roll/2), sr = sin(roll/2);
+    double cp = cos(pitch/2), sp = sin(pitch/2);
+    double cy = cos(yaw/2), sy = sin(yaw/2);
+    spawn.request.initial_pose.orientation.x = sr*cp*cy - cr*sp*sy;
+    spawn.request.initial_pose.orientation.y = cr*sp*cy + sr*cp*sy;
+    spawn.request.initial_pose.orientation.z = cr*cp*sy - sr*sp*cy;
+    spawn.request.initial_pose.orientation.w = cr*cp*cy + sr*sp*sy;
+
+    if (!spawn_client.call(spawn))
+    {
+        spawn_client.shutdown();
+        return "<br><font color='red'>Could not reach gazebo to add " + unique_id + "</font><br>";
+    }
+
+    QString color = spawn.response.success ? "yellow" : "red";
+    return "<br><font color='" + color + "'>" + QString::fromStdString(spawn.response.status_message) + "</font><br>";
 }
 
 QString GazeboSimManager::removeModel( QString model_name )
@@ -341,22 +365,12 @@ QString GazeboSimManager::applyForceToRover(QString rover_name, float x, float y
 // Takes the center x and center y positions of an object along with its clearance and checks if any objects are within that area
 bool GazeboSimManager::isLocationOccupied(float x, float y, float clearance)
 {
-    set<tuple<float, float, float>>::iterator it;
-    for (it = model_locations.begin(); it != model_locations.end(); it++)
-    {
-        float used_x = get<0>(*it);
-        float used_y = get<1>(*it);
-        float used_clearance = get<2>(*it);
-
-        // Distance between circle centers
-        float d = sqrt(pow(x-used_x,2)+pow(y-used_y,2));
-        if (d < clearance+used_clearance)
-        {
-            return true;
-        }
-    }
+    return model_locations.isOccupied(x, y, clearance);
+}
 
-    return false;
+const LocationGrid& GazeboSimManager::getModelLocations()
+{
+    return model_locations;
 }
 
 bool GazeboSimManager::isGazeboServerRunning()
@@ -375,6 +389,59 @@ void GazeboSimManager::setCustomWorldPath(QString path)
     custom_world_path = path;
 }
 
+QString GazeboSimManager::getCustomWorldPath()
+{
+    return custom_world_path;
+}
+
+void GazeboSimManager::startWorldFile()
+{
+    writing_world_file = true;
+    world_file_models = "";
+}
+
+bool GazeboSimManager::isWritingWorldFile()
+{
+    return writing_world_file;
+}
+
+QString GazeboSimManager::finishWorldFile(QString path)
+{
+    writing_world_file = false;
+
+    // The default world keeps the sun, the base ground plane and the physics settings in one place
+    QFile default_world(app_root + "/simulation/worlds/swarmathon.world");
+    if (!default_world.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return "<br><font color='red'>Could not read " + default_world.fileName() + "</font><br>";
+    }
+    QString world = default_world.readAll();
+
+    int world_end = world.lastIndexOf("</world>");
+    if (world_end < 0)
+    {
+        return "<br><font color='red'>No world element in " + default_world.fileName() + "</font><br>";
+    }
+    world.insert(world_end, world_file_models);
+    world_file_models = "";
+
+    // Written under another name and renamed so a half written file is never taken for a finished one
+    QFile file(path + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate) || file.write(world.toUtf8()) < 0)
+    {
+        return "<br><font color='red'>Could not write " + file.fileName() + "</font><br>";
+    }
+    file.close();
+
+    QFile::remove(path);
+    if (!QFile::rename(path + ".tmp", path))
+    {
+        return "<br><font color='red'>Could not write " + path + "</font><br>";
+    }
+
+    return "<br><font color='yellow'>Wrote the world to " + path + "</font><br>";
+}
+
 GazeboSimManager::~GazeboSimManager()
 {
     stopGazeboServer();
@@ -2,7 +2,11 @@
  * \brief   This class is intended as an interface to the Gazebo Simulation. This is acheived
  *          by calling shell commands. A single gazebo process is created that lasts the life of the
  *          program. Other opererations on the simulation are performed by creating a shell process that only
- *          exists as long as the command takes to complete.
+ *          exists as long as the command takes to complete. Models are the exception: they are spawned
+ *          through one persistent client of gazebo_ros's spawn service, with each model.sdf read from disk
+ *          once, rather than a rosrun spawn_model process per model.
+ *          Between startWorldFile and finishWorldFile models are written into a world file instead, so a whole
+ *          arena can be saved and gazebo started with it, which is much faster than spawning its models.
  * \author  Matthew Fricke
  * \date    November 11th 2015
  * \todo    A better solution would be to write a gazebo plugin that would pass on gazebo commands.
@@ -21,9 +25,11 @@
 #include <QProcess>
 #include <QString>
 #include <map>
-#include <set>
 #include <string>
-#include <tuple>
+
+#include <ros/ros.h>
+
+#include "LocationGrid.h"
 
 using namespace std;
 
@@ -50,11 +56,19 @@ public:
     QString moveRover(QString rover_name, float x, float y, float z);
     QString applyForceToRover(QString rover_name, float x, float y, float z, float duration);
     bool isLocationOccupied(float x, float y, float clearence);
+    const LocationGrid& getModelLocations();
     bool isGazeboServerRunning();
     bool isGazeboClientRunning();
     void cleanUpGazeboClient();
     void cleanUpGazeboServer();
     void setCustomWorldPath(QString path);
+    QString getCustomWorldPath();
+
+    // Models added after startWorldFile go into a world file rather than the running simulation.
+    // finishWorldFile writes it to path: the default world with those models in it.
+    void startWorldFile();
+    QString finishWorldFile(QString path);
+    bool isWritingWorldFile();
 
 private:
     QString app_root; // Path to the application root directory
@@ -64,10 +78,22 @@ private:
     map<QString, QProcess*> rover_processes;
 
     // Contains the positions of objects in the simulation and clearance value (the xy plane radius of the object)
-    // center x, center y, clearance
-    set< tuple<float, float, float> > model_locations;
+    LocationGrid model_locations;
 
     QString custom_world_path;
+
+    // Sends one model to gazebo through spawn_client, placed at x, y, z and turned by R, P, Y
+    QString spawnModel(QString model_name, QString unique_id, float x, float y, float z, float R, float P, float Y);
+
+    // Persistent connection to /gazebo/spawn_sdf_model, made on the first spawn after the server starts
+    ros::ServiceClient spawn_client;
+
+    // Contents of each model's model.sdf by model name
+    map<QString, string> model_sdfs;
+
+    // The models of the world file being written, as SDF include elements
+    bool writing_world_file;
+    QString world_file_models;
 };
 
 #endif // GazeboSimManager_H
@@ -0,0 +1,81 @@
+#include "LocationGrid.h"
+#include <cmath>
+
+using namespace std;
+
+LocationGrid::LocationGrid()
+{
+    count = 0;
+}
+
+long long LocationGrid::cellKey(int i, int j)
+{
+    return ((long long)i << 32) ^ (unsigned int)j;
+}
+
+void LocationGrid::insert(float x, float y, float clearance)
+{
+    map<float, Layer>::iterator layer = layers.find(clearance);
+    if (layer == layers.end())
+    {
+        layer = layers.insert(make_pair(clearance, Layer())).first;
+
+        // A zero clearance model, such as a wall, still needs cells of some size
+        layer->second.cell_size = max(2*clearance, 0.1f);
+    }
+
+    float cell_size = layer->second.cell_size;
+    int i = (int)floor(x/cell_size);
+    int j = (int)floor(y/cell_size);
+    layer->second.cells[cellKey(i, j)].push_back(make_pair(x, y));
+    count++;
+}
+
+// Takes the center x and center y positions of an object along with its clearance and checks if any objects are within that area
+bool LocationGrid::isOccupied(float x, float y, float clearance) const
+{
+    for (map<float, Layer>::const_iterator layer = layers.begin(); layer != layers.end(); layer++)
+    {
+        float reach = clearance + layer->first;
+        float cell_size = layer->second.cell_size;
+
+        int i_min = (int)floor((x - reach)/cell_size);
+        int i_max = (int)floor((x + reach)/cell_size);
+        int j_min = (int)floor((y - reach)/cell_size);
+        int j_max = (int)floor((y + reach)/cell_size);
+
+        for (int i = i_min; i <= i_max; i++)
+        {
+            for (int j = j_min; j <= j_max; j++)
+            {
+                unordered_map<long long, vector< pair<float, float> > >::const_iterator cell = layer->second.cells.find(cellKey(i, j));
+                if (cell == layer->second.cells.end()) continue;
+
+                for (size_t k = 0; k < cell->second.size(); k++)
+                {
+                    float dx = x - cell->second[k].first;
+                    float dy = y - cell->second[k].second;
+
+                    // Distance between circle centers, compared squared
+                    if (dx*dx + dy*dy < reach*reach)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void LocationGrid::clear()
+{
+    layers.clear();
+    count = 0;
+}
+
+size_t LocationGrid::size() const
+{
+    return count;
+}
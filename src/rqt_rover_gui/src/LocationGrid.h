@@ -0,0 +1,47 @@
+/*!
+ * \brief   Remembers where models have been placed in the simulation, each as a circle of some clearance radius,
+ *          and answers whether a new circle would overlap any of them.
+ *          Models are kept in one uniform grid per clearance radius, with cells twice that radius across, so a
+ *          query only looks at the few cells within reach of it rather than at every model placed. Placing N
+ *          targets costs about N queries instead of N squared distance checks.
+ * \class   LocationGrid
+ */
+
+#ifndef LocationGrid_H
+#define LocationGrid_H
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class LocationGrid
+{
+public:
+    LocationGrid();
+
+    void insert(float x, float y, float clearance);
+
+    // True when a circle of radius clearance at x, y overlaps a circle already inserted
+    bool isOccupied(float x, float y, float clearance) const;
+
+    void clear();
+    size_t size() const;
+
+private:
+    struct Layer
+    {
+        float cell_size;
+        unordered_map<long long, vector< pair<float, float> > > cells;
+    };
+
+    static long long cellKey(int i, int j);
+
+    // One layer per clearance radius, keyed by the radius
+    map<float, Layer> layers;
+    size_t count;
+};
+
+#endif // LocationGrid_H
@@ -0,0 +1,88 @@
+#include "PoissonDisk.h"
+#include <cmath>
+
+using namespace std;
+
+// Candidates tried around each point before it is retired, Bridson's suggested value
+static const int candidates_per_point = 30;
+
+void poissonDiskSample(float half_width, float spacing, const LocationGrid& occupied, float clearance,
+                       mt19937& rng, vector< pair<float,float> >& points)
+{
+    points.clear();
+    if (half_width <= 0 || spacing <= 0) return;
+
+    // Background grid with cells small enough to hold at most one point each
+    float cell_size = spacing/sqrt(2.0f);
+    int cells_across = (int)ceil(2*half_width/cell_size);
+    vector<int> cells(cells_across*cells_across, -1);
+
+    uniform_real_distribution<float> coordinate(-half_width, half_width);
+    uniform_real_distribution<float> unit(0, 1);
+
+    vector<int> active;
+
+    // The first point, anywhere that is free
+    for (int attempt = 0; attempt < 1000 && points.empty(); attempt++)
+    {
+        float x = coordinate(rng);
+        float y = coordinate(rng);
+        if (occupied.isOccupied(x, y, clearance)) continue;
+
+        int i = min((int)((x + half_width)/cell_size), cells_across - 1);
+        int j = min((int)((y + half_width)/cell_size), cells_across - 1);
+        cells[j*cells_across + i] = 0;
+        points.push_back(make_pair(x, y));
+        active.push_back(0);
+    }
+
+    while (!active.empty())
+    {
+        int index = (int)(unit(rng)*active.size());
+        if (index >= (int)active.size()) index = active.size() - 1;
+        pair<float,float> center = points[active[index]];
+
+        bool placed = false;
+        for (int k = 0; k < candidates_per_point && !placed; k++)
+        {
+            // Uniform over the annulus between spacing and twice spacing from the center
+            float angle = unit(rng)*2*M_PI;
+            float radius = spacing*sqrt(1 + 3*unit(rng));
+            float x = center.first + radius*cos(angle);
+            float y = center.second + radius*sin(angle);
+
+            if (x < -half_width || x >= half_width || y < -half_width || y >= half_width) continue;
+
+            int i = min((int)((x + half_width)/cell_size), cells_across - 1);
+            int j = min((int)((y + half_width)/cell_size), cells_across - 1);
+
+            // Any point closer than spacing is within two cells
+            bool too_close = false;
+            for (int jj = max(j - 2, 0); jj <= min(j + 2, cells_across - 1) && !too_close; jj++)
+            {
+                for (int ii = max(i - 2, 0); ii <= min(i + 2, cells_across - 1) && !too_close; ii++)
+                {
+                    int neighbour = cells[jj*cells_across + ii];
+                    if (neighbour < 0) continue;
+
+                    float dx = x - points[neighbour].first;
+                    float dy = y - points[neighbour].second;
+                    too_close = dx*dx + dy*dy < spacing*spacing;
+                }
+            }
+
+            if (too_close || occupied.isOccupied(x, y, clearance)) continue;
+
+            cells[j*cells_across + i] = points.size();
+            active.push_back(points.size());
+            points.push_back(make_pair(x, y));
+            placed = true;
+        }
+
+        if (!placed)
+        {
+            active[index] = active.back();
+            active.pop_back();
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef POISSONDISK_H
+#define POISSONDISK_H
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "LocationGrid.h"
+
+// Fills points with a Poisson-disk sample of the square from -half_width to half_width
+// on both axes: points at least spacing apart, spread until there is no room for another.
+// Points where a circle of radius clearance would overlap a model in occupied are left out.
+// This is Bridson's algorithm ("Fast Poisson disk sampling in arbitrary dimensions", 2007),
+// which runs in time linear in the number of points. The same rng state gives the same points.
+void poissonDiskSample(float half_width, float spacing, const LocationGrid& occupied, float clearance,
+                       std::mt19937& rng, std::vector< std::pair<float,float> >& points);
+
+#endif // POISSONDISK_H
@@ -24,9 +24,11 @@
 #include <QLCDNumber>
 #include <QFileDialog>
 #include <QComboBox>
+#include <QTime>
 #include <std_msgs/Float32.h>
 #include <std_msgs/UInt8.h>
 #include <algorithm>
+#include <ctime>
 
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -35,6 +37,7 @@
 //#include <regex> // For regex expressions
 
 #include "MapData.h"
+#include "PoissonDisk.h"
 
 #include <cv_bridge/cv_bridge.h>
 #include <opencv/cv.h>
@@ -85,6 +88,8 @@ namespace rqt_rover_gui
 
     barrier_clearance = 0.5; // Used to prevent targets being placed to close to walls
 
+    target_seed = 0;
+
     map_data = new MapData();
   }
 
@@ -1550,145 +1555,91 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
         return;
     }
 
-    QProcess* sim_server_process = sim_mgr.startGazeboServer();
-    connect(sim_server_process, SIGNAL(finished(int)), this, SLOT(gazeboServerFinishedEventHandler()));
-
-
     if (ui.final_radio_button->isChecked())
     {
          arena_dim = 23.1;
-         addFinalsWalls();
     }
     else
     {
         arena_dim = 15;
-        addPrelimsWalls();
     }
 
     emit sendInfoLogMessage(QString("Set arena size to ")+QString::number(arena_dim)+"x"+QString::number(arena_dim));
 
-    if (ui.texture_combobox->currentText() == "Gravel")
+    int n_rovers_created = 0;
+    int n_rovers = 3;
+    if (ui.final_radio_button->isChecked()) n_rovers = 6;
+
+    // If the user chose to override the number of rovers to add to the simulation read the selected value
+    if (ui.override_num_rovers_checkbox->isChecked()) n_rovers = ui.custom_num_rovers_combobox->currentText().toInt();
+
+    // The same seed places the same targets, a new one is picked when none is set
+    bool seed_given = ros::param::has("/rover_gui/target_seed");
+    ros::param::param("/rover_gui/target_seed", target_seed, (int)(time(NULL) % 1000000));
+    target_rng.seed(target_seed);
+
+    // Unless the user picked a world file, the arena is written into one and gazebo started with it. With a
+    // seed given the file is kept, and building the same arena again starts gazebo straight from it.
+    QString world_path = sim_mgr.getCustomWorldPath();
+    bool build_world = true;
+    if (world_path == "")
     {
-    emit sendInfoLogMessage("Adding gravel ground plane...");
-    return_msg = sim_mgr.addGroundPlane("mars_ground_plane");
-    emit sendInfoLogMessage(return_msg);
+        world_path = cachedWorldPath(n_rovers, seed_given);
+
+        if (seed_given && QFile::exists(world_path))
+        {
+            emit sendInfoLogMessage("Using the cached world " + world_path);
+            build_world = false;
+        }
+        else
+        {
+            sim_mgr.startWorldFile();
+        }
     }
-    else if (ui.texture_combobox->currentText() == "KSC Concrete")
+    else
     {
-    emit sendInfoLogMessage("Adding concrete ground plane...");
-    return_msg = sim_mgr.addGroundPlane("concrete_ground_plane");
-    emit sendInfoLogMessage(return_msg);
+        QProcess* sim_server_process = sim_mgr.startGazeboServer(world_path);
+        connect(sim_server_process, SIGNAL(finished(int)), this, SLOT(gazeboServerFinishedEventHandler()));
     }
-    else if (ui.texture_combobox->currentText() == "Car park")
+
+    QString rovers[6] = {"achilles", "aeneas", "ajax", "diomedes", "hector", "paris"};
+
+    // How long building the world takes, most of it placing the targets
+    QTime world_build_time;
+    world_build_time.start();
+
+    if (build_world)
     {
-    emit sendInfoLogMessage("Adding carpark ground plane...");
-    return_msg = sim_mgr.addGroundPlane("carpark_ground_plane");
-    emit sendInfoLogMessage(return_msg);
+        buildWorld(rovers, n_rovers);
+
+        if (sim_mgr.isWritingWorldFile())
+        {
+            emit sendInfoLogMessage(sim_mgr.finishWorldFile(world_path));
+        }
     }
-    else
+
+    if (!sim_mgr.isGazeboServerRunning())
     {
-        emit sendInfoLogMessage("Unknown ground plane...");
+        QProcess* sim_server_process = sim_mgr.startGazeboServer(world_path);
+        connect(sim_server_process, SIGNAL(finished(int)), this, SLOT(gazeboServerFinishedEventHandler()));
     }
 
+    emit sendInfoLogMessage("Built the world in " + QString::number(world_build_time.elapsed()/1000.0, 'f', 1) + " seconds");
 
-    emit sendInfoLogMessage("Adding collection disk...");
-    float collection_disk_radius = 0.5; // meters
-    sim_mgr.addModel("collection_disk", "collection_disk", 0, 0, 0, collection_disk_radius);
     score_subscriber = nh.subscribe("/collectionZone/score", 10, &RoverGUIPlugin::scoreEventHandler, this);
     simulation_timer_subscriber = nh.subscribe("/clock", 10, &RoverGUIPlugin::simulationTimerEventHandler, this);
 
-    int n_rovers_created = 0;
-    int n_rovers = 3;
-    if (ui.final_radio_button->isChecked()) n_rovers = 6;
-
-    // If the user chose to override the number of rovers to add to the simulation read the selected value
-    if (ui.override_num_rovers_checkbox->isChecked()) n_rovers = ui.custom_num_rovers_combobox->currentText().toInt();
-
     QProgressDialog progress_dialog;
-    progress_dialog.setWindowTitle("Creating rovers");
+    progress_dialog.setWindowTitle("Starting rovers");
     progress_dialog.setCancelButton(NULL); // no cancel button
     progress_dialog.setWindowModality(Qt::ApplicationModal);
     progress_dialog.setWindowFlags(progress_dialog.windowFlags() | Qt::WindowStaysOnTopHint);
     progress_dialog.resize(500, 50);
     progress_dialog.show();
 
-    QString rovers[6] = {"achilles", "aeneas", "ajax", "diomedes", "hector", "paris"};
-
-    /**
-     * The distance to the rover from a corner position is calculated differently
-     * than the distance to a cardinal position.
-     *
-     * The cardinal direction rovers are a straightforward calculation where:
-     *     a = the distance to the edge of the collection zone
-     *         i.e., 1/2 of the collection zone square side length
-     *     b = the 50cm distance required by the rules for placing the rover
-     *     c = offset for the simulation for the center of the rover (30cm)
-     *         i.e., the rover position is at the center of its body
-     *
-     * The corner rovers use trigonometry to calculate the distance where each
-     * value of d, e, and f, are the legs to an isosceles right triangle. In
-     * other words, we are calculating and summing X and Y offsets to position
-     * the rover.
-     *     d = a
-     *     e = xy offset to move the rover 50cm from the corner of the collection zone
-     *     f = xy offset to move the rover 30cm to account for its position being
-     *         calculated at the center of its body
-     *
-     *                       *  *          d = 0.508m
-     *                     *      *        e = 0.354m
-     *                   *          *    + f = 0.212m
-     *                 *     /*     *    ------------
-     *                 *    / | f *            1.072m
-     *                   * /--| *
-     *                    /* *
-     *                   / | e
-     *                  /--|
-     *     *************
-     *     *          /|
-     *     *         / |
-     *     *        /  | d                 a = 0.508m
-     *     *       /   |     *********     b = 0.500m
-     *     *      /    |     *       *   + c = 0.300m
-     *     *     *-----|-----*---*   *   ------------
-     *     *        a  *  b  * c     *         1.308m
-     *     *           *     *********
-     *     *           *
-     *     *           *
-     *     *           *
-     *     *************
-     */
-    QPointF rover_positions[6] =
-    {
-      /* cardinal rovers: North, East, South, West */
-      QPointF(-1.308,  0.000), // 1.308 = distance_from_center_to_edge_of_collection_zone
-      QPointF( 0.000, -1.308), //             + 50 cm distance to rover
-      QPointF( 1.308,  0.000), //             + 30 cm distance_from_center_of_rover_to_edge_of_rover
-      QPointF( 0.000,  1.308), // 1.308m = 0.508m + 0.5m + 0.3m
-
-      /* corner rovers: Northeast, Southwest */
-      QPointF( 1.072,  1.072), // 1.072 = diagonal_distance_from_center_to_edge_of_collection_zone
-      QPointF(-1.072, -1.072)  //             + diagonal_distance_to_move_50cm
-    };                         //             + diagonal_distance_to_move_30cm
-                               // 1.072m = 0.508 + 0.354 + 0.212
-
-    /* In this case, the yaw is the value that turns rover "left" and "right" */
-    float rover_yaw[6] =
-    {
-       0.000, //  0.00 * PI
-       1.571, //  0.50 * PI
-      -3.142, // -1.00 * PI
-      -1.571, // -0.50 * PI
-      -2.356, // -0.75 * PI
-       0.785  //  0.25 * PI
-    };
-      
-    // Add rovers to the simulation and start the associated ROS nodes
+    // Start the ROS nodes of the rovers in the world
     for (int i = 0; i < n_rovers; i++)
     {
-        emit sendInfoLogMessage("Adding rover "+rovers[i]+"...");
-        return_msg = sim_mgr.addRover(rovers[i], rover_positions[i].x(), rover_positions[i].y(), 0, 0, 0, rover_yaw[i]);
-        emit sendInfoLogMessage(return_msg);
-
         emit sendInfoLogMessage("Starting rover node for "+rovers[i]+"...");
         return_msg = sim_mgr.startRoverNode(rovers[i]);
         emit sendInfoLogMessage(return_msg);
@@ -1697,25 +1648,6 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
         qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
     }
 
-   if (ui.powerlaw_distribution_radio_button->isChecked())
-   {
-       emit sendInfoLogMessage("Adding powerlaw distribution of targets...");
-       return_msg = addPowerLawTargets();
-       emit sendInfoLogMessage(return_msg);
-   }
-   else if (ui.uniform_distribution_radio_button->isChecked())
-   {
-       emit sendInfoLogMessage("Adding uniform distribution of targets...");
-       return_msg = addUniformTargets();
-       emit sendInfoLogMessage(return_msg);
-   }
-   else if (ui.clustered_distribution_radio_button->isChecked())
-   {
-       emit sendInfoLogMessage("Adding clustered distribution of targets...");
-       return_msg = addClusteredTargets();
-       emit sendInfoLogMessage(return_msg);
-   }
-
    // add walls given nw corner (x,y) and height and width (in meters)
 
    //addWalls(-arena_dim/2, -arena_dim/2, arena_dim, arena_dim);
@@ -1948,6 +1880,187 @@ QString RoverGUIPlugin::stopROSJoyNode()
     }
 }
 
+// Adds the walls, ground plane, collection disk, rovers and targets to the simulation, or to the world
+// file being written
+void RoverGUIPlugin::buildWorld(QString rovers[], int n_rovers)
+{
+    QString return_msg;
+
+    if (ui.final_radio_button->isChecked())
+    {
+         addFinalsWalls();
+    }
+    else
+    {
+        addPrelimsWalls();
+    }
+
+    if (groundPlaneModel() != "")
+    {
+        emit sendInfoLogMessage("Adding " + ui.texture_combobox->currentText() + " ground plane...");
+        return_msg = sim_mgr.addGroundPlane(groundPlaneModel());
+        emit sendInfoLogMessage(return_msg);
+    }
+    else
+    {
+        emit sendInfoLogMessage("Unknown ground plane...");
+    }
+
+    emit sendInfoLogMessage("Adding collection disk...");
+    float collection_disk_radius = 0.5; // meters
+    sim_mgr.addModel("collection_disk", "collection_disk", 0, 0, 0, collection_disk_radius);
+
+    QProgressDialog progress_dialog;
+    progress_dialog.setWindowTitle("Creating rovers");
+    progress_dialog.setCancelButton(NULL); // no cancel button
+    progress_dialog.setWindowModality(Qt::ApplicationModal);
+    progress_dialog.setWindowFlags(progress_dialog.windowFlags() | Qt::WindowStaysOnTopHint);
+    progress_dialog.resize(500, 50);
+    progress_dialog.show();
+
+    /**
+     * The distance to the rover from a corner position is calculated differently
+     * than the distance to a cardinal position.
+     *
+     * The cardinal direction rovers are a straightforward calculation where:
+     *     a = the distance to the edge of the collection zone
+     *         i.e., 1/2 of the collection zone square side length
+     *     b = the 50cm distance required by the rules for placing the rover
+     *     c = offset for the simulation for the center of the rover (30cm)
+     *         i.e., the rover position is at the center of its body
+     *
+     * The corner rovers use trigonometry to calculate the distance where each
+     * value of d, e, and f, are the legs to an isosceles right triangle. In
+     * other words, we are calculating and summing X and Y offsets to position
+     * the rover.
+     *     d = a
+     *     e = xy offset to move the rover 50cm from the corner of the collection zone
+     *     f = xy offset to move the rover 30cm to account for its position being
+     *         calculated at the center of its body
+     *
+     *                       *  *          d = 0.508m
+     *                     *      *        e = 0.354m
+     *                   *          *    + f = 0.212m
+     *                 *     /*     *    ------------
+     *                 *    / | f *            1.072m
+     *                   * /--| *
+     *                    /* *
+     *                   / | e
+     *                  /--|
+     *     *************
+     *     *          /|
+     *     *         / |
+     *     *        /  | d                 a = 0.508m
+     *     *       /   |     *********     b = 0.500m
+     *     *      /    |     *       *   + c = 0.300m
+     *     *     *-----|-----*---*   *   ------------
+     *     *        a  *  b  * c     *         1.308m
+     *     *           *     *********
+     *     *           *
+     *     *           *
+     *     *           *
+     *     *************
+     */
+    QPointF rover_positions[6] =
+    {
+      /* cardinal rovers: North, East, South, West */
+      QPointF(-1.308,  0.000), // 1.308 = distance_from_center_to_edge_of_collection_zone
+      QPointF( 0.000, -1.308), //             + 50 cm distance to rover
+      QPointF( 1.308,  0.000), //             + 30 cm distance_from_center_of_rover_to_edge_of_rover
+      QPointF( 0.000,  1.308), // 1.308m = 0.508m + 0.5m + 0.3m
+
+      /* corner rovers: Northeast, Southwest */
+      QPointF( 1.072,  1.072), // 1.072 = diagonal_distance_from_center_to_edge_of_collection_zone
+      QPointF(-1.072, -1.072)  //             + diagonal_distance_to_move_50cm
+    };                         //             + diagonal_distance_to_move_30cm
+                               // 1.072m = 0.508 + 0.354 + 0.212
+
+    /* In this case, the yaw is the value that turns rover "left" and "right" */
+    float rover_yaw[6] =
+    {
+       0.000, //  0.00 * PI
+       1.571, //  0.50 * PI
+      -3.142, // -1.00 * PI
+      -1.571, // -0.50 * PI
+      -2.356, // -0.75 * PI
+       0.785  //  0.25 * PI
+    };
+      
+    // Add rovers to the simulation
+    for (int i = 0; i < n_rovers; i++)
+    {
+        emit sendInfoLogMessage("Adding rover "+rovers[i]+"...");
+        return_msg = sim_mgr.addRover(rovers[i], rover_positions[i].x(), rover_positions[i].y(), 0, 0, 0, rover_yaw[i]);
+        emit sendInfoLogMessage(return_msg);
+
+        progress_dialog.setValue((i + 1)*100.0f/n_rovers);
+        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+    }
+
+    emit sendInfoLogMessage("Placing targets with seed " + QString::number(target_seed) + " (rosparam set /rover_gui/target_seed " + QString::number(target_seed) + " to repeat this layout)");
+
+    if (ui.powerlaw_distribution_radio_button->isChecked())
+    {
+        emit sendInfoLogMessage("Adding powerlaw distribution of targets...");
+        return_msg = addPowerLawTargets();
+        emit sendInfoLogMessage(return_msg);
+    }
+    else if (ui.uniform_distribution_radio_button->isChecked())
+    {
+        emit sendInfoLogMessage("Adding uniform distribution of targets...");
+        return_msg = addUniformTargets();
+        emit sendInfoLogMessage(return_msg);
+    }
+    else if (ui.clustered_distribution_radio_button->isChecked())
+    {
+        emit sendInfoLogMessage("Adding clustered distribution of targets...");
+        return_msg = addClusteredTargets();
+        emit sendInfoLogMessage(return_msg);
+    }
+}
+
+// The gazebo model of the ground texture selected
+QString RoverGUIPlugin::groundPlaneModel()
+{
+    if (ui.texture_combobox->currentText() == "Gravel") return "mars_ground_plane";
+    if (ui.texture_combobox->currentText() == "KSC Concrete") return "concrete_ground_plane";
+    if (ui.texture_combobox->currentText() == "Car park") return "carpark_ground_plane";
+    return "";
+}
+
+// Where the world built from the current settings is kept. Everything that changes the world is in the
+// name: the target distribution, seed, round, number of rovers and ground. Worlds without a given seed
+// are never built twice, so they share one file.
+QString RoverGUIPlugin::cachedWorldPath(int n_rovers, bool seed_given)
+{
+    QString directory = QDir::homePath() + "/.ros/rover_gui_worlds";
+    QDir().mkpath(directory);
+
+    if (!seed_given) return directory + "/unseeded.world";
+
+    QString distribution = "none";
+    if (ui.powerlaw_distribution_radio_button->isChecked())
+    {
+        distribution = "powerlaw";
+    }
+    else if (ui.uniform_distribution_radio_button->isChecked())
+    {
+        string layout;
+        ros::param::param("/rover_gui/uniform_targets", layout, string("random"));
+        distribution = layout == "poisson" ? "uniform_poisson" : "uniform";
+    }
+    else if (ui.clustered_distribution_radio_button->isChecked())
+    {
+        distribution = "clustered";
+    }
+
+    QString round = ui.final_radio_button->isChecked() ? "final" : "prelim";
+    QString ground = groundPlaneModel() == "" ? "none" : groundPlaneModel();
+
+    return directory + "/" + distribution + "_seed" + QString::number(target_seed) + "_" + round + "_"
+            + QString::number(n_rovers) + "rovers_" + ground + ".world";
+}
+
 QString RoverGUIPlugin::addUniformTargets()
 {
     QProgressDialog progress_dialog;
@@ -1973,15 +2086,39 @@ QString RoverGUIPlugin::addUniformTargets()
     progress_dialog.setValue(0.0);
     qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
+    // With /rover_gui/uniform_targets set to poisson the targets are still spread evenly at random, but no
+    // closer than a minimum spacing, so the clumps and gaps of independent placement go away (blue noise)
+    string layout;
+    ros::param::param("/rover_gui/uniform_targets", layout, string("random"));
+
+    vector< pair<float,float> > poisson_points;
+    if (layout == "poisson")
+    {
+        // A spacing that leaves room for about a third more points than are needed, so the targets are a
+        // random subset of a complete sample and not the part of it that happened to grow first
+        float spacing = max(sqrt(0.6f*4*d*d/(1.25f*256)), 2*target_cluster_size_1_clearance);
+        poissonDiskSample(d, spacing, sim_mgr.getModelLocations(), target_cluster_size_1_clearance, target_rng, poisson_points);
+        shuffle(poisson_points.begin(), poisson_points.end(), target_rng);
+        emit sendInfoLogMessage("Poisson-disk layout with " + QString::number(spacing, 'f', 2) + " m spacing");
+    }
+
     for (int i = 0; i < 256; i++)
     {
-        do
+        if ((size_t)i < poisson_points.size())
         {
-            emit sendInfoLogMessage("Tried to place target "+QString::number(0)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y) + "...");
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+            proposed_x = poisson_points[i].first;
+            proposed_y = poisson_points[i].second;
+        }
+        else
+        {
+            do
+            {
+                emit sendInfoLogMessage("Tried to place target "+QString::number(0)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y) + "...");
+                proposed_x = randomCoordinate(d);
+                proposed_y = randomCoordinate(d);
+            }
+            while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_1_clearance));
         }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_1_clearance));
 
         emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
         output = sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(i), proposed_x, proposed_y, 0, target_cluster_size_1_clearance);
@@ -1994,6 +2131,11 @@ QString RoverGUIPlugin::addUniformTargets()
     return output;
 }
 
+float RoverGUIPlugin::randomCoordinate(float d)
+{
+    return d - uniform_real_distribution<float>(0, 2*d)(target_rng);
+}
+
 QString RoverGUIPlugin::addClusteredTargets()
 {
     QProgressDialog progress_dialog;
@@ -2021,8 +2163,8 @@ QString RoverGUIPlugin::addClusteredTargets()
         do
         {
             emit sendInfoLogMessage("Tried to place cluster "+QString::number(i)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+            proposed_x = randomCoordinate(d);
+            proposed_y = randomCoordinate(d);
         }
         while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_64_clearance));
 
@@ -2079,8 +2221,8 @@ QString RoverGUIPlugin::addPowerLawTargets()
     do
     {
         emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-        proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-        proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+        proposed_x = randomCoordinate(d);
+        proposed_y = randomCoordinate(d);
     }
     while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_64_clearance));
 
@@ -2108,8 +2250,8 @@ QString RoverGUIPlugin::addPowerLawTargets()
     {
         do
         {
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+            proposed_x = randomCoordinate(d);
+            proposed_y = randomCoordinate(d);
             emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
         }
         while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_16_clearance));
@@ -2141,8 +2283,8 @@ QString RoverGUIPlugin::addPowerLawTargets()
         do
         {
             emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+            proposed_x = randomCoordinate(d);
+            proposed_y = randomCoordinate(d);
         }
         while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_4_clearance));
 
@@ -2173,8 +2315,8 @@ QString RoverGUIPlugin::addPowerLawTargets()
         do
         {
             emit sendInfoLogMessage("Tried to place target "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
+            proposed_x = randomCoordinate(d);
+            proposed_y = randomCoordinate(d);
         }
         while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_1_clearance));
 
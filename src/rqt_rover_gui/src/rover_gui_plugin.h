@@ -50,6 +50,7 @@
 #include <map>
 #include <set>
 #include <mutex>
+#include <random>
 #include <ublox_msgs/NavSOL.h>
 
 //ROS msg types
@@ -129,6 +130,12 @@ namespace rqt_rover_gui {
     QString addClusteredTargets();
     QString addFinalsWalls();
     QString addPrelimsWalls();
+    void buildWorld(QString rovers[], int n_rovers);
+    QString groundPlaneModel();
+    QString cachedWorldPath(int n_rovers, bool seed_given);
+
+    // A coordinate drawn uniformly from -d to d with target_rng
+    float randomCoordinate(float d);
 
 
    // void targetDetectedEventHandler( rover_onboard_target_detection::ATag tagInfo ); //rover_onboard_target_detection::ATag msg );
@@ -269,6 +276,11 @@ namespace rqt_rover_gui {
     float collection_disk_clearance;
     float barrier_clearance;
 
+    // Every random target position is drawn from this, seeded from the /rover_gui/target_seed
+    // parameter when the simulation is built so a layout can be placed again
+    mt19937 target_rng;
+    int target_seed;
+
     unsigned long obstacle_call_count;
 
     // Joystick commands to ROS gripper command interface
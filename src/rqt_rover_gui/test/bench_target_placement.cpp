@@ -0,0 +1,211 @@
+/*
+ * Times placing single targets in a round arena the way the gui does: a
+ * uniform proposal redrawn while it overlaps a model already placed. The
+ * linear scan over every model is what GazeboSimManager::isLocationOccupied()
+ * did before LocationGrid. Both are fed the same proposals and must place
+ * the targets in the same spots. The Poisson-disk layout is timed after.
+ *
+ * Last, the parts of building a round of 256 uniform targets that run
+ * outside Gazebo, before and after: placing them, and reading model.sdf for
+ * every cube against reading it once. Spawning the models themselves needs a
+ * running Gazebo and is not timed here.
+ *
+ * usage: bench_target_placement [model.sdf]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "LocationGrid.h"
+#include "PoissonDisk.h"
+
+using namespace std;
+
+namespace
+{
+
+// the arena of the final round, less the clearance kept from the walls
+const float arena_size = 23.1;
+const float half_width = arena_size/2 - (0.5 + 0.1);
+const float target_clearance = 0.1;
+
+double now()
+{
+    timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 1e-6;
+}
+
+class LinearScan
+{
+public:
+    void insert(float x, float y, float clearance)
+    {
+        model_locations.insert(make_tuple(x, y, clearance));
+    }
+
+    bool isOccupied(float x, float y, float clearance) const
+    {
+        set<tuple<float, float, float>>::const_iterator it;
+        for (it = model_locations.begin(); it != model_locations.end(); it++)
+        {
+            float d = sqrt(pow(x-get<0>(*it),2)+pow(y-get<1>(*it),2));
+            if (d < clearance+get<2>(*it))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    set<tuple<float, float, float>> model_locations;
+};
+
+string readFile(const char* path)
+{
+    ifstream file(path);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+struct Placement
+{
+    double seconds;
+    long proposals;
+    vector< pair<float,float> > targets;
+};
+
+// the collection disk and six rovers around it, then count targets
+template <class Locations>
+Placement place(Locations& locations, int count)
+{
+    float rover_x[] = {-1.308, 0, 1.308, 0, 1.072, -1.072};
+    float rover_y[] = {0, -1.308, 0, 1.308, 1.072, -1.072};
+
+    locations.insert(0, 0, 0.5);
+    for (int i = 0; i < 6; i++)
+    {
+        locations.insert(rover_x[i], rover_y[i], 0.4);
+    }
+
+    Placement placement;
+    placement.proposals = 0;
+    mt19937 rng(7);
+    uniform_real_distribution<float> position(0, 2*half_width);
+
+    double start = now();
+    for (int i = 0; i < count; i++)
+    {
+        float x, y;
+        do
+        {
+            x = half_width - position(rng);
+            y = half_width - position(rng);
+            placement.proposals++;
+        }
+        while (locations.isOccupied(x, y, target_clearance));
+
+        locations.insert(x, y, target_clearance);
+        placement.targets.push_back(make_pair(x, y));
+    }
+    placement.seconds = now() - start;
+
+    return placement;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const char* model_sdf = argc > 1 ? argv[1] : SIMULATION_DIR "/models/at0/model.sdf";
+
+    int counts[] = {256, 1024, 4096};
+
+    printf("targets  proposals  linear scan ms  location grid ms  speedup\n");
+    for (int i = 0; i < 3; i++)
+    {
+        LinearScan scan;
+        LocationGrid grid;
+        Placement linear = place(scan, counts[i]);
+        Placement gridded = place(grid, counts[i]);
+
+        if (linear.targets != gridded.targets)
+        {
+            fprintf(stderr, "the grid placed %d targets differently from the linear scan\n", counts[i]);
+            return EXIT_FAILURE;
+        }
+
+        printf("%7d  %9ld  %14.2f  %16.2f  %6.0fx\n", counts[i], linear.proposals,
+               linear.seconds * 1e3, gridded.seconds * 1e3, linear.seconds / gridded.seconds);
+    }
+
+    printf("\ntargets  spacing m  points  poisson ms\n");
+    for (int i = 0; i < 3; i++)
+    {
+        LocationGrid occupied;
+        occupied.insert(0, 0, 0.5);
+
+        // as rover_gui_plugin picks it, room for about a third more points than needed
+        float spacing = max(sqrt(0.6f*4*half_width*half_width/(1.25f*counts[i])), 2*target_clearance);
+        mt19937 rng(7);
+        vector< pair<float,float> > points;
+
+        double start = now();
+        poissonDiskSample(half_width, spacing, occupied, target_clearance, rng, points);
+        double elapsed = now() - start;
+
+        printf("%7d  %9.3f  %6zu  %10.2f\n", counts[i], spacing, points.size(), elapsed * 1e3);
+    }
+
+    // a uniform round as addUniformTargets() builds it, the model xml handed
+    // to each spawn the way spawn_model read it from disk for every cube, or
+    // the way GazeboSimManager now reads it once and copies it
+    const int round_targets = 256;
+    if (readFile(model_sdf).empty())
+    {
+        fprintf(stderr, "could not read %s\n", model_sdf);
+        return EXIT_FAILURE;
+    }
+
+    LinearScan scan;
+    LocationGrid grid;
+    Placement linear = place(scan, round_targets);
+    Placement gridded = place(grid, round_targets);
+
+    size_t bytes = 0;
+    double start = now();
+    for (int i = 0; i < round_targets; i++)
+    {
+        bytes += readFile(model_sdf).size();
+    }
+    double reads = now() - start;
+
+    start = now();
+    string cached = readFile(model_sdf);
+    for (int i = 0; i < round_targets; i++)
+    {
+        string model_xml = cached;
+        bytes += model_xml.size();
+    }
+    double cached_reads = now() - start;
+
+    printf("\n%d targets  placement ms  model.sdf ms\n", round_targets);
+    printf("before       %12.2f  %12.2f\n", linear.seconds * 1e3, reads * 1e3);
+    printf("after        %12.2f  %12.2f\n", gridded.seconds * 1e3, cached_reads * 1e3);
+    fprintf(stderr, "%zu bytes of model xml\n", bytes);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "LocationGrid.h"
+#include "PoissonDisk.h"
+
+using namespace std;
+
+namespace
+{
+
+// GazeboSimManager::isLocationOccupied() as it was before LocationGrid
+class LinearScan
+{
+public:
+    void insert(float x, float y, float clearance)
+    {
+        model_locations.insert(make_tuple(x, y, clearance));
+    }
+
+    bool isOccupied(float x, float y, float clearance) const
+    {
+        set<tuple<float, float, float>>::const_iterator it;
+        for (it = model_locations.begin(); it != model_locations.end(); it++)
+        {
+            float used_x = get<0>(*it);
+            float used_y = get<1>(*it);
+            float used_clearance = get<2>(*it);
+
+            // Distance between circle centers
+            float d = sqrt(pow(x-used_x,2)+pow(y-used_y,2));
+            if (d < clearance+used_clearance)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    set<tuple<float, float, float>> model_locations;
+};
+
+}
+
+TEST(LocationGrid, MatchesLinearScan)
+{
+    LocationGrid grid;
+    LinearScan scan;
+    mt19937 rng(11);
+    uniform_real_distribution<float> position(-11.55, 11.55);
+
+    // the models the gui places: the collection disk, walls, rovers, cubes
+    float clearances[] = {0.5, 0, 0.45, 0.1};
+    grid.insert(0, 0, 0.5);
+    scan.insert(0, 0, 0.5);
+
+    int occupied = 0;
+    for (int i = 0; i < 3000; i++)
+    {
+        float clearance = clearances[1 + i % 3];
+        float x = position(rng);
+        float y = position(rng);
+
+        bool expected = scan.isOccupied(x, y, clearance);
+        ASSERT_EQ(expected, grid.isOccupied(x, y, clearance)) << "query " << i << " at " << x << ", " << y;
+        if (expected) occupied++;
+
+        // placed the way the rejection sampling does, only where there is room
+        if (!expected)
+        {
+            grid.insert(x, y, clearance);
+            scan.insert(x, y, clearance);
+        }
+
+        // and a query of every clearance close to the last model
+        for (int k = 0; k < 4; k++)
+        {
+            float qx = x + (position(rng) / 11.55) * 0.6;
+            float qy = y + (position(rng) / 11.55) * 0.6;
+            ASSERT_EQ(scan.isOccupied(qx, qy, clearances[k]), grid.isOccupied(qx, qy, clearances[k]));
+        }
+    }
+
+    // the comparison only means something if both answers came up often
+    EXPECT_GT(occupied, 300);
+    EXPECT_LT(occupied, 2700);
+}
+
+TEST(LocationGrid, TouchingCirclesDoNotOverlap)
+{
+    LocationGrid grid;
+    grid.insert(1, 1, 0.25);
+
+    EXPECT_FALSE(grid.isOccupied(1.5, 1, 0.25));
+    EXPECT_TRUE(grid.isOccupied(1.49, 1, 0.25));
+
+    // across cell boundaries and on the negative side of the origin
+    grid.insert(-0.05, -0.05, 0.1);
+    EXPECT_TRUE(grid.isOccupied(0.1, 0.1, 0.12));
+    EXPECT_FALSE(grid.isOccupied(0.3, 0.3, 0.1));
+}
+
+TEST(LocationGrid, Clear)
+{
+    LocationGrid grid;
+    grid.insert(0, 0, 1);
+    EXPECT_EQ(1u, grid.size());
+
+    grid.clear();
+    EXPECT_EQ(0u, grid.size());
+    EXPECT_FALSE(grid.isOccupied(0, 0, 1));
+}
+
+TEST(PoissonDisk, SpacedAndReproducible)
+{
+    LocationGrid occupied;
+    occupied.insert(0, 0, 0.5);
+
+    float half_width = 7.5 - 0.6;
+    float spacing = 0.4;
+
+    mt19937 rng(7);
+    vector< pair<float,float> > points;
+    poissonDiskSample(half_width, spacing, occupied, 0.1, rng, points);
+
+    mt19937 again(7);
+    vector< pair<float,float> > same;
+    poissonDiskSample(half_width, spacing, occupied, 0.1, again, same);
+    EXPECT_EQ(points, same);
+
+    // a maximal sample of the square holds far more than a sparse one would
+    EXPECT_GT(points.size(), (size_t)(4 * half_width * half_width / (spacing * spacing) * 0.5));
+
+    LocationGrid placed;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        float x = points[i].first;
+        float y = points[i].second;
+
+        EXPECT_LE(fabs(x), half_width);
+        EXPECT_LE(fabs(y), half_width);
+        EXPECT_FALSE(occupied.isOccupied(x, y, 0.1)) << x << ", " << y;
+        EXPECT_FALSE(placed.isOccupied(x, y, spacing / 2 * 0.999f)) << x << ", " << y;
+        placed.insert(x, y, spacing / 2 * 0.999f);
+    }
+}